@@ -1,11 +1,14 @@
 package com.kashif.folar.company.app
 
 import android.app.Application
+import com.kashif.folar.utils.RenderQueue
+import com.kashif.folar.utils.ThermalMonitor
 
 class Application : Application() {
     override fun onCreate() {
         super.onCreate()
-
-
+        ThermalMonitor.start(this)
+        // Resumes renders a killed process left unfinished
+        RenderQueue.open(this)
     }
 }
\ No newline at end of file
@@ -79,6 +79,7 @@ import com.kashif.folar.enums.TorchMode
 import com.kashif.folar.result.ImageCaptureResult
 import com.kashif.folar.state.FolarState
 import com.kashif.folar.utils.NativeBridge
+import com.kashif.folar.utils.NativeJob
 import com.kashif.imagesaverplugin.ImageSaverPlugin
 import com.kashif.ocrPlugin.OcrPlugin
 import androidx.compose.foundation.Canvas
@@ -88,6 +89,7 @@ import androidx.compose.ui.graphics.Path
 import androidx.compose.ui.graphics.drawscope.Stroke
 import android.net.Uri
 import android.content.Intent
+import kotlinx.coroutines.CancellationException
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
@@ -128,6 +130,8 @@ fun InstagramCameraScreen(
     var isRecording by remember { mutableStateOf(false) }
     var isProcessing by remember { mutableStateOf(false) }
     var processingMessage by remember { mutableStateOf("Processing...") }
+    var processingDetail by remember { mutableStateOf("Applying Smart Intelligence Logic...") }
+    var activeJob by remember { mutableStateOf<NativeJob?>(null) }
     var lastCapturedImage by remember { mutableStateOf<ImageBitmap?>(null) }
     var flashMode by remember { mutableStateOf(FlashMode.OFF) }
 
@@ -365,35 +369,62 @@ fun InstagramCameraScreen(
                                                 if (isSmartStabilizationOn || isObjectTrackingOn) {
                                                     isProcessing = true
                                                     processingMessage = if (isSmartStabilizationOn) "Stabilizing Video..." else "Tracking Object..."
+                                                    processingDetail = "Applying Smart Intelligence Logic..."
 
-                                                    scope.launch(Dispatchers.IO) {
+                                                    val job = NativeJob { stage, frame, totalFrames, etaMs ->
+                                                        val text = formatJobProgress(stage, frame, totalFrames, etaMs)
+                                                        scope.launch(Dispatchers.Main) { processingDetail = text }
+                                                    }
+                                                    activeJob = job
+
+                                                    scope.launch {
                                                         try {
                                                             val outputFile = File(videoFile.parent, "PROCESSED_${videoFile.name}")
-
-                                                            if (isSmartStabilizationOn) {
-                                                                 NativeBridge.stabilizeVideo(videoFile.absolutePath, outputFile.absolutePath)
-                                                            } else if (isObjectTrackingOn) {
-                                                                 NativeBridge.trackObjectVideo(videoFile.absolutePath, outputFile.absolutePath)
+                                                            try {
+                                                                if (isSmartStabilizationOn) {
+                                                                    NativeBridge.submitStabilizeVideo(job, videoFile.absolutePath, outputFile.absolutePath)
+                                                                } else {
+                                                                    NativeBridge.submitTrackObjectVideo(job, videoFile.absolutePath, outputFile.absolutePath)
+                                                                }
+                                                            } catch (e: IllegalStateException) {
+                                                                // The job was refused (closed or already run)
+                                                                e.printStackTrace()
+                                                                isProcessing = false
+                                                                android.widget.Toast.makeText(context, "Processing Failed", android.widget.Toast.LENGTH_SHORT).show()
+                                                                return@launch
                                                             }
 
-                                                            // Notify gallery of processed file
-                                                            android.media.MediaScannerConnection.scanFile(
-                                                                context,
-                                                                arrayOf(outputFile.absolutePath),
-                                                                arrayOf("video/mp4"),
-                                                                null
-                                                            )
-
-                                                            withContext(Dispatchers.Main) {
-                                                                isProcessing = false
-                                                                android.widget.Toast.makeText(context, "Video Processed & Saved!", android.widget.Toast.LENGTH_SHORT).show()
+                                                            // Cancelled with the screen's scope or from the dialog
+                                                            val result = job.await()
+                                                            isProcessing = false
+                                                            when {
+                                                                result.isSuccess -> {
+                                                                    // Notify gallery of processed file
+                                                                    android.media.MediaScannerConnection.scanFile(
+                                                                        context,
+                                                                        arrayOf(result.outputPath),
+                                                                        arrayOf("video/mp4"),
+                                                                        null
+                                                                    )
+                                                                    android.widget.Toast.makeText(context, "Video Processed & Saved!", android.widget.Toast.LENGTH_SHORT).show()
+                                                                }
+                                                                result.isCancelled -> {
+                                                                    android.widget.Toast.makeText(context, "Processing Cancelled", android.widget.Toast.LENGTH_SHORT).show()
+                                                                }
+                                                                else -> {
+                                                                    android.widget.Toast.makeText(context, "Processing Failed: ${result.errorMessage}", android.widget.Toast.LENGTH_LONG).show()
+                                                                }
                                                             }
+                                                        } catch (e: CancellationException) {
+                                                            // The screen is gone: nothing to update or report
+                                                            throw e
                                                         } catch (e: Exception) {
                                                             e.printStackTrace()
-                                                            withContext(Dispatchers.Main) {
-                                                                isProcessing = false
-                                                                android.widget.Toast.makeText(context, "Processing Failed", android.widget.Toast.LENGTH_SHORT).show()
-                                                            }
+                                                            isProcessing = false
+                                                            android.widget.Toast.makeText(context, "Processing Failed", android.widget.Toast.LENGTH_SHORT).show()
+                                                        } finally {
+                                                            job.close()
+                                                            if (activeJob === job) activeJob = null
                                                         }
                                                     }
                                                 } else {
@@ -431,7 +462,8 @@ fun InstagramCameraScreen(
 
         // 5. Processing Overlay
         if (isProcessing) {
-            Dialog(onDismissRequest = {}) {
+            // Back dismisses nothing but stops the job; the dialog closes once it has returned.
+            Dialog(onDismissRequest = { activeJob?.cancel() }) {
                 Surface(
                     shape = RoundedCornerShape(16.dp),
                     color = Color.White,
@@ -444,7 +476,13 @@ fun InstagramCameraScreen(
                     ) {
                         CircularProgressIndicator(color = Color.Black)
                         Text(processingMessage, fontWeight = FontWeight.Bold, color = Color.Black)
-                        Text("Applying Smart Intelligence Logic...", style = MaterialTheme.typography.bodySmall, color = Color.Gray, textAlign = androidx.compose.ui.text.style.TextAlign.Center)
+                        Text(processingDetail, style = MaterialTheme.typography.bodySmall, color = Color.Gray, textAlign = androidx.compose.ui.text.style.TextAlign.Center)
+                        androidx.compose.material3.TextButton(onClick = {
+                            processingDetail = "Cancelling..."
+                            activeJob?.cancel()
+                        }) {
+                            Text("Cancel", color = Color.Black)
+                        }
                     }
                 }
             }
@@ -463,6 +501,18 @@ fun InstagramCameraScreen(
     }
 }
 
+private fun formatJobProgress(stage: Int, frame: Int, totalFrames: Int, etaMs: Long): String {
+    val label = when (stage) {
+        NativeBridge.JOB_STAGE_ANALYZING -> "Analyzing motion"
+        NativeBridge.JOB_STAGE_RENDERING -> "Rendering"
+        else -> "Tracking"
+    }
+    if (totalFrames <= 0) return "$label: frame $frame"
+    val percent = (frame * 100L / totalFrames).coerceIn(0L, 100L)
+    val eta = if (etaMs >= 0) " · ${(etaMs + 999) / 1000}s left" else ""
+    return "$label: $percent%$eta"
+}
+
 @Composable
 fun RightControlBar(
     modifier: Modifier = Modifier,
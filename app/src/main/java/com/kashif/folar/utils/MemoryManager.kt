@@ -4,8 +4,6 @@ import android.app.ActivityManager
 import android.content.Context
 import android.os.Build
 import kotlinx.atomicfu.atomic
-import java.util.concurrent.locks.ReentrantLock
-import kotlin.concurrent.withLock
 
 /**
  * Manages memory resources for camera operations on Android
@@ -15,10 +13,8 @@ object MemoryManager {
 
     private const val MEMORY_PRESSURE_THRESHOLD = 0.8
 
-
-    private val smallBufferLock = ReentrantLock()
-    private val mediumBufferLock = ReentrantLock()
-    private val largeBufferLock = ReentrantLock()
+    /** Share of the memory above the low-memory threshold native video jobs may use. */
+    private const val NATIVE_BUDGET_SHARE = 0.5
 
 
     private val memoryPressure = atomic(false)
@@ -27,11 +23,6 @@ object MemoryManager {
     private var memoryUsage = atomic(0.0)
 
 
-    private val smallBufferPool = mutableListOf<ByteArray>()
-    private val mediumBufferPool = mutableListOf<ByteArray>()
-    private val largeBufferPool = mutableListOf<ByteArray>()
-
-
     private var appContext: Context? = null
 
     /**
@@ -79,6 +70,38 @@ object MemoryManager {
             memoryPressure.value = true
             handleHighMemoryPressure()
         }
+
+        updateNativeBudget(memoryInfo)
+    }
+
+    /**
+     * Passes the current headroom and pressure level to the native engines, which size
+     * their frame buffers from it (see [NativeBridge.setMemoryBudget]).
+     */
+    private fun updateNativeBudget(memoryInfo: ActivityManager.MemoryInfo) {
+        val headroom = (memoryInfo.availMem - memoryInfo.threshold).coerceAtLeast(0L)
+        val pressure = when {
+            memoryInfo.lowMemory -> NativeBridge.MEMORY_PRESSURE_CRITICAL
+            memoryPressure.value -> NativeBridge.MEMORY_PRESSURE_MODERATE
+            else -> NativeBridge.MEMORY_PRESSURE_NORMAL
+        }
+        try {
+            NativeBridge.setMemoryBudget((headroom * NATIVE_BUDGET_SHARE).toLong(), pressure)
+        } catch (e: UnsatisfiedLinkError) {
+            // Native library unavailable; nothing to budget
+        }
+    }
+
+    /**
+     * Bytes the native video engines currently hold in frame buffers, or 0 if the native
+     * library is unavailable
+     */
+    fun nativeMemoryFootprint(): Long {
+        return try {
+            NativeBridge.nativeMemoryFootprint()
+        } catch (e: UnsatisfiedLinkError) {
+            0L
+        }
     }
 
     /**
@@ -89,21 +112,26 @@ object MemoryManager {
         System.gc()
     }
 
+    /**
+     * Get a direct buffer of [size] bytes that native code can read and write in place.
+     * Buffers come from a native pool (64-byte aligned, size classes from 4 KB to 64 MB)
+     * and are recycled when [PooledBuffer.close] is called, so capture bytes, analysis
+     * frames and encoder input cross JNI without a copy.
+     */
+    fun acquireBuffer(size: Int): PooledBuffer {
+        require(size > 0) { "size must be positive" }
+        return PooledBuffer.acquire(size)
+    }
+
     /**
      * Clear all buffer pools to free memory
      * Should be called when memory pressure is detected
      */
     fun clearBufferPools() {
-        smallBufferLock.withLock {
-            smallBufferPool.clear()
-        }
-        
-        mediumBufferLock.withLock {
-            mediumBufferPool.clear()
-        }
-        
-        largeBufferLock.withLock {
-            largeBufferPool.clear()
+        try {
+            NativeBridge.trimDirectBuffers()
+        } catch (e: UnsatisfiedLinkError) {
+            // Native library unavailable; nothing is pooled
         }
     }
 
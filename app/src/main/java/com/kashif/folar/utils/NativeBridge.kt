@@ -1,5 +1,7 @@
 package com.kashif.folar.utils
 
+import java.nio.ByteBuffer
+
 object NativeBridge {
     init {
         try {
@@ -9,18 +11,345 @@ object NativeBridge {
         }
     }
 
+    /**
+     * Two decodes: the whole clip is analyzed first, then re-read and smoothed globally.
+     * Smoothest result, highest latency.
+     */
+    const val STABILIZE_MODE_TWO_PASS = 0
+
+    /**
+     * Single decode with a bounded look-ahead window (~1s). Lower latency and memory,
+     * slightly less "floating" than [STABILIZE_MODE_TWO_PASS].
+     */
+    const val STABILIZE_MODE_STREAMING = 1
+
+    /** ORB features matched on every frame. Slowest, kept as a per-device option. */
+    const val MOTION_ESTIMATOR_ORB = 0
+
+    /** Pyramidal LK tracks, re-detected only when lock is lost (ORB as fallback). */
+    const val MOTION_ESTIMATOR_KLT = 1
+
+    /** Estimate motion on full-resolution frames. Most accurate, slowest. */
+    const val ANALYSIS_FULL_RES = 0
+
+    /**
+     * Estimate motion on a downscaled luma plane (640 px long edge, 960 px above 2560 px).
+     * Any positive value passed as `analysisLongEdge` selects that long edge instead.
+     */
+    const val ANALYSIS_AUTO = -1
+
+    /** Gaussian over the camera path (radius ~3s in two-pass, the look-ahead in streaming). */
+    const val SMOOTHER_GAUSSIAN = 0
+
+    /**
+     * Causal Kalman filter. Uses no future frames, so streaming mode writes each frame
+     * as soon as it is analyzed; the path trails the camera slightly.
+     */
+    const val SMOOTHER_KALMAN = 1
+
+    /**
+     * Smoothest path that never needs more correction than the crop hides, so no borders
+     * show. Needs the whole clip: two-pass only, streaming falls back to [SMOOTHER_GAUSSIAN].
+     */
+    const val SMOOTHER_CROP_CONSTRAINED = 2
+
+    /** CLAHE tile histograms from every frame. Flickers slightly on busy footage. */
+    const val ENHANCEMENT_PER_FRAME = 0
+
+    /**
+     * CLAHE tile LUTs recomputed every few frames (and on scene cuts) and blended over
+     * time. Cheaper and flicker-free; the default for video.
+     */
+    const val ENHANCEMENT_TEMPORAL = 1
+
+    /** Plenty of free memory; native jobs run unconstrained within their budget. */
+    const val MEMORY_PRESSURE_NORMAL = 0
+
+    /** Memory is getting tight: full-resolution motion analysis is downgraded. */
+    const val MEMORY_PRESSURE_MODERATE = 1
+
+    /**
+     * The system is about to kill processes: native jobs use the smallest analysis
+     * resolution, pipeline depth and thread count that still works, and idle native
+     * frame buffers are freed immediately.
+     */
+    const val MEMORY_PRESSURE_CRITICAL = 2
+
+    /** Live preview analysis; always served first. */
+    const val TASK_PRIORITY_INTERACTIVE = 0
+
+    /** Post-processing of a photo or clip the user is waiting for. */
+    const val TASK_PRIORITY_CAPTURE = 1
+
+    /**
+     * Video renders that can take as long as they take. Never uses every core: one
+     * native worker is kept free for the other priorities.
+     */
+    const val TASK_PRIORITY_BACKGROUND = 2
+
+    /** Pass 1 motion analysis (two-pass stabilization only). */
+    const val JOB_STAGE_ANALYZING = 0
+
+    /** Warp, enhance and encode; the only stage of streaming and sidecar re-renders. */
+    const val JOB_STAGE_RENDERING = 1
+
+    /** [trackObjectVideo]'s single pass. */
+    const val JOB_STAGE_TRACKING = 2
+
+    /** The job wrote its complete output. */
+    const val JOB_ERROR_NONE = 0
+
+    /** [NativeJob.cancel] stopped the job; see [NativeJobResult.outputPath] for a kept partial video. */
+    const val JOB_ERROR_CANCELLED = 1
+
+    /** The input is missing, not a video, or has no decodable frames. */
+    const val JOB_ERROR_INPUT_UNREADABLE = 2
+
+    /** The output could not be created or finalized (no space, no permission, encoder failure). */
+    const val JOB_ERROR_OUTPUT_UNWRITABLE = 3
+
+    /** [submitRenderStabilizedVideo] found no up-to-date motion sidecar for the input. */
+    const val JOB_ERROR_NO_MOTION_SIDECAR = 4
+
+    /** Any other failure; [NativeJobResult.errorMessage] says what. */
+    const val JOB_ERROR_FAILED = 5
+
     /**
      * Stabilizes the video at inputPath and saves it to outputPath.
      * Uses advanced Optical Flow and RANSAC for cinematic stability.
+     * [mode] is one of the STABILIZE_MODE_* constants, [estimator] one of MOTION_ESTIMATOR_*,
+     * [analysisLongEdge] one of ANALYSIS_* or a long edge in pixels.
+     * [outputLongEdge] downscales the output (e.g. 1920 for a 4K -> 1080p export); 0 keeps the source size.
+     * [smoother] is one of the SMOOTHER_* constants, [enhancement] one of ENHANCEMENT_*.
+     * [targetFps] > 0 lets a long job keep roughly that frame rate once the device
+     * throttles: it detects fewer features, analyzes at a lower resolution, refreshes the
+     * enhancement less often and, when hot (see [setThermalStatus]), renders on fewer
+     * cores. Per-step decisions are logged under "ThroughputGovernor". 0 = fixed quality.
+     * [jobHandle] is an optional handle from [NativeJob.withHandle] for progress and
+     * cancellation; any other handle, or one already used by another call, throws
+     * IllegalStateException.
+     * Average per-frame estimator cost is logged under the "VideoStabilizer" tag.
+     * Returns false if nothing (complete) was written; the job's error is only reported
+     * by [submitStabilizeVideo].
      * This is a blocking call and should be run on a background thread.
      */
-    external fun stabilizeVideo(inputPath: String, outputPath: String)
+    external fun stabilizeVideo(
+        inputPath: String,
+        outputPath: String,
+        mode: Int = STABILIZE_MODE_TWO_PASS,
+        estimator: Int = MOTION_ESTIMATOR_KLT,
+        analysisLongEdge: Int = ANALYSIS_AUTO,
+        outputLongEdge: Int = 0,
+        smoother: Int = SMOOTHER_GAUSSIAN,
+        enhancement: Int = ENHANCEMENT_TEMPORAL,
+        targetFps: Float = 0f,
+        jobHandle: Long = 0L
+    ): Boolean
+
+    /**
+     * Asynchronous [stabilizeVideo]: queues the job and returns [job] at once. The result
+     * arrives through [NativeJob.await] or [NativeJob.onComplete]. Up to two submitted jobs
+     * run at a time, the rest wait in priority order, so no caller thread is held per job.
+     * Throws IllegalStateException if [job] is closed or was already run.
+     */
+    external fun submitStabilizeVideo(
+        job: NativeJob,
+        inputPath: String,
+        outputPath: String,
+        mode: Int = STABILIZE_MODE_TWO_PASS,
+        estimator: Int = MOTION_ESTIMATOR_KLT,
+        analysisLongEdge: Int = ANALYSIS_AUTO,
+        outputLongEdge: Int = 0,
+        smoother: Int = SMOOTHER_GAUSSIAN,
+        enhancement: Int = ENHANCEMENT_TEMPORAL,
+        targetFps: Float = 0f
+    ): NativeJob
+
+    /**
+     * Stabilizes the video using a gyroscope log recorded alongside it instead of image
+     * features. Rotation comes from the integrated gyro rates; translation comes from
+     * [focalLengthPx] (full-resolution pixels) when known, otherwise from cheap phase
+     * correlation on downscaled frames.
+     *
+     * The log is either CSV ("timestamp_ns,wx,wy,wz" per line) or the "FGYR" binary
+     * format, with rates in rad/s in the camera frame (x right, y down, z along the
+     * optical axis) and timestamps relative to the first video frame. [timeOffsetMs]
+     * is added to every gyro timestamp. An unreadable log falls back to image analysis.
+     * [jobHandle] and the result work as in [stabilizeVideo].
+     * This is a blocking call and should be run on a background thread.
+     */
+    external fun stabilizeVideoWithGyro(
+        inputPath: String,
+        outputPath: String,
+        gyroLogPath: String,
+        timeOffsetMs: Double = 0.0,
+        focalLengthPx: Double = 0.0,
+        outputLongEdge: Int = 0,
+        jobHandle: Long = 0L
+    ): Boolean
+
+    /** Asynchronous [stabilizeVideoWithGyro]; submission works as in [submitStabilizeVideo]. */
+    external fun submitStabilizeVideoWithGyro(
+        job: NativeJob,
+        inputPath: String,
+        outputPath: String,
+        gyroLogPath: String,
+        timeOffsetMs: Double = 0.0,
+        focalLengthPx: Double = 0.0,
+        outputLongEdge: Int = 0
+    ): NativeJob
+
+    /**
+     * Re-renders a clip that [stabilizeVideo] (two-pass) already analyzed, using the
+     * motion sidecar it left next to the input ("<input>.motion"). Only pass 2 runs,
+     * so trying other smoothing strengths or crops is cheap.
+     * [radius] is the smoothing radius in frames (0 = default 90), [scale] the crop zoom
+     * (0 = default 1.35), [smoother] one of the SMOOTHER_* constants.
+     * [enhancement] and [jobHandle] work as in [stabilizeVideo].
+     * Returns false without writing anything if there is no up-to-date sidecar,
+     * and false if the job was cancelled.
+     * This is a blocking call and should be run on a background thread.
+     */
+    external fun renderStabilizedVideo(
+        inputPath: String,
+        outputPath: String,
+        radius: Int = 0,
+        scale: Double = 0.0,
+        outputLongEdge: Int = 0,
+        smoother: Int = SMOOTHER_GAUSSIAN,
+        enhancement: Int = ENHANCEMENT_TEMPORAL,
+        jobHandle: Long = 0L
+    ): Boolean
+
+    /**
+     * Asynchronous [renderStabilizedVideo]; submission works as in [submitStabilizeVideo].
+     * A missing sidecar completes the job with [JOB_ERROR_NO_MOTION_SIDECAR].
+     */
+    external fun submitRenderStabilizedVideo(
+        job: NativeJob,
+        inputPath: String,
+        outputPath: String,
+        radius: Int = 0,
+        scale: Double = 0.0,
+        outputLongEdge: Int = 0,
+        smoother: Int = SMOOTHER_GAUSSIAN,
+        enhancement: Int = ENHANCEMENT_TEMPORAL
+    ): NativeJob
 
     /**
      * Tracks the central object in the video and stabilizes the frame around it (Digital Gimbal).
+     * [analysisLongEdge], [outputLongEdge], [enhancement], [jobHandle] and the result work
+     * as in [stabilizeVideo].
      * This is a blocking call and should be run on a background thread.
      */
-    external fun trackObjectVideo(inputPath: String, outputPath: String)
+    external fun trackObjectVideo(
+        inputPath: String,
+        outputPath: String,
+        analysisLongEdge: Int = ANALYSIS_AUTO,
+        outputLongEdge: Int = 0,
+        enhancement: Int = ENHANCEMENT_TEMPORAL,
+        jobHandle: Long = 0L
+    ): Boolean
+
+    /** Asynchronous [trackObjectVideo]; submission works as in [submitStabilizeVideo]. */
+    external fun submitTrackObjectVideo(
+        job: NativeJob,
+        inputPath: String,
+        outputPath: String,
+        analysisLongEdge: Int = ANALYSIS_AUTO,
+        outputLongEdge: Int = 0,
+        enhancement: Int = ENHANCEMENT_TEMPORAL
+    ): NativeJob
+
+    /** Back [RenderQueue]; use that object instead of calling these directly. */
+    external fun openRenderQueue(directory: String, queue: RenderQueue)
+
+    external fun enqueueStabilization(
+        inputPath: String,
+        outputPath: String,
+        mode: Int,
+        estimator: Int,
+        analysisLongEdge: Int,
+        outputLongEdge: Int,
+        smoother: Int,
+        enhancement: Int,
+        targetFps: Float
+    ): String?
+
+    external fun cancelRenderJob(jobId: String): Boolean
+
+    external fun renderQueueJson(): String
+
+    /** Backs [NativeJob]; use that class instead of calling these directly. */
+    external fun createJob(listener: NativeJob.ProgressListener?, keepPartialOutput: Boolean, priority: Int): Long
+
+    external fun cancelJob(handle: Long)
+
+    external fun releaseJob(handle: Long)
+
+    external fun beginJobRun(handle: Long): Boolean
+
+    external fun endJobRun(handle: Long)
+
+    external fun jobStatsJson(handle: Long): String
+
+    /**
+     * Load of the native task scheduler every engine (and OpenCV's parallel loops) runs on:
+     *
+     * `{"workers","pinnedCpus":[..],"utilization","busyMs","steals",
+     *   "queued":{"interactive","capture","background"},"executed":{...}}`
+     *
+     * `utilization` is the busy share of all workers since the previous call (0..1);
+     * pinnedCpus lists the big cores the workers are pinned to, empty when not pinned.
+     */
+    external fun schedulerStatsJson(): String
+
+    /**
+     * Emits every native pipeline stage (decode, detect, warp, enhance, encode, ...) as an
+     * ATrace section, per frame and per thread. Capture with Perfetto or systrace with app
+     * tracing enabled for this package. Off by default; costs next to nothing while off.
+     */
+    external fun setTracingEnabled(enabled: Boolean)
+
+    /**
+     * Sets how much memory a native job may spend on frame buffers ([budgetBytes], 0 = no
+     * limit) and the current [pressure], one of the MEMORY_PRESSURE_* constants. Jobs size
+     * their frame queues, look-ahead, worker count and analysis resolution from it when
+     * they start; a running render pipeline also throttles while the pressure is critical.
+     * Called by [MemoryManager.updateMemoryStatus].
+     */
+    external fun setMemoryBudget(budgetBytes: Long, pressure: Int)
+
+    /**
+     * Sets the device's thermal status, one of PowerManager.THERMAL_STATUS_*. Jobs started
+     * with a target frame rate stop raising their quality from Moderate on, and shed work
+     * and render on fewer cores from Severe on. Called by [ThermalMonitor].
+     */
+    external fun setThermalStatus(status: Int)
+
+    /**
+     * Bytes the native engines currently hold in video frame buffers and pooled direct
+     * buffers (in use and idle).
+     */
+    external fun nativeMemoryFootprint(): Long
+
+    /** Back [PooledBuffer]; use [MemoryManager.acquireBuffer] instead of calling these directly. */
+    external fun acquireDirectBuffer(size: Int): Long
+
+    external fun wrapDirectBuffer(handle: Long, size: Int): ByteBuffer?
+
+    external fun releaseDirectBuffer(handle: Long)
+
+    /** Frees the memory of every idle pooled buffer. */
+    external fun trimDirectBuffers()
+
+    /**
+     * Applies the smart enhancement (CLAHE on luma) in place to the NV12 frame of
+     * [width] x [height] (both even) at the start of the direct [buffer], e.g. a
+     * [PooledBuffer]. No copy is made on either side.
+     * Returns false if [buffer] is not direct or too small.
+     */
+    external fun enhanceNv12Buffer(buffer: ByteBuffer, width: Int, height: Int): Boolean
 
     /**
      * Processes the image at the given path with optimized enhancements.
@@ -0,0 +1,177 @@
+package com.kashif.folar.utils
+
+import kotlinx.coroutines.CancellationException
+import kotlinx.coroutines.CompletableDeferred
+import kotlinx.coroutines.CoroutineStart
+import kotlinx.coroutines.awaitCancellation
+import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.launch
+
+/**
+ * Progress, cancellation and result handle for one long-running native job.
+ *
+ * Either submit it ([NativeBridge.submitStabilizeVideo], [NativeBridge.submitTrackObjectVideo],
+ * ...) and collect the [NativeJobResult] with [await] or [onComplete], or run a blocking
+ * call ([NativeBridge.stabilizeVideo], ...) in [withHandle] or [runCancellable] and pass
+ * it the handle as its `jobHandle`. A job runs once.
+ *
+ * [cancel] may be called from any thread; the native side checks it between frames
+ * and stops within a frame or two. A cancelled job deletes its output, or with
+ * [keepPartialOutput] leaves the frames written so far as a valid, shorter video.
+ * [close] the job when done with it; closing a job that is still running (submitted,
+ * or in a blocking call on another thread) cancels it and the native side frees it
+ * once the work has stopped. [priority] (one of NativeBridge.TASK_PRIORITY_*) decides how the job
+ * shares the native worker threads with other jobs.
+ */
+class NativeJob(
+    keepPartialOutput: Boolean = false,
+    listener: ProgressListener? = null,
+    priority: Int = NativeBridge.TASK_PRIORITY_BACKGROUND
+) : AutoCloseable {
+
+    fun interface ProgressListener {
+        /**
+         * Called on the worker thread running the job, at most ~4 times per second
+         * and at every stage change. [stage] is one of NativeBridge.JOB_STAGE_*,
+         * [frame] counts finished frames in that stage, [totalFrames] is 0 and
+         * [etaMs] is -1 when unknown; [etaMs] covers the current stage only.
+         */
+        fun onProgress(stage: Int, frame: Int, totalFrames: Int, etaMs: Long)
+    }
+
+    fun interface CompletionListener {
+        /** Called once, on the native job thread, when a submitted job has ended. */
+        fun onComplete(result: NativeJobResult)
+    }
+
+    private val handle: Long = NativeBridge.createJob(listener, keepPartialOutput, priority)
+
+    @Volatile
+    var isCancelled = false
+        private set
+
+    /** The submitted job's result once it has ended, else null. */
+    @Volatile
+    var result: NativeJobResult? = null
+        private set
+
+    private var closed = false
+    private var claimed = false
+    private val completion = CompletableDeferred<NativeJobResult>()
+    private val completionListeners = mutableListOf<CompletionListener>()
+
+    @Volatile
+    private var finished = false
+
+    @Synchronized
+    fun cancel() {
+        if (closed) return
+        isCancelled = true
+        NativeBridge.cancelJob(handle)
+    }
+
+    /**
+     * Suspends until the submitted job has ended. Cancelling the calling coroutine
+     * cancels the job, so leaving the screen also stops the native work.
+     */
+    suspend fun await(): NativeJobResult {
+        try {
+            return completion.await()
+        } catch (e: CancellationException) {
+            cancel()
+            throw e
+        }
+    }
+
+    /**
+     * Calls [listener] once the submitted job has ended, on the native job thread;
+     * right away on the calling thread if it already has.
+     */
+    fun onComplete(listener: CompletionListener) {
+        val ended = synchronized(completionListeners) {
+            result ?: run {
+                completionListeners += listener
+                null
+            }
+        }
+        ended?.let(listener::onComplete)
+    }
+
+    /**
+     * Per-stage timings and counters of the job as JSON, meant to be read after the
+     * job has ended (also logged by the native side when the job ends):
+     *
+     * `{"stages":{"decode":{"count","totalMs","minMs","meanMs","p95Ms","maxMs"},...},
+     *   "motion":{"estimates","dropped","inlierRatio"},"counters":{...}}`
+     *
+     * Stages are decode, resize, detect, match, estimate, smooth, warp, enhance and
+     * encode; the ones a job never ran are left out. "{}" once the job is closed.
+     */
+    @Synchronized
+    fun statsJson(): String = if (closed) "{}" else NativeBridge.jobStatsJson(handle)
+
+    // Called by the native submit* functions and by withHandle; 0 rejects the claim.
+    // Marks the native job running under the same lock as close(), so a close() from
+    // another thread only cancels the job from here on and the native side frees it.
+    @Synchronized
+    private fun claimHandle(): Long {
+        if (closed || claimed || !NativeBridge.beginJobRun(handle)) return 0L
+        claimed = true
+        return handle
+    }
+
+    /**
+     * Runs [block] with this job's handle, to be passed as the `jobHandle` of one
+     * blocking call, and returns its result. The handle stays valid until [block]
+     * returns even if the job is closed meanwhile; it must not be kept beyond that.
+     * Throws IllegalStateException if the job is closed or was already run.
+     */
+    fun <T> withHandle(block: (jobHandle: Long) -> T): T {
+        val claimed = claimHandle()
+        check(claimed != 0L) { "NativeJob is closed or was already run" }
+        try {
+            return block(claimed)
+        } finally {
+            NativeBridge.endJobRun(claimed)
+        }
+    }
+
+    // Called once by the native job thread when a submitted job ends.
+    @Suppress("unused")
+    private fun onNativeComplete(errorCode: Int, errorMessage: String, outputPath: String, statsJson: String) {
+        val ended = NativeJobResult(errorCode, errorMessage, outputPath.ifEmpty { null }, statsJson)
+        val listeners = synchronized(completionListeners) {
+            result = ended
+            completionListeners.toList().also { completionListeners.clear() }
+        }
+        completion.complete(ended)
+        listeners.forEach { it.onComplete(ended) }
+    }
+
+    @Synchronized
+    override fun close() {
+        if (closed) return
+        closed = true
+        NativeBridge.releaseJob(handle)
+    }
+
+    /**
+     * [withHandle] on the calling thread that also cancels this job if the calling
+     * coroutine is cancelled, so leaving the screen also stops the native work.
+     */
+    suspend fun <T> runCancellable(block: (jobHandle: Long) -> T): T = coroutineScope {
+        val watcher = launch(start = CoroutineStart.UNDISPATCHED) {
+            try {
+                awaitCancellation()
+            } finally {
+                if (!finished) cancel()
+            }
+        }
+        try {
+            withHandle(block)
+        } finally {
+            finished = true
+            watcher.cancel()
+        }
+    }
+}
@@ -0,0 +1,20 @@
+package com.kashif.folar.utils
+
+/**
+ * Outcome of a [NativeJob] submitted through one of the NativeBridge.submit* calls.
+ *
+ * [errorCode] is one of NativeBridge.JOB_ERROR_* and [errorMessage] says what went
+ * wrong ("" on success). [outputPath] is the video that was written, or null when
+ * there is none; a cancelled job started with `keepPartialOutput` may still have one.
+ * [statsJson] is [NativeJob.statsJson] as of completion.
+ */
+data class NativeJobResult(
+    val errorCode: Int,
+    val errorMessage: String,
+    val outputPath: String?,
+    val statsJson: String
+) {
+    val isSuccess: Boolean get() = errorCode == NativeBridge.JOB_ERROR_NONE
+
+    val isCancelled: Boolean get() = errorCode == NativeBridge.JOB_ERROR_CANCELLED
+}
@@ -0,0 +1,131 @@
+package com.kashif.folar.utils
+
+import android.os.Build
+import java.lang.ref.Cleaner
+import java.lang.ref.PhantomReference
+import java.lang.ref.ReferenceQueue
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * A direct [ByteBuffer] of [size] bytes from the native buffer pool (see
+ * [MemoryManager.acquireBuffer]). Native code reads and writes the same memory, so the
+ * buffer can be passed to calls like [NativeBridge.enhanceNv12Buffer] without a copy.
+ *
+ * [close] returns the memory to the pool; [buffer] throws IllegalStateException
+ * afterwards, and a reference kept from before must not be touched. A buffer that is
+ * never closed returns its memory once it and its [ByteBuffer] are garbage collected,
+ * but that may be much later: close it. When the pool cannot serve a request the
+ * buffer is a plain [ByteBuffer.allocateDirect] one and [close] only forgets it.
+ *
+ * Buffers derived from [buffer] ([ByteBuffer.slice], [ByteBuffer.duplicate],
+ * [ByteBuffer.asReadOnlyBuffer], typed views) must not outlive this object or the
+ * [buffer] itself: on ART they share the memory without keeping [buffer] reachable,
+ * so once it is collected the memory goes back to the pool, and may be freed,
+ * under them.
+ */
+class PooledBuffer private constructor(
+    handle: Long,
+    buffer: ByteBuffer
+) : AutoCloseable {
+
+    private var backing: ByteBuffer? = buffer
+
+    val buffer: ByteBuffer
+        @Synchronized get() = checkNotNull(backing) { "PooledBuffer is closed" }
+
+    val size: Int = buffer.capacity()
+
+    /** True when the memory comes from the native pool rather than the Java heap. */
+    val isPooled: Boolean = handle != 0L
+
+    // Tied to the ByteBuffer rather than to this object, so a ByteBuffer that is still
+    // referenced keeps its memory even after this wrapper was dropped. Views derived
+    // from it do not count (see the class comment).
+    private val release: NativeCleaner.Cleanable? =
+        if (handle != 0L) NativeCleaner.register(buffer) { NativeBridge.releaseDirectBuffer(handle) } else null
+
+    @Synchronized
+    override fun close() {
+        if (backing == null) return
+        backing = null
+        release?.clean()
+    }
+
+    internal companion object {
+        fun acquire(size: Int): PooledBuffer {
+            val handle = try {
+                NativeBridge.acquireDirectBuffer(size)
+            } catch (e: UnsatisfiedLinkError) {
+                0L
+            }
+            val pooled = if (handle != 0L) NativeBridge.wrapDirectBuffer(handle, size) else null
+            if (pooled == null) {
+                if (handle != 0L) NativeBridge.releaseDirectBuffer(handle)
+                return PooledBuffer(0L, ByteBuffer.allocateDirect(size).order(ByteOrder.nativeOrder()))
+            }
+            return PooledBuffer(handle, pooled.order(ByteOrder.nativeOrder()))
+        }
+    }
+}
+
+/**
+ * Runs an action once, when its owner has become unreachable or when [Cleanable.clean]
+ * is called, whichever comes first. [Cleaner] on Android 13 and later; the same scheme
+ * (phantom references drained by a daemon thread) before that.
+ */
+internal object NativeCleaner {
+
+    fun interface Cleanable {
+        fun clean()
+    }
+
+    /** [action] must not reference [owner], or the owner never becomes unreachable. */
+    fun register(owner: Any, action: Runnable): Cleanable {
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
+            val cleanable = systemCleaner.register(owner, action)
+            return Cleanable { cleanable.clean() }
+        }
+        ensureDaemon
+        return PhantomCleanable(owner, action)
+    }
+
+    private val systemCleaner: Cleaner by lazy { Cleaner.create() }
+
+    private val queue = ReferenceQueue<Any>()
+    // Keeps the references reachable until they are cleaned.
+    private val pending = HashSet<PhantomCleanable>()
+
+    private val ensureDaemon: Unit by lazy {
+        Thread({
+            while (true) {
+                try {
+                    (queue.remove() as PhantomCleanable).clean()
+                } catch (e: InterruptedException) {
+                    // Keep draining
+                }
+            }
+        }, "NativeCleaner").apply {
+            isDaemon = true
+            start()
+        }
+        Unit
+    }
+
+    private class PhantomCleanable(owner: Any, action: Runnable) :
+        PhantomReference<Any>(owner, queue), Cleanable {
+
+        private var action: Runnable? = action
+
+        init {
+            synchronized(pending) { pending += this }
+        }
+
+        override fun clean() {
+            val run = synchronized(pending) {
+                if (pending.remove(this)) action.also { action = null } else null
+            }
+            run?.run()
+        }
+    }
+}
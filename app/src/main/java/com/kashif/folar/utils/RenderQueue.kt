@@ -0,0 +1,90 @@
+package com.kashif.folar.utils
+
+import android.content.Context
+import android.media.MediaScannerConnection
+import java.io.File
+import java.util.concurrent.CopyOnWriteArrayList
+
+/**
+ * Stabilization renders that outlive the screen that queued them, and the process.
+ *
+ * Queued jobs and their checkpoints (finished pass-1 segments and ~10 s output parts)
+ * are kept under `filesDir/render-queue`. After the process was killed, [open] on the
+ * next start resumes every unfinished job from its last checkpoint instead of frame 0.
+ * Jobs run one after the other, or two at a time while both fit in the native memory
+ * budget (see [NativeBridge.setMemoryBudget]). Queued clips always render two-pass.
+ *
+ * A finished video is added to the media store; [Listener]s hear about every job.
+ */
+object RenderQueue {
+
+    fun interface Listener {
+        /** Called on a native job thread. [result] is as for a submitted [NativeJob]. */
+        fun onJobFinished(jobId: String, result: NativeJobResult)
+    }
+
+    private val listeners = CopyOnWriteArrayList<Listener>()
+
+    @Volatile
+    private var appContext: Context? = null
+
+    /** Starts the queue and resumes interrupted jobs; call once at app start. */
+    @Synchronized
+    fun open(context: Context) {
+        if (appContext != null) return
+        appContext = context.applicationContext
+        val directory = File(context.filesDir, "render-queue").apply { mkdirs() }
+        NativeBridge.openRenderQueue(directory.absolutePath, this)
+    }
+
+    /**
+     * Queues a stabilization of [inputPath] into [outputPath]; the parameters work as in
+     * [NativeBridge.stabilizeVideo]. Returns the job id, or null if the queue is not open,
+     * the input cannot be read or the job cannot be saved.
+     */
+    fun enqueueStabilization(
+        inputPath: String,
+        outputPath: String,
+        mode: Int = NativeBridge.STABILIZE_MODE_TWO_PASS,
+        estimator: Int = NativeBridge.MOTION_ESTIMATOR_KLT,
+        analysisLongEdge: Int = NativeBridge.ANALYSIS_AUTO,
+        outputLongEdge: Int = 0,
+        smoother: Int = NativeBridge.SMOOTHER_GAUSSIAN,
+        enhancement: Int = NativeBridge.ENHANCEMENT_TEMPORAL,
+        targetFps: Float = 0f
+    ): String? = NativeBridge.enqueueStabilization(
+        inputPath, outputPath, mode, estimator, analysisLongEdge, outputLongEdge, smoother, enhancement, targetFps
+    )
+
+    /** Cancels a queued or running job and deletes its checkpoint. False if it is unknown. */
+    fun cancel(jobId: String): Boolean = NativeBridge.cancelRenderJob(jobId)
+
+    /**
+     * Jobs in queue order with their progress:
+     *
+     * `{"running","jobs":[{"id","input","output","state":"queued"|"running",
+     *   "stage","frame","totalFrames"},...]}`
+     *
+     * `stage` is one of NativeBridge.JOB_STAGE_*.
+     */
+    fun statusJson(): String = NativeBridge.renderQueueJson()
+
+    fun addListener(listener: Listener) {
+        listeners += listener
+    }
+
+    fun removeListener(listener: Listener) {
+        listeners -= listener
+    }
+
+    // Called by the native queue when a job ended, before its checkpoint is deleted.
+    @Suppress("unused")
+    private fun onJobFinished(jobId: String, errorCode: Int, errorMessage: String, outputPath: String, statsJson: String) {
+        val result = NativeJobResult(errorCode, errorMessage, outputPath.ifEmpty { null }, statsJson)
+        val context = appContext
+        if (result.isSuccess && context != null) {
+            MediaScannerConnection.scanFile(context, arrayOf(result.outputPath), arrayOf("video/mp4"), null)
+        }
+        listeners.forEach { it.onJobFinished(jobId, result) }
+    }
+}
@@ -0,0 +1,31 @@
+package com.kashif.folar.utils
+
+import android.content.Context
+import android.os.Build
+import android.os.PowerManager
+
+/**
+ * Forwards the device's thermal status to the native engines (see
+ * [NativeBridge.setThermalStatus]), where it drives the throughput governor of jobs
+ * started with a target frame rate. Needs Android 10; on older devices the status
+ * stays THERMAL_STATUS_NONE and the governor goes by frame rate alone.
+ */
+object ThermalMonitor {
+
+    private var started = false
+
+    @Synchronized
+    fun start(context: Context) {
+        if (started || Build.VERSION.SDK_INT < Build.VERSION_CODES.Q) return
+        val powerManager = context.getSystemService(Context.POWER_SERVICE) as? PowerManager ?: return
+        started = true
+        // Delivers the current status right away, then every change.
+        powerManager.addThermalStatusListener(context.applicationContext.mainExecutor) { status ->
+            try {
+                NativeBridge.setThermalStatus(status)
+            } catch (e: UnsatisfiedLinkError) {
+                // Native library unavailable; nothing to govern
+            }
+        }
+    }
+}
@@ -0,0 +1,125 @@
+#define LOG_TAG "DirectBufferPool"
+
+#include "DirectBufferPool.h"
+#include "NativeCommon.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+int DirectBufferPool::sizeClassOf(size_t bytes) {
+    if (bytes > kMaxBytes) return -1;
+    int cls = 0;
+    while (classBytes(cls) < bytes) cls++;
+    return cls;
+}
+
+uint32_t DirectBufferPool::pop(int cls) {
+    uint64_t head = free_heads[cls].load(memory_order_acquire);
+    while (true) {
+        uint32_t top = (uint32_t)head;
+        if (top == 0) return 0;
+        uint32_t next = slots[top - 1].next.load(memory_order_relaxed);
+        uint64_t desired = (((head >> 32) + 1) << 32) | next;
+        if (free_heads[cls].compare_exchange_weak(head, desired, memory_order_acq_rel, memory_order_acquire)) {
+            return top;
+        }
+    }
+}
+
+void DirectBufferPool::push(int cls, uint32_t index) {
+    uint64_t head = free_heads[cls].load(memory_order_relaxed);
+    while (true) {
+        slots[index - 1].next.store((uint32_t)head, memory_order_relaxed);
+        uint64_t desired = (((head >> 32) + 1) << 32) | index;
+        if (free_heads[cls].compare_exchange_weak(head, desired, memory_order_release, memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+uint32_t DirectBufferPool::acquire(size_t bytes) {
+    int cls = sizeClassOf(bytes);
+    if (cls < 0) return 0;
+
+    uint32_t index = pop(cls);
+    if (index) {
+        if (slots[index - 1].block) idle_bytes.fetch_sub(classBytes(cls), memory_order_relaxed);
+    } else {
+        index = slots_used.fetch_add(1, memory_order_relaxed) + 1;
+        if (index > kMaxSlots) {
+            if (index == kMaxSlots + 1) LOGW("All %u slots in use, further buffers are not pooled", kMaxSlots);
+            return 0;
+        }
+        slots[index - 1].size_class = cls;
+    }
+
+    Slot& slot = slots[index - 1];
+    if (!slot.block) {
+        void* block = nullptr;
+        if (posix_memalign(&block, 64, classBytes(cls)) != 0) {
+            LOGE("Out of memory for a %zu byte buffer", classBytes(cls));
+            push(cls, index);
+            return 0;
+        }
+        slot.block = (uint8_t*)block;
+    }
+    slot.in_use.store(true, memory_order_relaxed);
+    live_bytes.fetch_add(classBytes(cls), memory_order_relaxed);
+    return index;
+}
+
+size_t DirectBufferPool::capacity(uint32_t handle) const {
+    uint32_t used = std::min(slots_used.load(memory_order_relaxed), kMaxSlots);
+    if (handle == 0 || handle > used || !slots[handle - 1].in_use.load(memory_order_relaxed)) return 0;
+    return classBytes(slots[handle - 1].size_class);
+}
+
+bool DirectBufferPool::release(uint32_t handle) {
+    uint32_t used = std::min(slots_used.load(memory_order_relaxed), kMaxSlots);
+    if (handle == 0 || handle > used) {
+        LOGW("Release of unknown buffer %u ignored", handle);
+        return false;
+    }
+    Slot& slot = slots[handle - 1];
+    if (!slot.in_use.exchange(false, memory_order_relaxed)) {
+        LOGW("Buffer %u released twice, ignored", handle);
+        return false;
+    }
+    size_t bytes = classBytes(slot.size_class);
+    live_bytes.fetch_sub(bytes, memory_order_relaxed);
+    idle_bytes.fetch_add(bytes, memory_order_relaxed);
+    push(slot.size_class, handle);
+    return true;
+}
+
+void DirectBufferPool::trim() {
+    size_t freed = 0;
+    for (int cls = 0; cls < kClasses; cls++) {
+        // Detach the whole free list; the tag bump makes in-flight pops retry on the
+        // empty list, so the detached slots are ours until they are pushed back.
+        uint64_t head = free_heads[cls].load(memory_order_relaxed);
+        while (!free_heads[cls].compare_exchange_weak(head, ((head >> 32) + 1) << 32,
+                                                      memory_order_acq_rel, memory_order_relaxed)) {}
+        uint32_t index = (uint32_t)head;
+        while (index) {
+            Slot& slot = slots[index - 1];
+            uint32_t next = slot.next.load(memory_order_relaxed);
+            if (slot.block) {
+                free(slot.block);
+                slot.block = nullptr;
+                idle_bytes.fetch_sub(classBytes(cls), memory_order_relaxed);
+                freed += classBytes(cls);
+            }
+            push(cls, index);
+            index = next;
+        }
+    }
+    if (freed > 0) LOGI("Trimmed %zu KB of idle buffers", freed / 1024);
+}
+
+DirectBufferPool& directBufferPool() {
+    static DirectBufferPool* pool = new DirectBufferPool();
+    return *pool;
+}
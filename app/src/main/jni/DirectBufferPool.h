@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Pool of 64-byte aligned native buffers that back the direct ByteBuffers handed to
+// Kotlin (MemoryManager.acquireBuffer). Bytes written on either side are visible to
+// the other without a copy, so capture data, analysis frames and encoder input can
+// cross JNI as they are.
+//
+// Buffers come in power-of-two size classes from 4 KB to 64 MB. Each class keeps its
+// free buffers on a lock-free stack (Treiber stack over slot indices, with a tag
+// against ABA), so acquire/release from camera and worker threads never block.
+// Larger requests, or requests once all slots are taken, fail; callers then fall back
+// to ByteBuffer.allocateDirect.
+class DirectBufferPool {
+public:
+    DirectBufferPool(const DirectBufferPool&) = delete;
+    DirectBufferPool& operator=(const DirectBufferPool&) = delete;
+
+    // Handle of a buffer of at least `bytes` bytes, or 0 if the pool cannot serve it.
+    uint32_t acquire(size_t bytes);
+
+    // Usable size of an acquired buffer; 0 for a handle that is not acquired.
+    size_t capacity(uint32_t handle) const;
+    // Address (64-byte aligned) of an acquired buffer.
+    uint8_t* data(uint32_t handle) const { return slots[handle - 1].block; }
+
+    // Returns an acquired buffer. Unknown handles and second releases are logged
+    // and ignored; returns false then.
+    bool release(uint32_t handle);
+
+    // Frees the memory of every idle buffer. Buffers in use are not affected.
+    void trim();
+
+    size_t liveBytes() const { return live_bytes.load(std::memory_order_relaxed); }
+    size_t idleBytes() const { return idle_bytes.load(std::memory_order_relaxed); }
+
+    static constexpr size_t kMinBytes = 4 * 1024;
+    static constexpr size_t kMaxBytes = 64 * 1024 * 1024;
+
+private:
+    friend DirectBufferPool& directBufferPool();
+    DirectBufferPool() = default;
+
+    static constexpr int kClasses = 15; // 4 KB .. 64 MB
+    static constexpr uint32_t kMaxSlots = 4096;
+
+    // A slot owns at most one buffer of its class for the life of the process; the
+    // memory itself is dropped by trim() and reallocated on the next acquire.
+    struct Slot {
+        uint8_t* block = nullptr; // Null when trimmed; owned by whoever popped the slot
+        std::atomic<uint32_t> next{0}; // Free-list link: slot index + 1, 0 = end
+        std::atomic<bool> in_use{false};
+        int size_class = 0;
+    };
+
+    static int sizeClassOf(size_t bytes);
+    static size_t classBytes(int cls) { return kMinBytes << cls; }
+
+    uint32_t pop(int cls);
+    void push(int cls, uint32_t index);
+
+    Slot slots[kMaxSlots];
+    std::atomic<uint32_t> slots_used{0};
+    // Per class: (tag << 32) | (slot index + 1) of the top free slot.
+    std::atomic<uint64_t> free_heads[kClasses] = {};
+    std::atomic<size_t> live_bytes{0};
+    std::atomic<size_t> idle_bytes{0};
+};
+
+// Process-wide pool, never destroyed.
+DirectBufferPool& directBufferPool();
@@ -0,0 +1,55 @@
+#include "Enhancement.h"
+#include "YuvFrame.h"
+
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+void applySmartEnhancement(Mat& frame, LumaClahe& clahe) {
+    clahe.applyBgr(frame);
+}
+
+void applySmartEnhancementLuma(Mat& nv12, LumaClahe& clahe) {
+    Mat luma = nv12Luma(nv12);
+    clahe.applyLuma(luma);
+}
+
+void applySmartEnhancementLuma(Mat& nv12, LumaClahe& clahe, TemporalClaheLuts& luts, int frameIndex) {
+    Mat luma = nv12Luma(nv12);
+    clahe.applyLuma(luma, luts, frameIndex);
+}
+
+void applyLabEnhancement(Mat& frame, Ptr<CLAHE>& clahe) {
+    Mat lab;
+    cvtColor(frame, lab, COLOR_BGR2Lab);
+
+    vector<Mat> lab_planes(3);
+    split(lab, lab_planes);
+
+    // Apply CLAHE to L channel
+    clahe->apply(lab_planes[0], lab_planes[0]);
+
+    merge(lab_planes, lab);
+    cvtColor(lab, frame, COLOR_Lab2BGR);
+}
+
+EnhancementDeviation compareWithLabEnhancement(const Mat& bgr) {
+    Mat fused = bgr.clone();
+    LumaClahe kernel;
+    applySmartEnhancement(fused, kernel);
+
+    Mat reference = bgr.clone();
+    Ptr<CLAHE> clahe = createCLAHE();
+    clahe->setClipLimit(2.0);
+    clahe->setTilesGridSize(Size(8, 8));
+    applyLabEnhancement(reference, clahe);
+
+    Mat diff;
+    absdiff(fused, reference, diff);
+    EnhancementDeviation deviation;
+    Scalar mean = cv::mean(diff);
+    deviation.mean = (mean[0] + mean[1] + mean[2]) / 3;
+    minMaxLoc(diff.reshape(1), nullptr, &deviation.max);
+    return deviation;
+}
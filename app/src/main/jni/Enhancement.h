@@ -0,0 +1,42 @@
+#pragma once
+
+#include "NativeCommon.h"
+#include "LumaClahe.h"
+
+// How video frames are enhanced. Values mirror NativeBridge.ENHANCEMENT_* on the Kotlin side.
+enum class EnhancementMode : int {
+    // Tile histograms from every frame, as for a still image.
+    PerFrame = 0,
+    // Tile LUTs refreshed every few frames and blended over time (TemporalClaheLuts):
+    // cheaper, and without the frame-to-frame flicker of per-frame equalization.
+    Temporal = 1,
+};
+
+// "Smart" enhancement: CLAHE (clip limit 2, 8x8 tiles) on the luma of a BGR frame,
+// in place. One fused pass pair, see LumaClahe.
+void applySmartEnhancement(cv::Mat& frame, LumaClahe& clahe);
+
+// Same enhancement for an NV12 frame (see YuvFrame.h): the Y plane in place,
+// chroma untouched. No color conversion at all.
+void applySmartEnhancementLuma(cv::Mat& nv12, LumaClahe& clahe);
+
+// Temporal variant for frame `frameIndex` of the clip `luts` belongs to.
+void applySmartEnhancementLuma(cv::Mat& nv12, LumaClahe& clahe, TemporalClaheLuts& luts, int frameIndex);
+
+// The original enhancement: BGR -> Lab, CLAHE on L, Lab -> BGR. Kept as the
+// reference the fused kernel is checked against.
+void applyLabEnhancement(cv::Mat& frame, cv::Ptr<cv::CLAHE>& clahe);
+
+// Per-channel absolute difference between applySmartEnhancement() and
+// applyLabEnhancement() on the same BGR image, in 8-bit levels.
+struct EnhancementDeviation {
+    double mean = 0;
+    double max = 0;
+};
+
+// Mean deviation the fused kernel may show against the Lab reference. Luma and
+// Lab L weight the channels differently, so the two never agree exactly; on
+// natural footage the mean stays around 2 levels.
+constexpr double LAB_ENHANCEMENT_TOLERANCE = 4.0;
+
+EnhancementDeviation compareWithLabEnhancement(const cv::Mat& bgr);
@@ -0,0 +1,845 @@
+#define LOG_TAG "FolarBench"
+
+#include "Enhancement.h"
+#include "GyroMotion.h"
+#include "MemoryBudget.h"
+#include "MotionEstimator.h"
+#include "ObjectTracker.h"
+#include "TaskScheduler.h"
+#include "ThroughputGovernor.h"
+#include "Trace.h"
+#include "VideoIO.h"
+#include "VideoStabilizer.h"
+#include "YuvFrame.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Workstation benchmark for folar-core.
+//
+//   folar-bench [--clips DIR] [--out DIR] [--jobs two-pass,streaming,gyro,track,enhance]
+//               [--size WxH] [--frames N] [--fps F]
+//               [--analysis-long-edge PX] [--output-long-edge PX] [--trace FILE]
+//               [--memory-budget MB] [--memory-pressure 0|1|2]
+//               [--target-fps F] [--thermal SCHEDULE]
+//
+// Without --clips it renders two synthetic clips first: "shaky" (handheld shake on a
+// static scene) and "panning" (steady pan plus shake), each with the gyro log a phone
+// would have recorded for that shake (roll rate at 200 Hz; "shaky" as CSV, "panning"
+// as binary FGYR, see GyroMotion.h). Every clip then goes through
+// the selected jobs, and each job reports fps per JobStage, wall time, peak RSS,
+// TaskScheduler utilization and, for stabilization and tracking, how much
+// frame-to-frame motion is left in the output compared to the input (re-measured
+// with the KLT estimator on both files).
+// The gyro job is two-pass with rotation from the gyro log; real clips need one next
+// to them as <clip>.gyro.csv or <clip>.gyro.bin.
+// The job's JobStats JSON is written next to its output as <clip>.<job>.stats.json.
+// The enhance job checks the fused kernel against Lab-CLAHE; the bench exits with 1
+// if any compared image exceeds LAB_ENHANCEMENT_TOLERANCE.
+// Each stage also reports heap allocations per frame after its first 30 frames (every
+// malloc-family call in the process, OpenCV and the C++ runtime included), which is 0
+// for a heap-free steady state; glibc hosts only.
+// --trace records a timeline of all jobs (Chrome trace JSON, see Trace.h).
+// --memory-budget / --memory-pressure run the jobs as the app does when MemoryManager
+// reports low memory (see MemoryBudget.h).
+// --target-fps runs the stabilization jobs under a ThroughputGovernor; --thermal
+// feeds it a synthetic thermal status per job, e.g. "0:none,5:moderate,10:severe"
+// (status from each second of the job on), since a workstation does not throttle on cue.
+// Engine logs go to stderr, the report to stdout.
+
+using namespace std;
+using namespace cv;
+
+// --- Heap allocation counter ---
+
+namespace {
+
+std::atomic<int64_t> heap_allocations{0};
+
+inline void countHeapAllocation() {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+// Counting wrappers around glibc's allocator. free() stays glibc's own, which
+// takes back everything these return.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) noexcept {
+    countHeapAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+    countHeapAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+    countHeapAllocation();
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+    countHeapAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    countHeapAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) noexcept {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    countHeapAllocation();
+    void* ptr = __libc_memalign(alignment, size);
+    if (!ptr) return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+} // extern "C"
+
+constexpr bool kHeapCounted = true;
+#else
+constexpr bool kHeapCounted = false;
+#endif
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+double msSince(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+struct BenchOptions {
+    string clipsDir;
+    string outDir = "folar-bench-out";
+    string tracePath;
+    vector<string> jobs = {"two-pass", "streaming", "gyro", "track", "enhance"};
+    Size syntheticSize = Size(1280, 720);
+    int syntheticFrames = 300;
+    double syntheticFps = 30;
+    int analysisLongEdge = ANALYSIS_AUTO;
+    int outputLongEdge = 0;
+    size_t memoryBudgetBytes = 0;
+    int memoryPressure = 0;
+    double targetFps = 0;
+    string thermalSchedule;
+};
+
+// --- Synthetic clips ---
+
+struct SyntheticMotion {
+    const char* name;
+    double panPxPerFrame;
+    double shakePx;        // Peak translation shake
+    double shakeDegrees;   // Peak rotation shake
+};
+
+const SyntheticMotion kSyntheticClips[] = {
+    {"shaky", 0.0, 12.0, 1.0},
+    {"panning", 4.0, 8.0, 0.6},
+};
+
+// Smooth blobs plus hard-edged shapes, so both KLT corners and ORB features exist.
+Mat makeScene(Size size, RNG& rng) {
+    Mat coarse(size.height / 16 + 2, size.width / 16 + 2, CV_8UC3);
+    rng.fill(coarse, RNG::UNIFORM, Scalar::all(40), Scalar::all(215));
+    Mat scene;
+    resize(coarse, scene, size, 0, 0, INTER_CUBIC);
+
+    int shapes = size.area() / 6000;
+    for (int i = 0; i < shapes; i++) {
+        Point center(rng.uniform(0, size.width), rng.uniform(0, size.height));
+        Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        int extent = rng.uniform(4, 40);
+        if (i % 2 == 0) {
+            rectangle(scene, center, center + Point(extent, extent * 2 / 3), color, FILLED);
+        } else {
+            circle(scene, center, extent / 2, color, FILLED);
+        }
+    }
+    return scene;
+}
+
+// Camera shake: a few incommensurate sines (hand tremor, walking bounce) plus noise,
+// so the path has both low- and high-frequency content.
+double shake(int i, double amplitude, const double phase[3], RNG& rng) {
+    double t = i / 30.0;
+    double s = 0.5 * sin(2 * CV_PI * 1.3 * t + phase[0]) +
+               0.3 * sin(2 * CV_PI * 4.7 * t + phase[1]) +
+               0.2 * sin(2 * CV_PI * 9.1 * t + phase[2]);
+    return amplitude * (s + 0.15 * rng.gaussian(1.0));
+}
+
+// `rollRadians` receives the camera roll of every frame, for the matching gyro log.
+bool writeSyntheticClip(const string& path, const SyntheticMotion& motion, Size size,
+                        int frames, double fps, vector<double>& rollRadians) {
+    RNG rng(0x464f4c41); // Fixed seed: every run benchmarks the same pixels
+    int margin = max(size.width, size.height) / 4;
+    Size scene_size(size.width + 2 * margin + (int)ceil(motion.panPxPerFrame * frames),
+                    size.height + 2 * margin);
+    Mat scene = makeScene(scene_size, rng);
+
+    unique_ptr<FrameSink> sink = openFrameSink(path, size, fps, 0, CodecBackend::OpenCV);
+    if (!sink) return false;
+
+    double phase[3][3];
+    for (auto& axis : phase) {
+        for (double& p : axis) p = rng.uniform(0.0, 2 * CV_PI);
+    }
+
+    Mat bgr, nv12, scratch;
+    Point2d center(size.width * 0.5, size.height * 0.5);
+    rollRadians.clear();
+    for (int i = 0; i < frames; i++) {
+        double x = margin + motion.panPxPerFrame * i + shake(i, motion.shakePx, phase[0], rng);
+        double y = margin + shake(i, motion.shakePx, phase[1], rng);
+        double a = shake(i, motion.shakeDegrees, phase[2], rng) * CV_PI / 180;
+        rollRadians.push_back(a);
+
+        // Output pixel -> scene pixel: rotate about the frame center, then offset.
+        double c = cos(a), s = sin(a);
+        Matx23d map(c, -s, x + center.x - (c * center.x - s * center.y),
+                    s, c, y + center.y - (s * center.x + c * center.y));
+        warpAffine(scene, bgr, map, size, INTER_LINEAR | WARP_INVERSE_MAP, BORDER_REFLECT);
+
+        bgrToNv12(bgr, nv12, scratch);
+        if (!sink->write(nv12)) return false;
+    }
+    return sink->close();
+}
+
+// The gyro log of a synthetic clip: the roll rate that turns frame i - 1 into frame i,
+// sampled at 200 Hz over that frame interval (GyroMotion.h axes and formats). The shake
+// translation is not a rotation, so the gyro job measures it from the image.
+bool writeSyntheticGyroLog(const string& path, const vector<double>& rollRadians, double fps,
+                           bool binary) {
+    const double kRateHz = 200;
+    struct Sample {
+        int64_t t_ns;
+        float w[3];
+    };
+    vector<Sample> samples;
+    double duration_s = (rollRadians.size() - 1) / fps;
+    for (int k = 0; k * (1 / kRateHz) <= duration_s; k++) {
+        double t = k / kRateHz;
+        size_t i = std::min(rollRadians.size() - 1, (size_t)std::floor(t * fps) + 1);
+        double wz = (rollRadians[i] - rollRadians[i - 1]) * fps;
+        samples.push_back({(int64_t)std::llround(t * 1e9), {0.f, 0.f, (float)wz}});
+    }
+
+    FILE* f = fopen(path.c_str(), binary ? "wb" : "w");
+    if (!f) return false;
+    bool ok = true;
+    if (binary) {
+        uint32_t version = 1, count = (uint32_t)samples.size();
+        ok = fwrite("FGYR", 1, 4, f) == 4 && fwrite(&version, sizeof(version), 1, f) == 1
+            && fwrite(&count, sizeof(count), 1, f) == 1;
+        for (const Sample& s : samples) {
+            ok = ok && fwrite(&s.t_ns, sizeof(s.t_ns), 1, f) == 1 && fwrite(s.w, sizeof(float), 3, f) == 3;
+        }
+    } else {
+        ok = fprintf(f, "timestamp_ns,wx,wy,wz\n") > 0;
+        for (const Sample& s : samples) {
+            ok = ok && fprintf(f, "%lld,%.6f,%.6f,%.6f\n", (long long)s.t_ns, s.w[0], s.w[1], s.w[2]) > 0;
+        }
+    }
+    return fclose(f) == 0 && ok;
+}
+
+// --- Measurements ---
+
+// Peak RSS of this process in KiB since the last resetPeakRss(). Linux resets the
+// high-water mark on a write of "5" to clear_refs; without that (old kernels) the
+// value is the peak since process start, which only ever grows across jobs.
+void resetPeakRss() {
+    ofstream clear_refs("/proc/self/clear_refs");
+    if (clear_refs) clear_refs << "5";
+}
+
+long peakRssKb() {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return atol(line.c_str() + 6);
+    }
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Frames a stage runs before its heap allocations count as steady state, as
+// FramePoolProbe's warmup.
+const int kHeapWarmupFrames = 30;
+
+// Wall time, frame count and steady-state heap allocations per JobStage, from the
+// JobControl listener (called for every frame, see the jobs' JobControl).
+class StageRecorder {
+public:
+    JobControl::Listener listener() {
+        return [this](const JobProgress& progress) { onProgress(progress); };
+    }
+
+    void finish() { closeStage(); }
+
+    struct Stage {
+        int frames = 0;
+        double ms = 0;
+        int steadyFrames = 0;          // Frames after kHeapWarmupFrames
+        int64_t steadyAllocations = 0; // Heap allocations over those frames
+    };
+    const map<JobStage, Stage>& stages() const { return recorded; }
+
+private:
+    void onProgress(const JobProgress& progress) {
+        // Reports from worker threads can arrive slightly out of order, so only a
+        // new stage (or a stage restarting at 0) closes the running one.
+        if (!running || progress.stage != stage || (progress.frame == 0 && frames > 0)) {
+            closeStage();
+            running = true;
+            stage = progress.stage;
+            stage_start = Clock::now();
+            frames = 0;
+            warm_frame = -1;
+        }
+        if (progress.frame <= frames) return;
+        frames = progress.frame;
+        int64_t allocations = heap_allocations.load(memory_order_relaxed);
+        if (warm_frame < 0) {
+            if (frames >= kHeapWarmupFrames) {
+                warm_frame = frames;
+                warm_allocations = allocations;
+            }
+        } else {
+            steady_frames = frames - warm_frame;
+            steady_allocations = allocations - warm_allocations;
+        }
+    }
+
+    void closeStage() {
+        if (!running) return;
+        Stage& s = recorded[stage];
+        s.frames += frames;
+        s.ms += msSince(stage_start);
+        if (warm_frame >= 0) {
+            s.steadyFrames += steady_frames;
+            s.steadyAllocations += steady_allocations;
+        }
+        steady_frames = 0;
+        steady_allocations = 0;
+        running = false;
+    }
+
+    bool running = false;
+    JobStage stage = JobStage::Analyzing;
+    Clock::time_point stage_start;
+    int frames = 0;
+    int warm_frame = -1;
+    int64_t warm_allocations = 0;
+    int steady_frames = 0;
+    int64_t steady_allocations = 0;
+    map<JobStage, Stage> recorded;
+};
+
+const char* stageName(JobStage stage) {
+    switch (stage) {
+        case JobStage::Analyzing: return "analyzing";
+        case JobStage::Rendering: return "rendering";
+        case JobStage::Tracking: return "tracking";
+    }
+    return "?";
+}
+
+// How shaky a clip is, from the frame-to-frame motion the KLT estimator measures.
+struct StabilityMetrics {
+    int frames = 0;
+    // RMS change of the per-frame motion (second difference of the camera path):
+    // what a viewer sees as shake. A steady pan has ~0.
+    double jitterPx = 0;
+    double jitterDegrees = 0;
+    // Share of the per-frame motion energy in the lowest frequencies (DFT bins 1-5),
+    // the lower of x and y; 1 = perfectly smooth path. As in Liu et al., "Bundled
+    // Camera Paths for Video Stabilization".
+    double stabilityScore = 0;
+};
+
+double lowFrequencyShare(const vector<double>& signal) {
+    int n = (int)signal.size();
+    if (n < 12) return 0;
+
+    // Parseval: the total energy without DC is n * sum(x^2) - |X_0|^2.
+    double sum = 0, sum_sq = 0;
+    for (double v : signal) {
+        sum += v;
+        sum_sq += v * v;
+    }
+    double total = n * sum_sq - sum * sum;
+    if (total <= 1e-12) return 1.0; // No motion at all
+
+    double low = 0;
+    for (int k = 1; k <= 5; k++) {
+        double re = 0, im = 0;
+        for (int i = 0; i < n; i++) {
+            double phi = 2 * CV_PI * k * i / n;
+            re += signal[i] * cos(phi);
+            im -= signal[i] * sin(phi);
+        }
+        low += 2 * (re * re + im * im); // Bins k and n - k
+    }
+    return min(1.0, low / total);
+}
+
+bool measureStability(const string& path, int analysisLongEdge, StabilityMetrics& metrics) {
+    unique_ptr<FrameSource> source = openFrameSource(path, CodecBackend::OpenCV);
+    if (!source) return false;
+
+    double scale = computeAnalysisScale(Size(source->info().width, source->info().height),
+                                        analysisLongEdge);
+    unique_ptr<MotionEstimator> estimator = createMotionEstimator(MotionEstimatorType::Klt);
+
+    Mat frame, gray;
+    if (!source->read(frame)) return false;
+    makeAnalysisGray(frame, gray, scale);
+    estimator->reset(gray);
+
+    vector<double> dx, dy, da;
+    while (source->read(frame)) {
+        makeAnalysisGray(frame, gray, scale);
+        TransformParam t = rescaleTransform(estimator->next(gray).transform, scale);
+        dx.push_back(t.dx);
+        dy.push_back(t.dy);
+        da.push_back(t.da * 180 / CV_PI);
+    }
+
+    metrics = StabilityMetrics();
+    metrics.frames = (int)dx.size() + 1;
+    if (dx.size() < 2) return true;
+
+    double jitter_sq = 0, jitter_a_sq = 0;
+    for (size_t i = 1; i < dx.size(); i++) {
+        double ddx = dx[i] - dx[i - 1], ddy = dy[i] - dy[i - 1], dda = da[i] - da[i - 1];
+        jitter_sq += ddx * ddx + ddy * ddy;
+        jitter_a_sq += dda * dda;
+    }
+    metrics.jitterPx = sqrt(jitter_sq / (dx.size() - 1));
+    metrics.jitterDegrees = sqrt(jitter_a_sq / (dx.size() - 1));
+    metrics.stabilityScore = min(lowFrequencyShare(dx), lowFrequencyShare(dy));
+    return true;
+}
+
+// --- Jobs ---
+
+// Full per-stage breakdown (JobStats) next to the job's output video.
+void writeStatsJson(const string& output, const JobControl& control) {
+    string path = output.substr(0, output.rfind('.')) + ".stats.json";
+    ofstream(path) << control.stats().toJson() << "\n";
+}
+
+struct ClipInfo {
+    string name;
+    string path;
+    string gyroLogPath; // Empty without a gyro log
+    VideoInfo video;
+    StabilityMetrics input;
+    bool inputMeasured = false;
+};
+
+void printJobHeader(const char* job) {
+    printf("  %-10s", job);
+}
+
+void printStages(const StageRecorder& recorder, double total_ms, long rss_kb) {
+    for (const auto& entry : recorder.stages()) {
+        const StageRecorder::Stage& s = entry.second;
+        printf(" %s %d fr %.1f fps", stageName(entry.first), s.frames,
+               s.ms > 0 ? s.frames * 1000.0 / s.ms : 0.0);
+        if (kHeapCounted && s.steadyFrames > 0) {
+            printf(" %.2f heap/fr", (double)s.steadyAllocations / s.steadyFrames);
+        }
+        printf(" |");
+    }
+    printf(" total %.2f s | peak RSS %.0f MB", total_ms / 1000, rss_kb / 1024.0);
+}
+
+void printStability(const ClipInfo& clip, const string& output, int analysisLongEdge) {
+    StabilityMetrics out;
+    if (!clip.inputMeasured || !measureStability(output, analysisLongEdge, out)) {
+        printf(" | stability n/a\n");
+        return;
+    }
+    printf(" | jitter %.2f -> %.2f px, %.3f -> %.3f deg | stability %.2f -> %.2f\n",
+           clip.input.jitterPx, out.jitterPx, clip.input.jitterDegrees, out.jitterDegrees,
+           clip.input.stabilityScore, out.stabilityScore);
+}
+
+void printGovernor(const JobStats& stats) {
+    printf("  %-10s steps down %.0f up %.0f | features x%.2f, analysis x%.2f, CLAHE refresh x%.0f, "
+           "workers x%.2f | hottest %s\n", "governor",
+           stats.counter("governorStepsDown"), stats.counter("governorStepsUp"),
+           stats.counter("governorFeatureScale", 1), stats.counter("governorAnalysisFactor", 1),
+           stats.counter("governorClaheRefreshFactor", 1), stats.counter("governorWorkerShare", 1),
+           thermalStatusName((ThermalStatus)(int)stats.counter("thermalStatusMax")));
+}
+
+// `gyro`: two-pass with rotation from the clip's gyro log instead of image features.
+void runStabilizeJob(const BenchOptions& bench, const ClipInfo& clip, StabilizationMode mode,
+                     bool gyro = false) {
+    const char* job = gyro ? "gyro" : mode == StabilizationMode::TwoPass ? "two-pass" : "streaming";
+    string output = bench.outDir + "/" + clip.name + "." + job + ".mp4";
+    if (gyro) {
+        // The engine quietly falls back to image analysis on an unusable log, which
+        // would benchmark the wrong thing.
+        GyroLog log;
+        if (clip.gyroLogPath.empty() || !loadGyroLog(clip.gyroLogPath, log)) {
+            printJobHeader(job);
+            printf(" skipped, no usable gyro log\n");
+            return;
+        }
+    }
+
+    StabilizationOptions options;
+    options.mode = mode;
+    options.analysisLongEdge = bench.analysisLongEdge;
+    options.outputLongEdge = bench.outputLongEdge;
+    options.codecBackend = CodecBackend::OpenCV;
+    options.useMotionSidecar = false; // Always time a real pass 1
+    if (gyro) options.gyroLogPath = clip.gyroLogPath;
+    options.targetFps = bench.targetFps;
+    // Parsed per job, so every job replays the schedule from its own start
+    unique_ptr<SyntheticThermalSource> thermal;
+    if (!bench.thermalSchedule.empty()) {
+        thermal = SyntheticThermalSource::parse(bench.thermalSchedule);
+        options.thermalSource = thermal.get();
+    }
+
+    StageRecorder recorder;
+    JobControl control(recorder.listener(), false, 0);
+
+    resetPeakRss();
+    Clock::time_point start = Clock::now();
+    bool ok = stabilizeVideoFile(clip.path, output, options, &control);
+    double total_ms = msSince(start);
+    recorder.finish();
+
+    printJobHeader(job);
+    if (!ok) {
+        printf(" FAILED (%s) %s\n", jobErrorName(control.outcome(false)), control.errorMessage().c_str());
+        return;
+    }
+    printStages(recorder, total_ms, peakRssKb());
+    printStability(clip, output, bench.analysisLongEdge);
+    if (options.targetFps > 0) printGovernor(control.stats());
+    writeStatsJson(output, control);
+}
+
+void runTrackJob(const BenchOptions& bench, const ClipInfo& clip) {
+    string output = bench.outDir + "/" + clip.name + ".track.mp4";
+
+    TrackingOptions options;
+    options.analysisLongEdge = bench.analysisLongEdge;
+    options.outputLongEdge = bench.outputLongEdge;
+    options.codecBackend = CodecBackend::OpenCV;
+
+    StageRecorder recorder;
+    JobControl control(recorder.listener(), false, 0);
+
+    resetPeakRss();
+    Clock::time_point start = Clock::now();
+    bool ok = trackObjectVideoFile(clip.path, output, options, &control);
+    double total_ms = msSince(start);
+    recorder.finish();
+
+    printJobHeader("track");
+    if (!ok) {
+        printf(" FAILED (%s) %s\n", jobErrorName(control.outcome(false)), control.errorMessage().c_str());
+        return;
+    }
+    printStages(recorder, total_ms, peakRssKb());
+    printStability(clip, output, bench.analysisLongEdge);
+    writeStatsJson(output, control);
+}
+
+// Synthetic BGR gradients for the Lab comparison. The widths are no multiple of
+// any vector width, so the fused kernel's scalar tails are compared as well.
+const Size kGradientSizes[] = {{97, 65}, {333, 187}, {641, 359}};
+const int kLabCheckFrames = 8; // Decoded frames compared, spread over the clip
+
+Mat makeGradient(Size size, bool radial) {
+    Mat bgr(size, CV_8UC3);
+    Point2f center(size.width * 0.4f, size.height * 0.6f);
+    float reach = (float)std::hypot(size.width, size.height);
+    for (int y = 0; y < size.height; y++) {
+        Vec3b* row = bgr.ptr<Vec3b>(y);
+        for (int x = 0; x < size.width; x++) {
+            float t = radial ? (float)std::hypot(x - center.x, y - center.y) / reach
+                             : (float)x / (size.width - 1);
+            float u = (float)y / (size.height - 1);
+            row[x] = Vec3b(saturate_cast<uchar>(255 * t), saturate_cast<uchar>(255 * u),
+                           saturate_cast<uchar>(255 * (1 - t) * (0.25f + 0.5f * u)));
+        }
+    }
+    return bgr;
+}
+
+// Enhancement kernel alone on decoded frames (no codec time): per-frame vs temporal
+// LUTs, plus the deviation of the fused kernel from the Lab-CLAHE reference on
+// frames spread over the clip and on the synthetic gradients. False if the clip
+// cannot be decoded or any of them exceeds LAB_ENHANCEMENT_TOLERANCE.
+bool runEnhanceJob(const ClipInfo& clip) {
+    printJobHeader("enhance");
+
+    unique_ptr<FrameSource> source = openFrameSource(clip.path, CodecBackend::OpenCV);
+    vector<Mat> frames;
+    Mat frame;
+    while (source && frames.size() < 120 && source->read(frame)) frames.push_back(frame.clone());
+    if (frames.empty()) {
+        printf(" FAILED\n");
+        return false;
+    }
+
+    LumaClahe clahe;
+    Mat work;
+    Clock::time_point start = Clock::now();
+    for (const Mat& f : frames) {
+        f.copyTo(work);
+        applySmartEnhancementLuma(work, clahe);
+    }
+    double per_frame_ms = msSince(start);
+
+    TemporalClaheLuts luts;
+    start = Clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+        frames[i].copyTo(work);
+        applySmartEnhancementLuma(work, clahe, luts, (int)i);
+    }
+    double temporal_ms = msSince(start);
+
+    vector<Mat> checked;
+    int step = std::max(1, (int)frames.size() / kLabCheckFrames);
+    for (size_t i = 0; i < frames.size() && checked.size() < (size_t)kLabCheckFrames; i += step) {
+        Mat bgr;
+        nv12ToBgr(frames[i], bgr);
+        checked.push_back(bgr);
+    }
+    size_t clip_frames = checked.size();
+    for (Size size : kGradientSizes) {
+        checked.push_back(makeGradient(size, false));
+        checked.push_back(makeGradient(size, true));
+    }
+
+    EnhancementDeviation worst;
+    int above = 0;
+    for (const Mat& bgr : checked) {
+        EnhancementDeviation deviation = compareWithLabEnhancement(bgr);
+        if (deviation.mean > LAB_ENHANCEMENT_TOLERANCE) above++;
+        worst.mean = std::max(worst.mean, deviation.mean);
+        worst.max = std::max(worst.max, deviation.max);
+    }
+
+    double n = (double)frames.size();
+    printf(" per-frame %.1f fps | temporal %.1f fps (%d refreshes) | vs Lab (%zu frames, %zu gradients)"
+           " worst mean %.2f max %.0f",
+           n * 1000 / per_frame_ms, n * 1000 / temporal_ms, luts.refreshCount(),
+           clip_frames, checked.size() - clip_frames, worst.mean, worst.max);
+    if (above > 0) {
+        printf(" | FAILED: %d above tolerance %.1f\n", above, LAB_ENHANCEMENT_TOLERANCE);
+        return false;
+    }
+    printf("\n");
+    return true;
+}
+
+// --- Driver ---
+
+bool parseArgs(int argc, char** argv, BenchOptions& bench) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        string value = argv[++i];
+        if (arg == "--clips") {
+            bench.clipsDir = value;
+        } else if (arg == "--out") {
+            bench.outDir = value;
+        } else if (arg == "--jobs") {
+            bench.jobs.clear();
+            stringstream list(value);
+            string job;
+            while (getline(list, job, ',')) bench.jobs.push_back(job);
+        } else if (arg == "--size") {
+            if (sscanf(value.c_str(), "%dx%d", &bench.syntheticSize.width, &bench.syntheticSize.height) != 2) {
+                return false;
+            }
+        } else if (arg == "--frames") {
+            bench.syntheticFrames = atoi(value.c_str());
+        } else if (arg == "--fps") {
+            bench.syntheticFps = atof(value.c_str());
+        } else if (arg == "--analysis-long-edge") {
+            bench.analysisLongEdge = atoi(value.c_str());
+        } else if (arg == "--output-long-edge") {
+            bench.outputLongEdge = atoi(value.c_str());
+        } else if (arg == "--trace") {
+            bench.tracePath = value;
+        } else if (arg == "--memory-budget") {
+            bench.memoryBudgetBytes = (size_t)std::max(0, atoi(value.c_str())) * 1024 * 1024;
+        } else if (arg == "--memory-pressure") {
+            bench.memoryPressure = atoi(value.c_str());
+        } else if (arg == "--target-fps") {
+            bench.targetFps = atof(value.c_str());
+        } else if (arg == "--thermal") {
+            if (!SyntheticThermalSource::parse(value)) {
+                fprintf(stderr, "Bad thermal schedule %s\n", value.c_str());
+                return false;
+            }
+            bench.thermalSchedule = value;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    bench.syntheticSize.width &= ~1;
+    bench.syntheticSize.height &= ~1;
+    return bench.syntheticFrames > 1 && bench.syntheticFps > 0 && !bench.syntheticSize.empty()
+        && bench.memoryPressure >= 0 && bench.memoryPressure <= (int)MemoryPressure::Critical;
+}
+
+bool collectClips(const BenchOptions& bench, vector<ClipInfo>& clips) {
+    namespace fs = std::filesystem;
+
+    if (bench.clipsDir.empty()) {
+        for (const SyntheticMotion& motion : kSyntheticClips) {
+            ClipInfo clip;
+            clip.name = motion.name;
+            clip.path = bench.outDir + "/" + clip.name + ".input.mp4";
+            fprintf(stderr, "Rendering synthetic clip %s\n", clip.path.c_str());
+            vector<double> roll;
+            if (!writeSyntheticClip(clip.path, motion, bench.syntheticSize,
+                                    bench.syntheticFrames, bench.syntheticFps, roll)) {
+                fprintf(stderr, "Cannot write %s\n", clip.path.c_str());
+                return false;
+            }
+            // Both log formats get exercised
+            bool binary = clips.size() % 2 == 1;
+            clip.gyroLogPath = bench.outDir + "/" + clip.name + (binary ? ".gyro.bin" : ".gyro.csv");
+            if (!writeSyntheticGyroLog(clip.gyroLogPath, roll, bench.syntheticFps, binary)) {
+                fprintf(stderr, "Cannot write %s\n", clip.gyroLogPath.c_str());
+                clip.gyroLogPath.clear();
+            }
+            clips.push_back(clip);
+        }
+        return true;
+    }
+
+    error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator(bench.clipsDir, ec)) {
+        string ext = entry.path().extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        if (ext != ".mp4" && ext != ".mov" && ext != ".mkv" && ext != ".avi") continue;
+        ClipInfo clip;
+        clip.name = entry.path().stem().string();
+        clip.path = entry.path().string();
+        for (const char* suffix : {".gyro.csv", ".gyro.bin"}) {
+            fs::path log = entry.path().parent_path() / (clip.name + suffix);
+            if (clip.gyroLogPath.empty() && fs::exists(log)) clip.gyroLogPath = log.string();
+        }
+        clips.push_back(clip);
+    }
+    sort(clips.begin(), clips.end(), [](const ClipInfo& a, const ClipInfo& b) { return a.name < b.name; });
+    if (ec || clips.empty()) {
+        fprintf(stderr, "No clips in %s\n", bench.clipsDir.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    installOpenCvParallelBackend();
+    BenchOptions bench;
+    if (!parseArgs(argc, argv, bench)) {
+        fprintf(stderr,
+                "usage: folar-bench [--clips DIR] [--out DIR] [--jobs two-pass,streaming,gyro,track,enhance]\n"
+                "                   [--size WxH] [--frames N] [--fps F]\n"
+                "                   [--analysis-long-edge PX] [--output-long-edge PX] [--trace FILE]\n"
+                "                   [--memory-budget MB] [--memory-pressure 0|1|2]\n"
+                "                   [--target-fps F] [--thermal SCHEDULE]\n");
+        return 2;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(bench.outDir, ec);
+
+    vector<ClipInfo> clips;
+    if (!collectClips(bench, clips)) return 1;
+
+    // After the synthetic clips are rendered, so only the jobs are on the timeline
+    if (!bench.tracePath.empty()) setTraceEnabled(true);
+    setMemoryBudget(bench.memoryBudgetBytes, (MemoryPressure)bench.memoryPressure);
+
+    // The Lab check sets the exit code; the other jobs only report
+    bool checks_passed = true;
+    for (ClipInfo& clip : clips) {
+        unique_ptr<FrameSource> source = openFrameSource(clip.path, CodecBackend::OpenCV);
+        if (!source) {
+            printf("%s: cannot open\n", clip.name.c_str());
+            continue;
+        }
+        clip.video = source->info();
+        source.reset();
+        clip.inputMeasured = measureStability(clip.path, bench.analysisLongEdge, clip.input);
+
+        printf("%s: %dx%d, %d frames @ %.2f fps\n", clip.name.c_str(), clip.video.width,
+               clip.video.height, clip.video.frameCount, clip.video.fps);
+
+        for (const string& job : bench.jobs) {
+            taskScheduler().statsJson(); // Starts the utilization window
+            if (job == "two-pass") {
+                runStabilizeJob(bench, clip, StabilizationMode::TwoPass);
+            } else if (job == "streaming") {
+                runStabilizeJob(bench, clip, StabilizationMode::Streaming);
+            } else if (job == "gyro") {
+                runStabilizeJob(bench, clip, StabilizationMode::TwoPass, true);
+            } else if (job == "track") {
+                runTrackJob(bench, clip);
+            } else if (job == "enhance") {
+                if (!runEnhanceJob(clip)) checks_passed = false;
+            } else {
+                fprintf(stderr, "Unknown job %s\n", job.c_str());
+            }
+            printf("  scheduler: %s\n", taskScheduler().statsJson().c_str());
+            fflush(stdout);
+        }
+    }
+
+    if (!bench.tracePath.empty()) {
+        setTraceEnabled(false);
+        if (!writeChromeTrace(bench.tracePath)) return 1;
+    }
+    return checks_passed ? 0 : 1;
+}
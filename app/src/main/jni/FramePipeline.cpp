@@ -0,0 +1,207 @@
+#define LOG_TAG "FramePipeline"
+
+#include "FramePipeline.h"
+#include "MemoryBudget.h"
+#include "TaskScheduler.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+// Stages wait on each other for whole frames (milliseconds), so after a few
+// yields it is cheaper to sleep than to keep a big core spinning.
+class Backoff {
+public:
+    void pause() {
+        if (spins < 16) {
+            spins++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    void reset() { spins = 0; }
+
+private:
+    int spins = 0;
+};
+
+} // namespace
+
+int defaultPipelineWorkers() {
+    // Worker 0 of the scheduler does not take background work
+    return std::max(1, std::min(taskScheduler().workerCount() - 1, 6));
+}
+
+FramePipeline::FramePipeline(int workers, int queueCapacity, MatAllocator* allocator, TaskPriority priority)
+    : workers(std::max(1, workers)), queue_capacity(std::max(2, queueCapacity)), allocator(allocator),
+      priority(priority) {}
+
+PipelineStats FramePipeline::run(const Source& source, const Processor& processor, const Sink& sink) {
+    int64 start = getTickCount();
+
+    BoundedQueue<PipelineFrame> decoded(queue_capacity);
+
+    // Frames between decode and write. The reorder buffer is indexed modulo this,
+    // which is collision-free because the decoder never runs further ahead.
+    const int max_in_flight = (int)(2 * decoded.capacity()) + workers;
+    // Holds every frame in flight, so render tasks never wait for room.
+    BoundedQueue<PipelineFrame> processed(max_in_flight);
+    // Under critical memory pressure the decoder only stays one frame ahead of the workers.
+    const int critical_in_flight = workers + 1;
+
+    atomic<bool> decode_done{false};
+    atomic<int> total{0};
+    atomic<int> written{0};
+
+    // --- Stage 2: Process (warp + enhance) ---
+    // One scheduler task per frame, at most `workers` at a time. A task holds a slot
+    // (the `worker` index the processor keys its state on) and ends after its frame,
+    // so more urgent work gets the core between two frames.
+    // A worker limit below `workers` leaves some slots unused; `rendering` counts
+    // the tasks holding one.
+    TaskGroup render(priority);
+    BoundedQueue<int> free_slots(workers);
+    for (int w = 0; w < workers; w++) free_slots.tryPush(int(w));
+    atomic<int> rendering{0};
+
+    std::function<void()> spawn;
+    auto renderOne = [&](int slot) {
+        PipelineFrame in;
+        if (decoded.tryPop(in)) {
+            PipelineFrame out;
+            out.index = in.index;
+            out.image.allocator = allocator;
+            processor(slot, in.index, in.image, out.image);
+            in.image.release();
+            processed.tryPush(std::move(out));
+        }
+        free_slots.tryPush(std::move(slot));
+        rendering.fetch_sub(1, memory_order_relaxed);
+        // Pairs with the decoder's fence: either it sees this free slot, or this
+        // task sees its new frame, so no frame is left without a task.
+        atomic_thread_fence(memory_order_seq_cst);
+        if (decoded.size() > 0) spawn();
+    };
+    spawn = [&] {
+        int limit = worker_limit ? std::max(1, std::min(worker_limit(), workers)) : workers;
+        int running = rendering.load(memory_order_relaxed);
+        do {
+            if (running >= limit) return;
+        } while (!rendering.compare_exchange_weak(running, running + 1, memory_order_relaxed));
+        int slot;
+        if (free_slots.tryPop(slot)) {
+            render.run([&, slot] { renderOne(slot); });
+        } else {
+            rendering.fetch_sub(1, memory_order_relaxed);
+        }
+    };
+
+    // --- Stage 1: Decode ---
+    // Its own thread: the decoder blocks on the codec, which a scheduler task must not.
+    std::thread decoder([&] {
+        traceThreadName("decode");
+        TaskPriorityScope decode_priority(priority);
+        Backoff backoff;
+        int index = 0;
+        while (true) {
+            while (true) {
+                int limit = memoryPressure() == MemoryPressure::Critical ? critical_in_flight : max_in_flight;
+                if (index - written.load(memory_order_acquire) < limit) break;
+                backoff.pause();
+            }
+            backoff.reset();
+
+            PipelineFrame frame;
+            frame.index = index;
+            frame.image.allocator = allocator;
+            if (!source(frame.image)) break;
+
+            while (!decoded.tryPush(std::move(frame))) backoff.pause();
+            backoff.reset();
+            atomic_thread_fence(memory_order_seq_cst);
+            spawn();
+            index++;
+        }
+        total.store(index, memory_order_relaxed);
+        decode_done.store(true, memory_order_release);
+    });
+
+    // --- Stage 3: Ordered write (calling thread) ---
+    PipelineStats stats;
+    stats.workers = workers;
+    stats.queue_capacity = (int)decoded.capacity();
+
+    vector<Mat> reorder(max_in_flight);
+    vector<char> present(max_in_flight, 0);
+    int pending = 0;
+    int next = 0;
+    double decode_depth_sum = 0, encode_depth_sum = 0, reorder_sum = 0;
+
+    Backoff backoff;
+    PipelineFrame frame;
+    while (true) {
+        while (processed.tryPop(frame)) {
+            int slot = frame.index % max_in_flight;
+            reorder[slot] = std::move(frame.image);
+            present[slot] = 1;
+            pending++;
+        }
+
+        int slot = next % max_in_flight;
+        if (present[slot]) {
+            int decode_depth = (int)decoded.size();
+            int encode_depth = (int)processed.size();
+            decode_depth_sum += decode_depth;
+            encode_depth_sum += encode_depth;
+            reorder_sum += pending - 1;
+            stats.decode_queue_max = std::max(stats.decode_queue_max, decode_depth);
+            stats.encode_queue_max = std::max(stats.encode_queue_max, encode_depth);
+            stats.reorder_max = std::max(stats.reorder_max, pending - 1);
+
+            sink(next, reorder[slot]);
+            reorder[slot].release();
+            present[slot] = 0;
+            pending--;
+            next++;
+            written.store(next, memory_order_release);
+            backoff.reset();
+
+            if (next % 30 == 0) {
+                LOGI("Pipeline depth at frame %d: decode %d, encode %d, reorder %d",
+                     next, decode_depth, encode_depth, pending);
+            }
+            continue;
+        }
+
+        if (decode_done.load(memory_order_acquire) && next >= total.load(memory_order_relaxed)) break;
+        backoff.pause();
+    }
+
+    decoder.join();
+    render.wait();
+
+    stats.frames = next;
+    if (next > 0) {
+        stats.decode_queue_avg = decode_depth_sum / next;
+        stats.encode_queue_avg = encode_depth_sum / next;
+        stats.reorder_avg = reorder_sum / next;
+    }
+    stats.wall_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+    LOGI("Pipeline: %d frames, %d workers, %.1f fps | decode queue avg %.1f max %d/%d | "
+         "encode queue avg %.1f max %d/%d | reorder avg %.1f max %d",
+         stats.frames, stats.workers, stats.wall_ms > 0 ? stats.frames * 1000.0 / stats.wall_ms : 0.0,
+         stats.decode_queue_avg, stats.decode_queue_max, stats.queue_capacity,
+         stats.encode_queue_avg, stats.encode_queue_max, stats.queue_capacity,
+         stats.reorder_avg, stats.reorder_max);
+    return stats;
+}
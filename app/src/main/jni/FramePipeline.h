@@ -0,0 +1,152 @@
+#pragma once
+
+#include "NativeCommon.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free multi-producer / multi-consumer queue (Vyukov).
+// Capacity is rounded up to a power of two. Producers and consumers never block:
+// tryPush() fails when full, tryPop() fails when empty.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask = cap - 1;
+        cells.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool tryPush(T&& item) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = std::move(item);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& item) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = std::move(cell.data);
+                    cell.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Approximate under concurrency; only used for depth statistics.
+    size_t size() const {
+        size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    // Separate cache lines so producers and consumers do not false-share.
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+};
+
+struct PipelineFrame {
+    int index;
+    cv::Mat image;
+};
+
+// Queue depths sampled every time a frame is written. A full decode queue means
+// the workers are the bottleneck, an empty one with an empty encode queue means
+// decode is, and a full encode queue / deep reorder buffer means encode is.
+struct PipelineStats {
+    int frames = 0;
+    int workers = 0;
+    int queue_capacity = 0;
+    double decode_queue_avg = 0;
+    int decode_queue_max = 0;
+    double encode_queue_avg = 0;
+    int encode_queue_max = 0;
+    double reorder_avg = 0;
+    int reorder_max = 0;
+    double wall_ms = 0;
+};
+
+// Three-stage pipeline: one decode thread -> up to `workers` concurrent processing
+// tasks on the shared TaskScheduler (one task per frame, at `priority`) -> ordered
+// write on the calling thread. The number of frames in flight is bounded,
+// so memory stays at roughly (2 * queueCapacity + workers) frames, and at
+// (workers + 1) while the memory pressure is Critical (MemoryBudget.h).
+class FramePipeline {
+public:
+    // Decodes the next frame into `frame`; returns false at end of stream.
+    using Source = std::function<bool(cv::Mat& frame)>;
+    // Turns input frame `index` into `out`. `worker` (0 .. workers - 1) identifies state
+    // no other concurrent call uses.
+    using Processor = std::function<void(int worker, int index, const cv::Mat& in, cv::Mat& out)>;
+    // Receives processed frames strictly in index order.
+    using Sink = std::function<void(int index, const cv::Mat& out)>;
+
+    // `allocator` (e.g. framePool()), if given, backs every decoded and processed
+    // frame, so buffers released at the end of the pipeline are reused at its start.
+    FramePipeline(int workers, int queueCapacity, cv::MatAllocator* allocator = nullptr,
+                  TaskPriority priority = TaskPriority::Background);
+
+    int workerCount() const { return workers; }
+
+    // Caps how many of the workers render at once; asked again before every frame
+    // (e.g. ThroughputGovernor::workerLimit). Set before run().
+    void setWorkerLimit(std::function<int()> limit) { worker_limit = std::move(limit); }
+
+    PipelineStats run(const Source& source, const Processor& processor, const Sink& sink);
+
+private:
+    int workers;
+    int queue_capacity;
+    cv::MatAllocator* allocator;
+    TaskPriority priority;
+    std::function<int()> worker_limit;
+};
+
+// Default number of concurrent processing tasks: every scheduler worker that takes
+// background work (at most 6).
+int defaultPipelineWorkers();
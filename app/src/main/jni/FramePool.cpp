@@ -0,0 +1,186 @@
+#define LOG_TAG "FramePool"
+
+#include "FramePool.h"
+
+#include <new>
+
+using namespace std;
+using namespace cv;
+
+size_t FrameBufferPool::sizeClass(size_t bytes) {
+    // Smallest 2^k or 1.5 * 2^k that holds `bytes`: at most 1/3 slack.
+    size_t cls = 64;
+    while (cls < bytes) {
+        size_t mid = cls + cls / 2;
+        if (mid >= bytes) return mid;
+        cls <<= 1;
+    }
+    return cls;
+}
+
+UMatData* FrameBufferPool::allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+                                    AccessFlag, UMatUsageFlags) const {
+    return allocate(nullptr, dims, sizes, type, data0, step);
+}
+
+UMatData* FrameBufferPool::allocate(Counters* job, int dims, const int* sizes, int type, void* data0,
+                                    size_t* step) const {
+    // Same layout rules as OpenCV's default allocator
+    size_t total = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data0 && step[i] != Mat::AUTO_STEP) {
+                CV_Assert(total <= step[i]);
+                total = step[i];
+            } else {
+                step[i] = total;
+            }
+        }
+        total *= sizes[i];
+    }
+
+    uchar* data = (uchar*)data0;
+    void* header = nullptr;
+    size_t cls = sizeClass(total);
+    {
+        lock_guard<std::mutex> lock(pool_mutex);
+        if (!data0) {
+            auto it = idle_buffers.find(cls);
+            if (it != idle_buffers.end() && !it->second.empty()) {
+                data = it->second.back();
+                it->second.pop_back();
+                idle_bytes -= cls;
+                reuse_count.fetch_add(1, memory_order_relaxed);
+                if (job) job->reuses.fetch_add(1, memory_order_relaxed);
+            }
+        }
+        if (!idle_headers.empty()) {
+            header = idle_headers.back();
+            idle_headers.pop_back();
+        }
+    }
+
+    int64_t allocations = 0;
+    if (!data) {
+        data = (uchar*)fastMalloc(cls);
+        allocations++;
+    }
+    if (!header) {
+        header = ::operator new(sizeof(UMatData));
+        allocations++;
+    }
+    if (allocations > 0) {
+        heap_allocations.fetch_add(allocations, memory_order_relaxed);
+        if (job) job->heapAllocations.fetch_add(allocations, memory_order_relaxed);
+    }
+
+    UMatData* u = new (header) UMatData(this);
+    u->data = u->origdata = data;
+    u->size = total;
+    if (data0) {
+        u->flags |= UMatData::USER_ALLOCATED;
+    } else {
+        live_bytes.fetch_add(cls, memory_order_relaxed);
+    }
+    return u;
+}
+
+bool FrameBufferPool::allocate(UMatData* u, AccessFlag, UMatUsageFlags) const {
+    return u != nullptr;
+}
+
+void FrameBufferPool::deallocate(UMatData* u) const {
+    if (!u) return;
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+
+    uchar* data = (u->flags & UMatData::USER_ALLOCATED) ? nullptr : u->origdata;
+    size_t cls = sizeClass(u->size);
+    u->origdata = nullptr;
+    u->~UMatData();
+
+    if (data) live_bytes.fetch_sub(cls, memory_order_relaxed);
+
+    lock_guard<std::mutex> lock(pool_mutex);
+    idle_headers.push_back(u);
+    if (data) {
+        idle_buffers[cls].push_back(data);
+        idle_bytes += cls;
+    }
+}
+
+void FrameBufferPool::trim() {
+    lock_guard<std::mutex> lock(pool_mutex);
+    for (auto& entry : idle_buffers) {
+        for (uchar* data : entry.second) fastFree(data);
+    }
+    idle_buffers.clear();
+    for (void* header : idle_headers) ::operator delete(header);
+    idle_headers.clear();
+    idle_bytes = 0;
+}
+
+void FrameBufferPool::beginJob() {
+    lock_guard<std::mutex> lock(pool_mutex);
+    active_jobs++;
+}
+
+void FrameBufferPool::endJob() {
+    {
+        lock_guard<std::mutex> lock(pool_mutex);
+        if (--active_jobs > 0) return;
+    }
+    // A job starting right now only finds an empty pool, as it would have anyway.
+    trim();
+}
+
+size_t FrameBufferPool::idleBytes() const {
+    lock_guard<std::mutex> lock(pool_mutex);
+    return idle_bytes;
+}
+
+FrameBufferPool& framePool() {
+    static FrameBufferPool* pool = new FrameBufferPool();
+    return *pool;
+}
+
+FramePoolProbe::FramePoolProbe(int warmupFrames) : warmup_frames(warmupFrames) {
+    framePool().beginJob();
+}
+
+FramePoolProbe::~FramePoolProbe() {
+    endJob();
+}
+
+UMatData* FramePoolProbe::allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                                   AccessFlag, UMatUsageFlags) const {
+    // The UMatData belongs to the pool, which also takes it back on release.
+    return framePool().allocate(&counters, dims, sizes, type, data, step);
+}
+
+bool FramePoolProbe::allocate(UMatData* u, AccessFlag, UMatUsageFlags) const {
+    return u != nullptr;
+}
+
+void FramePoolProbe::deallocate(UMatData* u) const {
+    framePool().deallocate(u);
+}
+
+void FramePoolProbe::finish(JobStats* stats) {
+    int64_t allocations = counters.heapAllocations.load(memory_order_relaxed);
+    if (stats) {
+        stats->setCounter("poolHeapAllocations", (double)allocations);
+        stats->setCounter("poolReuses", (double)counters.reuses.load(memory_order_relaxed));
+        stats->setCounter("poolPeakLiveBytes", (double)peak_live_bytes);
+        if (warm_allocations >= 0) {
+            stats->setCounter("poolSteadyStateAllocations", (double)(allocations - warm_allocations));
+        }
+    }
+    endJob();
+}
+
+void FramePoolProbe::endJob() {
+    if (ended) return;
+    ended = true;
+    framePool().endJob();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "NativeCommon.h"
+#include "JobStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// cv::MatAllocator that recycles buffers instead of returning them to the heap.
+//
+// Video frames all have the same few sizes, so once the pipeline has cycled its
+// in-flight frames every decode / warp output reuses a buffer an earlier frame
+// released. Requests are rounded up to size classes (powers of two and 1.5x
+// powers of two), so buffers whose size varies a little per frame, such as ORB
+// descriptor matrices, are reused as well. The UMatData headers are recycled too,
+// so a steady-state Mat::create() from the pool takes nothing from the heap.
+//
+// Only Mats whose `allocator` is set to the pool use it (Mat copies and moves keep
+// the allocator); OpenCV-internal temporaries stay on the default allocator.
+// Thread-safe: frames are allocated on one pipeline thread and released on another.
+class FrameBufferPool : public cv::MatAllocator {
+public:
+    // Heap allocations and reuses attributed to one job (see FramePoolProbe).
+    struct Counters {
+        std::atomic<int64_t> heapAllocations{0};
+        std::atomic<int64_t> reuses{0};
+    };
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    // Same, also counting into `job` (may be null).
+    cv::UMatData* allocate(Counters* job, int dims, const int* sizes, int type, void* data, size_t* step) const;
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    // Buffers and headers taken from the heap / served from the idle lists, since
+    // process start. A steady-state job only moves `reuses`.
+    int64_t heapAllocations() const { return heap_allocations.load(std::memory_order_relaxed); }
+    int64_t reuses() const { return reuse_count.load(std::memory_order_relaxed); }
+
+    // Returns every idle buffer to the heap.
+    void trim();
+
+    // Jobs using the pool. The last job to end trims it, so a 4K job does not keep
+    // its frames after it is done, but a job still running keeps its warm buffers.
+    void beginJob();
+    void endJob();
+
+    // Bytes of pool buffers held by live Mats, and of idle buffers kept for reuse.
+    size_t liveBytes() const { return live_bytes.load(std::memory_order_relaxed); }
+    size_t idleBytes() const;
+
+private:
+    static size_t sizeClass(size_t bytes);
+
+    mutable std::mutex pool_mutex;
+    mutable std::unordered_map<size_t, std::vector<uchar*>> idle_buffers; // By size class
+    mutable std::vector<void*> idle_headers;                               // Destroyed UMatData storage
+    mutable size_t idle_bytes = 0;
+    int active_jobs = 0;
+    mutable std::atomic<int64_t> heap_allocations{0};
+    mutable std::atomic<int64_t> reuse_count{0};
+    mutable std::atomic<size_t> live_bytes{0};
+};
+
+// Process-wide pool. Never destroyed, so Mats released during static destruction
+// still find their allocator.
+FrameBufferPool& framePool();
+
+// Pool use of one job: the heap allocations the pool made for it over the whole job
+// and after the first `warmupFrames` frames, written into the job's JobStats as
+// the counters poolHeapAllocations, poolSteadyStateAllocations and poolReuses,
+// plus the peak bytes of pool buffers in use (poolPeakLiveBytes, process-wide).
+// These cover the pool only: OpenCV temporaries and other allocations outside it
+// are not seen. folar-bench measures every heap allocation per frame.
+//
+// The probe is the allocator the job's Mats use: it forwards to framePool() and
+// counts only that job's allocations, so a job running alongside does not show up
+// in them. Buffers are released straight to the pool, but a Mat that still has the
+// probe as its `allocator` must not be re-created after the probe is gone.
+class FramePoolProbe : public cv::MatAllocator {
+public:
+    explicit FramePoolProbe(int warmupFrames = 30);
+    ~FramePoolProbe() override;
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    // Call once per finished frame with its index.
+    void frame(int index) {
+        if (index == warmup_frames) warm_allocations = counters.heapAllocations.load(std::memory_order_relaxed);
+        peak_live_bytes = std::max(peak_live_bytes, framePool().liveBytes());
+    }
+
+    // Writes the counters and ends the job's use of the pool (also done by the
+    // destructor when a job returns early).
+    void finish(JobStats* stats);
+
+private:
+    void endJob();
+
+    mutable FrameBufferPool::Counters counters;
+    int warmup_frames;
+    int64_t warm_allocations = -1;
+    size_t peak_live_bytes = 0;
+    bool ended = false;
+};
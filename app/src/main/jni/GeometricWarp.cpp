@@ -0,0 +1,99 @@
+#include "GeometricWarp.h"
+#include "YuvFrame.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace cv;
+
+namespace {
+
+Matx33d toHomogeneous(const Matx23d& m) {
+    return Matx33d(m(0, 0), m(0, 1), m(0, 2),
+                   m(1, 0), m(1, 1), m(1, 2),
+                   0, 0, 1);
+}
+
+// Same map on the half-resolution chroma grid. Chroma sample c sits at luma
+// position 2c + 0.5, so the luma map is conjugated with that scaling.
+Matx23d chromaTransform(const Matx23d& luma) {
+    Matx33d to_luma(2, 0, 0.5,
+                    0, 2, 0.5,
+                    0, 0, 1);
+    Matx33d to_chroma(0.5, 0, -0.25,
+                      0, 0.5, -0.25,
+                      0, 0, 1);
+    Matx33d m = to_chroma * toHomogeneous(luma) * to_luma;
+    return Matx23d(m(0, 0), m(0, 1), m(0, 2),
+                   m(1, 0), m(1, 1), m(1, 2));
+}
+
+} // namespace
+
+Size computeOutputSize(Size sourceSize, int outputLongEdge) {
+    int width = sourceSize.width;
+    int height = sourceSize.height;
+    int long_edge = std::max(width, height);
+
+    if (outputLongEdge > 0 && outputLongEdge < long_edge) {
+        double s = (double)outputLongEdge / long_edge;
+        width = cvRound(width * s);
+        height = cvRound(height * s);
+    }
+
+    // Ensure dimensions are even to make encoders happy
+    int safe_width = (width % 2 == 0) ? width : width - 1;
+    int safe_height = (height % 2 == 0) ? height : height - 1;
+    return Size(safe_width, safe_height);
+}
+
+Matx23d stabilizationTransform(double dx, double dy, double da) {
+    double c = std::cos(da);
+    double s = std::sin(da);
+    return Matx23d(c, -s, dx,
+                   s,  c, dy);
+}
+
+Matx23d composeOutputTransform(const WarpGeometry& geometry, const Matx23d& stabilization) {
+    const Size& src = geometry.sourceSize;
+    const Size& dst = geometry.outputSize;
+
+    // Zoom about the centre (same matrix getRotationMatrix2D builds for angle 0)
+    double s = geometry.zoom;
+    double cx = src.width / 2;
+    double cy = src.height / 2;
+    Matx33d zoom(s, 0, (1 - s) * cx,
+                 0, s, (1 - s) * cy,
+                 0, 0, 1);
+
+    // Pixel-centre aligned resize, the same mapping cv::resize uses
+    double sx = (double)dst.width / src.width;
+    double sy = (double)dst.height / src.height;
+    Matx33d output(sx, 0, 0.5 * sx - 0.5,
+                   0, sy, 0.5 * sy - 0.5,
+                   0, 0, 1);
+
+    Matx33d m = output * zoom * toHomogeneous(stabilization);
+    return Matx23d(m(0, 0), m(0, 1), m(0, 2),
+                   m(1, 0), m(1, 1), m(1, 2));
+}
+
+void warpToOutput(const Mat& src, Mat& dst, const WarpGeometry& geometry,
+                  const Matx23d& stabilization) {
+    Matx23d m = composeOutputTransform(geometry, stabilization);
+    warpAffine(src, dst, m, geometry.outputSize, INTER_LINEAR);
+}
+
+void warpNv12ToOutput(const Mat& src, Mat& dst, const WarpGeometry& geometry,
+                      const Matx23d& stabilization) {
+    Matx23d m = composeOutputTransform(geometry, stabilization);
+    const Size& out = geometry.outputSize;
+    createNv12(dst, out);
+
+    // Limited-range black: Y = 16, neutral chroma. Plain zeros would turn the borders green.
+    Mat y = nv12Luma(dst);
+    Mat uv = nv12Chroma(dst);
+    warpAffine(nv12Luma(src), y, m, out, INTER_LINEAR, BORDER_CONSTANT, Scalar(16));
+    warpAffine(nv12Chroma(src), uv, chromaTransform(m), Size(out.width / 2, out.height / 2),
+               INTER_LINEAR, BORDER_CONSTANT, Scalar(128, 128));
+}
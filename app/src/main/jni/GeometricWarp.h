@@ -0,0 +1,39 @@
+#pragma once
+
+#include "NativeCommon.h"
+
+// Everything between a decoded frame and the encoder input is one affine map:
+// per-frame stabilization, the fixed crop-zoom that hides the moving borders, and
+// the resize to the (even) encoder size. Folding them into a single matrix means
+// one interpolation pass written straight into the output buffer, instead of a
+// warpAffine at source size followed by a resize.
+struct WarpGeometry {
+    cv::Size sourceSize;
+    cv::Size outputSize;
+    double zoom = 1.0; // Crop zoom about the source centre
+};
+
+// Output size for a source frame: even dimensions (encoders reject odd ones),
+// optionally downscaled so the long edge is at most `outputLongEdge` px
+// (0 = keep the source resolution).
+cv::Size computeOutputSize(cv::Size sourceSize, int outputLongEdge);
+
+// Source -> output pixel map: resize * zoom * stabilization.
+// `stabilization` maps source pixels to stabilized source pixels.
+cv::Matx23d composeOutputTransform(const WarpGeometry& geometry, const cv::Matx23d& stabilization);
+
+// Stabilization matrix for a jitter correction of (dx, dy, da): rotation by `da`
+// about the origin followed by the translation, as used by the trajectory smoother.
+cv::Matx23d stabilizationTransform(double dx, double dy, double da);
+
+// Single resampling pass into `dst` (allocated at geometry.outputSize).
+// Bilinear: for outputs below ~0.5x of the zoomed source, some aliasing is
+// traded for skipping the separate INTER_AREA resize.
+void warpToOutput(const cv::Mat& src, cv::Mat& dst, const WarpGeometry& geometry,
+                  const cv::Matx23d& stabilization);
+
+// NV12 variant (see YuvFrame.h): Y is resampled with the full-resolution map and
+// UV with the same map expressed in chroma sample coordinates, each at its native
+// resolution. Uncovered borders are filled with video black.
+void warpNv12ToOutput(const cv::Mat& src, cv::Mat& dst, const WarpGeometry& geometry,
+                      const cv::Matx23d& stabilization);
@@ -0,0 +1,245 @@
+#define LOG_TAG "GyroMotion"
+
+#include "GyroMotion.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+const char kBinaryMagic[4] = {'F', 'G', 'Y', 'R'};
+
+bool loadBinary(FILE* f, GyroLog& log) {
+    uint32_t version = 0, count = 0;
+    if (fread(&version, sizeof(version), 1, f) != 1 || version != 1) return false;
+    if (fread(&count, sizeof(count), 1, f) != 1) return false;
+
+    // Each sample is an int64 timestamp and three floats. A corrupt count must not
+    // turn into a huge allocation.
+    const uint64_t sample_bytes = sizeof(int64_t) + 3 * sizeof(float);
+    struct stat st;
+    off_t position = ftello(f);
+    if (position < 0 || fstat(fileno(f), &st) != 0
+        || (uint64_t)count * sample_bytes > (uint64_t)(st.st_size - position)) {
+        LOGW("Gyro log claims %u samples, more than it holds", count);
+        return false;
+    }
+
+    log.samples.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        int64_t t_ns;
+        float w[3];
+        if (fread(&t_ns, sizeof(t_ns), 1, f) != 1 || fread(w, sizeof(float), 3, f) != 3) return false;
+        log.samples.push_back({t_ns / 1e6, w[0], w[1], w[2]});
+    }
+    return true;
+}
+
+bool loadCsv(FILE* f, GyroLog& log) {
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        const char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || isalpha((unsigned char)*p) || *p == '\n' || *p == '\r' || *p == 0) continue;
+
+        double t_ns, wx, wy, wz;
+        if (sscanf(p, "%lf ,%lf ,%lf ,%lf", &t_ns, &wx, &wy, &wz) != 4) {
+            LOGW("Skipping malformed gyro line: %s", line);
+            continue;
+        }
+        log.samples.push_back({t_ns / 1e6, wx, wy, wz});
+    }
+    return true;
+}
+
+// Integrates the angular rate over [t0, t1] (trapezoid, linear interpolation at
+// the bounds). Frames are queried in order, so a cursor keeps this O(samples).
+class GyroIntegrator {
+public:
+    GyroIntegrator(const GyroLog& log, double offset_ms) : samples(log.samples), offset(offset_ms) {}
+
+    Vec3d integrate(double t0_ms, double t1_ms) {
+        Vec3d angle(0, 0, 0);
+        if (samples.size() < 2 || t1_ms <= t0_ms) return angle;
+
+        double t0 = t0_ms - offset;
+        double t1 = t1_ms - offset;
+
+        // Rewind only if the caller went backwards (e.g. a re-opened capture).
+        if (cursor > 0 && samples[cursor].t_ms > t0) cursor = 0;
+        while (cursor + 1 < samples.size() && samples[cursor + 1].t_ms <= t0) cursor++;
+
+        for (size_t k = cursor; k + 1 < samples.size(); k++) {
+            const GyroSample& a = samples[k];
+            const GyroSample& b = samples[k + 1];
+            if (a.t_ms >= t1) break;
+
+            double lo = std::max(a.t_ms, t0);
+            double hi = std::min(b.t_ms, t1);
+            if (hi <= lo) continue;
+
+            Vec3d w_lo = rateAt(a, b, lo);
+            Vec3d w_hi = rateAt(a, b, hi);
+            angle += (w_lo + w_hi) * (0.5 * (hi - lo) / 1000.0);
+        }
+        return angle;
+    }
+
+private:
+    static Vec3d rateAt(const GyroSample& a, const GyroSample& b, double t) {
+        double span = b.t_ms - a.t_ms;
+        double u = span > 0 ? (t - a.t_ms) / span : 0;
+        return Vec3d(a.wx + (b.wx - a.wx) * u,
+                     a.wy + (b.wy - a.wy) * u,
+                     a.wz + (b.wz - a.wz) * u);
+    }
+
+    const vector<GyroSample>& samples;
+    double offset;
+    size_t cursor = 0;
+};
+
+// Residual translation between consecutive analysis frames. Phase correlation
+// costs two FFTs, no feature detection, and is insensitive to the small rotation
+// left in the pair.
+class TranslationEstimator {
+public:
+    void reset(const Mat& gray) {
+        gray.convertTo(prev, CV_32F);
+        createHanningWindow(window, prev.size(), CV_32F);
+    }
+
+    Point2d next(const Mat& gray, double& response) {
+        gray.convertTo(curr, CV_32F);
+        Point2d shift = phaseCorrelate(prev, curr, window, &response);
+        std::swap(prev, curr);
+        return shift;
+    }
+
+private:
+    Mat prev, curr, window;
+};
+
+} // namespace
+
+bool loadGyroLog(const string& path, GyroLog& log) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) {
+        LOGE("Cannot open gyro log %s", path.c_str());
+        return false;
+    }
+
+    log.samples.clear();
+    char magic[4] = {0};
+    bool ok;
+    if (fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, kBinaryMagic, 4) == 0) {
+        ok = loadBinary(f, log);
+    } else {
+        rewind(f);
+        ok = loadCsv(f, log);
+    }
+    fclose(f);
+
+    std::stable_sort(log.samples.begin(), log.samples.end(),
+                     [](const GyroSample& a, const GyroSample& b) { return a.t_ms < b.t_ms; });
+
+    if (!ok || log.samples.size() < 2) {
+        LOGE("Gyro log %s is unreadable or empty", path.c_str());
+        return false;
+    }
+    LOGI("Gyro log: %zu samples over %.1f s", log.samples.size(),
+         (log.samples.back().t_ms - log.samples.front().t_ms) / 1000.0);
+    return true;
+}
+
+bool analyzeMotionGyro(FrameSource& source, const GyroLog& log, const GyroParams& params,
+                       vector<FrameMotion>& motion, JobControl* control) {
+    const VideoInfo& info = source.info();
+    double frame_ms = info.fps > 0 ? 1000.0 / info.fps : 1000.0 / 30.0;
+    int width = info.width;
+    int height = info.height;
+    // Rotation is about the optical centre, but TransformParam rotates about the
+    // origin like the rest of the pipeline, so the centre offset goes into dx/dy.
+    Point2d centre(width / 2.0, height / 2.0);
+
+    JobStats* stats = jobStats(control);
+    Mat frame, gray;
+    double prev_ts = 0;
+    StageTimer decode_timer(stats, StatStage::Decode);
+    if (!source.read(frame, &prev_ts)) {
+        LOGE("First frame is empty");
+        return false;
+    }
+    decode_timer.stop();
+
+    bool measure_translation = params.focalLengthPx <= 0;
+    TranslationEstimator translation;
+    if (measure_translation) {
+        makeAnalysisGray(frame, gray, params.analysisScale, stats);
+        translation.reset(gray);
+    }
+
+    GyroIntegrator integrator(log, params.timeOffsetMs);
+
+    motion.clear();
+    motion.push_back({{0, 0, 0}, 0, prev_ts}); // Frame 0
+    jobAdvance(control);
+
+    int64 start = getTickCount();
+    int weak_frames = 0;
+    while (true) {
+        if (jobCancelled(control)) return false;
+        double ts = 0;
+        StageTimer frame_decode_timer(stats, StatStage::Decode);
+        if (!source.read(frame, &ts)) break;
+        frame_decode_timer.stop();
+
+        // Some backends report no or repeated timestamps; assume constant frame rate then.
+        if (!(ts > prev_ts)) ts = prev_ts + frame_ms;
+
+        // Camera rotation θ moves image content by the inverse rotation:
+        // roll -> da = -θz, yaw -> dx = -f·θy, pitch -> dy = +f·θx (small angles).
+        Vec3d theta = integrator.integrate(prev_ts, ts);
+        double da = -theta[2];
+
+        Point2d shift(0, 0);
+        if (measure_translation) {
+            double response = 0;
+            makeAnalysisGray(frame, gray, params.analysisScale, stats);
+            StageTimer estimate_timer(stats, StatStage::Estimate);
+            Point2d s = translation.next(gray, response);
+            estimate_timer.stop();
+            // Weak peak: flat or blurred frame, trust the smoother instead.
+            if (stats) stats->recordEstimate(response > 0.05, 0, 0);
+            if (response > 0.05) {
+                shift = Point2d(s.x / params.analysisScale, s.y / params.analysisScale);
+            } else {
+                weak_frames++;
+            }
+        } else {
+            shift = Point2d(-params.focalLengthPx * theta[1], params.focalLengthPx * theta[0]);
+        }
+
+        double c = std::cos(da), s = std::sin(da);
+        double dx = shift.x + centre.x - (c * centre.x - s * centre.y);
+        double dy = shift.y + centre.y - (s * centre.x + c * centre.y);
+
+        motion.push_back({{dx, dy, da}, 0, ts});
+        jobAdvance(control);
+        prev_ts = ts;
+
+        if (motion.size() % 30 == 0) LOGI("Pass 1 (gyro): frame %zu", motion.size());
+    }
+
+    double wall_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+    LOGI("Pass 1 (gyro): %zu frames in %.0f ms, translation from %s (%d weak frames)",
+         motion.size(), wall_ms, measure_translation ? "phase correlation" : "gyro", weak_frames);
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MotionAnalysis.h"
+
+#include <string>
+#include <vector>
+
+// Gyroscope-driven pass 1. Camera rotation comes from integrating a gyro log
+// recorded alongside the video, so no features are detected at all; the image is
+// only consulted for the residual translation, and not even that when the focal
+// length is known.
+//
+// Log formats (rates in the camera frame: x right, y down, z along the optical
+// axis, right-handed, rad/s; timestamps relative to the first video frame):
+//   CSV     one "timestamp_ns,wx,wy,wz" sample per line; lines starting with '#'
+//           or a letter (headers) are skipped.
+//   Binary  "FGYR", u32 version (1), u32 sample count, then per sample
+//           i64 timestamp_ns, f32 wx, f32 wy, f32 wz.
+
+struct GyroSample {
+    double t_ms;
+    double wx;
+    double wy;
+    double wz;
+};
+
+struct GyroLog {
+    std::vector<GyroSample> samples; // Sorted by time
+};
+
+// Detects the format from the first bytes. Returns false if the file cannot be
+// read or holds fewer than two samples.
+bool loadGyroLog(const std::string& path, GyroLog& log);
+
+struct GyroParams {
+    // Added to gyro timestamps to align them with video presentation times.
+    double timeOffsetMs = 0;
+    // Focal length in pixels at full source resolution. When known, pitch/yaw
+    // are converted to translation directly; when 0, translation is measured by
+    // phase correlation on the analysis-resolution frames.
+    double focalLengthPx = 0;
+    double analysisScale = 1.0;
+};
+
+// Pass 1 from the gyro log. Fills `motion` exactly like analyzeMotionSequential(),
+// so pass 2 does not know where the motion came from. Returns false once `control`
+// is cancelled.
+bool analyzeMotionGyro(FrameSource& source, const GyroLog& log, const GyroParams& params,
+                       std::vector<FrameMotion>& motion, JobControl* control = nullptr);
@@ -0,0 +1,186 @@
+#define LOG_TAG "JobCheckpoint"
+
+#include "JobCheckpoint.h"
+#include "MotionSidecar.h"
+
+#include <cstdio>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+int readCount(const string& path) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return 0;
+    int value = 0;
+    if (fscanf(f, "%d", &value) != 1 || value < 0) value = 0;
+    fclose(f);
+    return value;
+}
+
+bool writeCount(const string& path, int value) {
+    string tmp_path = path + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "w");
+    if (!f) return false;
+    bool ok = fprintf(f, "%d\n", value) > 0;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool fileExists(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+class CheckpointFrameSink : public FrameSink {
+public:
+    CheckpointFrameSink(JobCheckpoint& checkpoint, const string& outputPath, Size size, double fps,
+                        int rotationDegrees, CodecBackend backend, JobControl* control,
+                        const AudioSource& audio)
+        : checkpoint(checkpoint), output_path(outputPath), size(size), fps(fps),
+          rotation(rotationDegrees), backend(backend), control(control), audio(audio) {}
+
+    ~CheckpointFrameSink() override { close(); }
+
+    const char* backendName() const override { return "checkpoint parts"; }
+
+    bool write(const Mat& frame) override {
+        if (failed || closed) return false;
+        if (!part_sink) {
+            // Read here rather than at open, after the job decided where it resumes.
+            if (part < 0) part = checkpoint.finishedParts();
+            part_sink = openFrameSink(checkpoint.pendingPartPath(part), size, fps, rotation, backend);
+            if (!part_sink) return fail();
+            part_frames = 0;
+        }
+        if (!part_sink->write(frame)) return fail();
+        if (++part_frames == kCheckpointPartFrames) return finishPart();
+        return true;
+    }
+
+    bool close() override {
+        if (closed) return !failed;
+        closed = true;
+        if (part_sink && !finishPart()) return false;
+        if (failed) return false;
+        if (jobCancelled(control) && !control->keepPartialOutput()) return true;
+
+        vector<string> paths;
+        for (int k = 0; k < checkpoint.finishedParts(); k++) paths.push_back(checkpoint.partPath(k));
+        if (paths.empty() || !concatenateVideos(paths, output_path, fps, rotation, backend, audio)) {
+            return fail();
+        }
+        return true;
+    }
+
+private:
+    bool finishPart() {
+        bool ok = part_sink->close();
+        part_sink.reset();
+        if (!ok || !checkpoint.commitPart(part)) return fail();
+        part++;
+        return true;
+    }
+
+    bool fail() {
+        failed = true;
+        return false;
+    }
+
+    JobCheckpoint& checkpoint;
+    string output_path;
+    Size size;
+    double fps;
+    int rotation;
+    CodecBackend backend;
+    JobControl* control;
+    AudioSource audio;
+
+    unique_ptr<FrameSink> part_sink;
+    int part = -1;
+    int part_frames = 0;
+    bool failed = false;
+    bool closed = false;
+};
+
+} // namespace
+
+JobCheckpoint::JobCheckpoint(string directory) : dir(std::move(directory)) {
+    mkdir(dir.c_str(), 0755);
+    segments = readCount(dir + "/segments");
+
+    // A part counts only if its file survived, whatever the counter says.
+    int stored_parts = readCount(dir + "/parts");
+    while (parts < stored_parts && fileExists(partPath(parts))) parts++;
+    if (segments > 0 || parts > 0) {
+        LOGI("Resuming %s: %d analysis segments, %d output parts done", dir.c_str(), segments, parts);
+    }
+}
+
+int JobCheckpoint::analysisSegments(int proposed) {
+    if (segments > 0) return segments;
+    segments = proposed;
+    writeCount(dir + "/segments", segments);
+    return segments;
+}
+
+bool JobCheckpoint::loadMotionSegment(int segment, vector<FrameMotion>& motion) const {
+    return loadMotionFrames(dir + "/motion-" + to_string(segment), motion);
+}
+
+void JobCheckpoint::saveMotionSegment(int segment, const vector<FrameMotion>& motion) const {
+    if (!saveMotionFrames(dir + "/motion-" + to_string(segment), motion)) {
+        LOGW("Cannot checkpoint analysis segment %d in %s", segment, dir.c_str());
+    }
+}
+
+string JobCheckpoint::partPath(int part) const {
+    return dir + "/part-" + to_string(part) + ".mp4";
+}
+
+string JobCheckpoint::pendingPartPath(int part) const {
+    return dir + "/part-" + to_string(part) + ".tmp.mp4";
+}
+
+bool JobCheckpoint::commitPart(int part) {
+    if (rename(pendingPartPath(part).c_str(), partPath(part).c_str()) != 0) {
+        LOGE("Cannot commit output part %d in %s", part, dir.c_str());
+        return false;
+    }
+    parts = part + 1;
+    if (!writeCount(dir + "/parts", parts)) LOGW("Cannot checkpoint output part %d in %s", part, dir.c_str());
+    return true;
+}
+
+void JobCheckpoint::discardParts() {
+    parts = 0;
+    remove((dir + "/parts").c_str());
+}
+
+void JobCheckpoint::clear() {
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            string name = entry->d_name;
+            if (name != "." && name != "..") remove((dir + "/" + name).c_str());
+        }
+        closedir(d);
+    }
+    rmdir(dir.c_str());
+    segments = 0;
+    parts = 0;
+}
+
+unique_ptr<FrameSink> openCheckpointFrameSink(JobCheckpoint& checkpoint, const string& outputPath, Size size,
+                                              double fps, int rotationDegrees, CodecBackend backend,
+                                              JobControl* control, const AudioSource& audio) {
+    return make_unique<CheckpointFrameSink>(checkpoint, outputPath, size, fps, rotationDegrees, backend, control,
+                                            audio);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "MotionAnalysis.h"
+#include "JobControl.h"
+#include "VideoIO.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Crash-resumable progress of one two-pass stabilization, kept in a directory of
+// its own (RenderQueue gives every queued job one):
+//   segments      number of pass-1 analysis segments, fixed by the first run
+//   motion-<k>    pass-1 motion of analysis segment k, once the segment is complete
+//   parts         number of complete output parts
+//   part-<k>.mp4  output part k, kCheckpointPartFrames frames each
+// Every file is written under a temp name and renamed (a part is encoded as
+// part-<k>.tmp.mp4, which keeps the extension the writer picks its container by),
+// so a process killed at any point leaves either the previous or the new state. A resumed job reuses the
+// finished segments and parts and only redoes the ones that were in progress.
+
+// ~10 s at 30 fps: the most render work a killed process loses, and the length of
+// the pass-1 segments of a checkpointed job.
+constexpr int kCheckpointPartFrames = 300;
+
+class JobCheckpoint {
+public:
+    // Creates `directory` if needed and loads what an earlier run left there.
+    explicit JobCheckpoint(std::string directory);
+
+    const std::string& directory() const { return dir; }
+
+    // Pass 1. `proposed` is used on the first run; a resumed job gets the count its
+    // saved segments were cut for. Segments save concurrently, one file each.
+    int analysisSegments(int proposed);
+    bool loadMotionSegment(int segment, std::vector<FrameMotion>& motion) const;
+    void saveMotionSegment(int segment, const std::vector<FrameMotion>& motion) const;
+
+    // Pass 2. Output frames [0, finishedParts() * kCheckpointPartFrames) are written.
+    int finishedParts() const { return parts; }
+    std::string partPath(int part) const;
+    // Where part `part` is encoded; commitPart() renames it to partPath().
+    std::string pendingPartPath(int part) const;
+    bool commitPart(int part);
+    // Forgets the output parts, e.g. when the input cannot seek to where they end.
+    void discardParts();
+
+    // Deletes the checkpoint and its directory (the job ended, either way).
+    void clear();
+
+private:
+    std::string dir;
+    int segments = 0;
+    int parts = 0;
+};
+
+// Writes frames as parts of kCheckpointPartFrames frames, commits each part to
+// `checkpoint` once it is finalized and continues after the parts already there.
+// close() joins every part into `outputPath` (concatenateVideos), except for a
+// cancelled job that does not keep partial output. Parts are video only; the audio
+// of `audio` is added when they are joined.
+std::unique_ptr<FrameSink> openCheckpointFrameSink(JobCheckpoint& checkpoint, const std::string& outputPath,
+                                                   cv::Size size, double fps, int rotationDegrees,
+                                                   CodecBackend backend, JobControl* control,
+                                                   const AudioSource& audio = AudioSource());
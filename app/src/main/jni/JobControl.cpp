@@ -0,0 +1,94 @@
+#include "JobControl.h"
+
+#include <chrono>
+
+namespace {
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+const char* jobErrorName(JobError error) {
+    switch (error) {
+        case JobError::None: return "none";
+        case JobError::Cancelled: return "cancelled";
+        case JobError::InputUnreadable: return "input unreadable";
+        case JobError::OutputUnwritable: return "output unwritable";
+        case JobError::NoMotionSidecar: return "no motion sidecar";
+        case JobError::Failed: return "failed";
+    }
+    return "failed";
+}
+
+JobControl::JobControl(Listener listener, bool keepPartialOutput, double minIntervalMs, TaskPriority priority)
+    : listener(std::move(listener)),
+      keep_partial(keepPartialOutput),
+      min_interval_ns((int64_t)(minIntervalMs * 1e6)),
+      job_priority(priority) {}
+
+void JobControl::beginStage(JobStage newStage, int totalFrames) {
+    stage.store((int)newStage);
+    total.store(totalFrames > 0 ? totalFrames : 0);
+    done.store(0);
+    int64_t now = nowNs();
+    stage_start_ns.store(now);
+    next_report_ns.store(now + min_interval_ns);
+    publish();
+}
+
+void JobControl::advance(int frames) {
+    done.fetch_add(frames, std::memory_order_relaxed);
+    if (!listener) return;
+
+    // Only the thread that moves the deadline forward reports.
+    int64_t now = nowNs();
+    int64_t due = next_report_ns.load(std::memory_order_relaxed);
+    if (now < due) return;
+    if (!next_report_ns.compare_exchange_strong(due, now + min_interval_ns, std::memory_order_relaxed)) return;
+    publish();
+}
+
+JobProgress JobControl::progress() const {
+    JobProgress progress;
+    progress.stage = (JobStage)stage.load();
+    progress.frame = done.load();
+    progress.totalFrames = total.load();
+    progress.etaMs = -1;
+
+    double elapsed_ms = (nowNs() - stage_start_ns.load()) / 1e6;
+    if (progress.totalFrames > 0 && progress.frame > 0) {
+        int remaining = progress.totalFrames - progress.frame;
+        progress.etaMs = remaining > 0 ? elapsed_ms * remaining / progress.frame : 0;
+    }
+    return progress;
+}
+
+void JobControl::publish() {
+    if (!listener) return;
+
+    JobProgress current = progress();
+    std::lock_guard<std::mutex> lock(listener_mutex);
+    listener(current);
+}
+
+void JobControl::fail(JobError newError, const std::string& message) {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    if (error != JobError::None) return;
+    error = newError;
+    error_message = message;
+}
+
+JobError JobControl::outcome(bool succeeded) const {
+    if (succeeded) return JobError::None;
+    if (cancelled()) return JobError::Cancelled;
+    std::lock_guard<std::mutex> lock(error_mutex);
+    return error != JobError::None ? error : JobError::Failed;
+}
+
+std::string JobControl::errorMessage() const {
+    std::lock_guard<std::mutex> lock(error_mutex);
+    return error_message;
+}
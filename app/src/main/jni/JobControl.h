@@ -0,0 +1,129 @@
+#pragma once
+
+#include "JobStats.h"
+#include "TaskScheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Progress and cancellation shared between a running native job and its caller.
+// The job polls cancelled() between frames and calls advance() once per finished
+// frame, from any thread; the listener is called at most once per `minIntervalMs`
+// (plus once at every stage change), so reporting never slows the job down.
+
+// Values mirror NativeBridge.JOB_STAGE_* on the Kotlin side.
+enum class JobStage : int {
+    Analyzing = 0, // Pass 1 motion analysis
+    Rendering = 1, // Warp + enhance + encode (also the whole streaming mode)
+    Tracking = 2,  // Object-lock tracking
+};
+
+// Why a job produced no (complete) output.
+// Values mirror NativeBridge.JOB_ERROR_* on the Kotlin side.
+enum class JobError : int {
+    None = 0,
+    Cancelled = 1,
+    InputUnreadable = 2,  // Input missing, not a video, or no decodable frames
+    OutputUnwritable = 3, // Output could not be created or finalized
+    NoMotionSidecar = 4,  // Sidecar re-render without an up-to-date sidecar
+    Failed = 5,           // Anything else; see the message
+};
+
+const char* jobErrorName(JobError error);
+
+struct JobProgress {
+    JobStage stage;
+    int frame;        // Frames finished in this stage
+    int totalFrames;  // 0 if the container does not say
+    double etaMs;     // Remaining time for this stage, -1 if unknown
+};
+
+class JobControl {
+public:
+    using Listener = std::function<void(const JobProgress&)>;
+
+    explicit JobControl(Listener listener = nullptr, bool keepPartialOutput = false,
+                        double minIntervalMs = 250, TaskPriority priority = TaskPriority::Background);
+
+    // Safe from any thread, any number of times.
+    void cancel() { cancel_requested.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancel_requested.load(std::memory_order_relaxed); }
+
+    // On cancel, keep what was written so far (a valid, shorter video) instead of
+    // deleting the output.
+    bool keepPartialOutput() const { return keep_partial; }
+
+    JobStage currentStage() const { return (JobStage)stage.load(); }
+
+    // Scheduling class of the job's threads and tasks (see TaskScheduler.h).
+    TaskPriority priority() const { return job_priority; }
+
+    void beginStage(JobStage stage, int totalFrames);
+    void advance(int frames = 1);
+
+    // Where the job is now, as the listener would be told.
+    JobProgress progress() const;
+
+    // Records why the job is failing. The first failure wins: later ones are
+    // usually consequences of it.
+    void fail(JobError error, const std::string& message);
+
+    // The job's outcome once the engine returned `succeeded`: None on success,
+    // else Cancelled if cancel() was called, else the recorded failure (Failed if
+    // none was recorded).
+    JobError outcome(bool succeeded) const;
+    std::string errorMessage() const;
+
+    // Stage timings and counters of this job, see JobStats.h.
+    JobStats& stats() { return job_stats; }
+    const JobStats& stats() const { return job_stats; }
+
+private:
+    void publish();
+
+    Listener listener;
+    bool keep_partial;
+    int64_t min_interval_ns;
+    TaskPriority job_priority;
+
+    std::atomic<bool> cancel_requested{false};
+    std::atomic<int> stage{(int)JobStage::Analyzing};
+    std::atomic<int> total{0};
+    std::atomic<int> done{0};
+    std::atomic<int64_t> stage_start_ns{0};
+    std::atomic<int64_t> next_report_ns{0};
+    std::mutex listener_mutex; // Listener calls never overlap
+    mutable std::mutex error_mutex;
+    JobError error = JobError::None;
+    std::string error_message;
+    JobStats job_stats;
+};
+
+// Null-safe forms, so code paths that run without a job stay unchanged.
+inline bool jobCancelled(const JobControl* control) {
+    return control && control->cancelled();
+}
+
+inline void jobFail(JobControl* control, JobError error, const std::string& message) {
+    if (control) control->fail(error, message);
+}
+
+inline void jobAdvance(JobControl* control, int frames = 1) {
+    if (control) control->advance(frames);
+}
+
+// Jobs without a JobControl run as background work.
+inline TaskPriority jobPriority(const JobControl* control) {
+    return control ? control->priority() : TaskPriority::Background;
+}
+
+inline JobStats* jobStats(JobControl* control) {
+    return control ? &control->stats() : nullptr;
+}
+
+inline void jobBeginStage(JobControl* control, JobStage stage, int totalFrames) {
+    if (control) control->beginStage(stage, totalFrames);
+}
@@ -0,0 +1,58 @@
+#define LOG_TAG "JobRunner"
+
+#include "JobRunner.h"
+#include "NativeCommon.h"
+#include "Trace.h"
+
+#include <thread>
+
+using namespace std;
+
+void JobRunner::submit(TaskPriority priority, function<void()> job) {
+    lock_guard<mutex> lock(queue_mutex);
+    queues[(int)priority].push_back(std::move(job));
+    queued++;
+    if (threads >= kMaxRunningJobs) {
+        LOGI("%d jobs running, %s job queued (%d waiting)", threads, taskPriorityName(priority), queued);
+        return;
+    }
+    threads++;
+    thread(&JobRunner::drain, this).detach();
+}
+
+int JobRunner::runningJobs() {
+    lock_guard<mutex> lock(queue_mutex);
+    return threads;
+}
+
+int JobRunner::queuedJobs() {
+    lock_guard<mutex> lock(queue_mutex);
+    return queued;
+}
+
+void JobRunner::drain() {
+    traceThreadName("folar-job");
+    for (;;) {
+        function<void()> job;
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            for (auto& queue : queues) {
+                if (queue.empty()) continue;
+                job = std::move(queue.front());
+                queue.pop_front();
+                queued--;
+                break;
+            }
+            if (!job) {
+                threads--;
+                return;
+            }
+        }
+        job();
+    }
+}
+
+JobRunner& jobRunner() {
+    static JobRunner* runner = new JobRunner();
+    return *runner;
+}
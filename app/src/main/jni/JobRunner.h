@@ -0,0 +1,40 @@
+#pragma once
+
+#include "TaskScheduler.h"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Runs whole jobs (a stabilization, a tracking pass) for callers that submit them
+// asynchronously, so the caller does not block a thread of its own per job.
+//
+// A job spends much of its time waiting on the codec and on its own TaskGroups,
+// so it must not sit on a TaskScheduler worker. It gets a dedicated job thread
+// instead, while the frame work it fans out still runs on the scheduler. At most
+// kMaxRunningJobs run at once, which keeps the frame buffers of concurrent jobs
+// within the memory budget; the rest wait, most urgent priority first, then in
+// submission order. Job threads exit when the queue is empty.
+class JobRunner {
+public:
+    static constexpr int kMaxRunningJobs = 2;
+
+    void submit(TaskPriority priority, std::function<void()> job);
+
+    int runningJobs();
+    int queuedJobs();
+
+private:
+    friend JobRunner& jobRunner();
+    JobRunner() = default;
+
+    void drain();
+
+    std::mutex queue_mutex;
+    std::deque<std::function<void()>> queues[kTaskPriorities];
+    int threads = 0;
+    int queued = 0;
+};
+
+// Process-wide runner, never destroyed.
+JobRunner& jobRunner();
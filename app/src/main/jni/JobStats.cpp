@@ -0,0 +1,131 @@
+#include "JobStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+void appendNumber(std::string& json, double value) {
+    char buf[32];
+    // JSON has no NaN / Infinity
+    snprintf(buf, sizeof(buf), "%.3f", std::isfinite(value) ? value : 0.0);
+    json += buf;
+}
+
+void appendKey(std::string& json, const char* key) {
+    json += '"';
+    json += key;
+    json += "\":";
+}
+
+} // namespace
+
+const char* statStageName(StatStage stage) {
+    switch (stage) {
+        case StatStage::Decode: return "decode";
+        case StatStage::Resize: return "resize";
+        case StatStage::Detect: return "detect";
+        case StatStage::Match: return "match";
+        case StatStage::Estimate: return "estimate";
+        case StatStage::Smooth: return "smooth";
+        case StatStage::Warp: return "warp";
+        case StatStage::Enhance: return "enhance";
+        case StatStage::Encode: return "encode";
+        case StatStage::Count: break;
+    }
+    return "unknown";
+}
+
+void JobStats::record(StatStage stage, double ms) {
+    StageSamples& s = stages[(int)stage];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.ms.push_back((float)ms);
+    s.total_ms += ms;
+}
+
+void JobStats::recordEstimate(bool valid, int inlierCount, int candidateCount) {
+    estimates.fetch_add(1, std::memory_order_relaxed);
+    if (!valid) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    inliers.fetch_add(inlierCount, std::memory_order_relaxed);
+    candidates.fetch_add(candidateCount, std::memory_order_relaxed);
+}
+
+void JobStats::setCounter(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(counter_mutex);
+    counters[name] = value;
+}
+
+double JobStats::counter(const std::string& name, double fallback) const {
+    std::lock_guard<std::mutex> lock(counter_mutex);
+    auto it = counters.find(name);
+    return it == counters.end() ? fallback : it->second;
+}
+
+double JobStats::totalMs(StatStage stage) const {
+    const StageSamples& s = stages[(int)stage];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.total_ms;
+}
+
+std::string JobStats::toJson() const {
+    std::string json = "{\"stages\":{";
+    bool first = true;
+    std::vector<float> sorted;
+    for (int i = 0; i < (int)StatStage::Count; i++) {
+        const StageSamples& s = stages[i];
+        double total_ms;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            sorted = s.ms;
+            total_ms = s.total_ms;
+        }
+        if (sorted.empty()) continue;
+
+        size_t p95 = std::min(sorted.size() - 1, (size_t)std::ceil(sorted.size() * 0.95) - 1);
+        std::nth_element(sorted.begin(), sorted.begin() + p95, sorted.end());
+        double p95_ms = sorted[p95];
+        auto range = std::minmax_element(sorted.begin(), sorted.end());
+
+        if (!first) json += ',';
+        first = false;
+        appendKey(json, statStageName((StatStage)i));
+        json += "{\"count\":" + std::to_string(sorted.size());
+        json += ",\"totalMs\":";
+        appendNumber(json, total_ms);
+        json += ",\"minMs\":";
+        appendNumber(json, *range.first);
+        json += ",\"meanMs\":";
+        appendNumber(json, total_ms / sorted.size());
+        json += ",\"p95Ms\":";
+        appendNumber(json, p95_ms);
+        json += ",\"maxMs\":";
+        appendNumber(json, *range.second);
+        json += '}';
+    }
+
+    int n_estimates = estimates.load();
+    int n_dropped = dropped.load();
+    int64_t n_candidates = candidates.load();
+    json += "},\"motion\":{\"estimates\":" + std::to_string(n_estimates);
+    json += ",\"dropped\":" + std::to_string(n_dropped);
+    json += ",\"inlierRatio\":";
+    appendNumber(json, n_candidates > 0 ? (double)inliers.load() / n_candidates : 0.0);
+
+    json += "},\"counters\":{";
+    {
+        std::lock_guard<std::mutex> lock(counter_mutex);
+        first = true;
+        for (const auto& counter : counters) {
+            if (!first) json += ',';
+            first = false;
+            appendKey(json, counter.first.c_str());
+            appendNumber(json, counter.second);
+        }
+    }
+    json += "}}";
+    return json;
+}
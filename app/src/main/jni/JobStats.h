@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Per-stage timings and counters of one native job, reported as JSON when it ends
+// (NativeJob.statsJson() on the Kotlin side, folar-bench on a host). Tells whether
+// a slow job is decode-, feature-, RANSAC-, warp-, CLAHE- or encode-bound.
+//
+// Recording is thread-safe and costs two clock reads plus an uncontended lock per
+// timed call; jobs without a JobControl record nothing at all. The same scopes
+// feed the timeline trace (Trace.h) when tracing is on.
+
+// Order is the order stages appear in the JSON report.
+enum class StatStage : int {
+    Decode = 0,   // FrameSource::read
+    Resize,       // Analysis luma plane (makeAnalysisGray)
+    Detect,       // ORB detect + describe, KLT corner top-up
+    Match,        // ORB brute-force matching, KLT optical flow
+    Estimate,     // RANSAC similarity fit
+    Smooth,       // Trajectory smoothing (whole path, or per frame when streaming)
+    Warp,         // Stabilization warp to output size
+    Enhance,      // CLAHE
+    Encode,       // FrameSink::write and close
+    Count
+};
+
+const char* statStageName(StatStage stage);
+
+class JobStats {
+public:
+    void record(StatStage stage, double ms);
+
+    // One frame-to-frame motion estimate: `inliers` of `candidates` matched points
+    // survived RANSAC; an invalid estimate is a dropped frame (identity motion).
+    void recordEstimate(bool valid, int inliers, int candidates);
+
+    // Named job-level values (queue depths, LUT refreshes, ...), last write wins.
+    void setCounter(const std::string& name, double value);
+    double counter(const std::string& name, double fallback = 0) const;
+
+    // Time recorded for `stage` so far, for consumers that watch a job while it runs.
+    double totalMs(StatStage stage) const;
+
+    // {"stages":{"decode":{"count":..,"totalMs":..,"minMs":..,"meanMs":..,"p95Ms":..,
+    //  "maxMs":..},...},"motion":{"estimates":..,"dropped":..,"inlierRatio":..},
+    //  "counters":{...}}. Stages that never ran are left out.
+    std::string toJson() const;
+
+private:
+    struct StageSamples {
+        mutable std::mutex mutex;
+        std::vector<float> ms;
+        double total_ms = 0;
+    };
+
+    StageSamples stages[(int)StatStage::Count];
+    std::atomic<int> estimates{0};
+    std::atomic<int> dropped{0};
+    std::atomic<int64_t> inliers{0};
+    std::atomic<int64_t> candidates{0};
+
+    mutable std::mutex counter_mutex;
+    std::map<std::string, double> counters;
+};
+
+// Times the enclosing scope (or until stop()) into `stats`, and traces it as a
+// TraceScope named after the stage (with `frame` when >= 0). A null `stats` only
+// skips the aggregation, so call sites need no job checks.
+class StageTimer {
+public:
+    StageTimer(JobStats* stats, StatStage stage, int frame = -1)
+        : stats(stats), stage(stage), trace(statStageName(stage), frame) {
+        if (stats) start = std::chrono::steady_clock::now();
+    }
+    ~StageTimer() { stop(); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    void stop() {
+        trace.end();
+        if (!stats) return;
+        stats->record(stage, std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start).count());
+        stats = nullptr;
+    }
+
+private:
+    JobStats* stats;
+    StatStage stage;
+    std::chrono::steady_clock::time_point start;
+    TraceScope trace;
+};
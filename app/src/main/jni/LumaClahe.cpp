@@ -0,0 +1,355 @@
+// NativeCommon.h undefines __ARM_NEON before including OpenCV, which also reduces
+// OpenCV's universal intrinsics to their scalar fallback. The kernels below use
+// arm_neon.h directly, keyed off the compiler's setting from before that happens.
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LUMA_CLAHE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include "LumaClahe.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+const int kBins = 256;
+// Interpolation weights are fixed point in [0, kWeightOne].
+const int kWeightOne = 128;
+// Sampling step of the scene-cut probe, in pixels along both axes.
+const int kProbeStep = 8;
+
+// cv::CLAHE pads images whose size is not a multiple of the grid with
+// BORDER_REFLECT_101 (both dimensions, by a whole tile if one already divides)
+// and takes the tile size from the padded image. Mirrored here so that the tile
+// LUTs are the same.
+Size tileSize(Size image, Size tiles) {
+    if (image.width % tiles.width == 0 && image.height % tiles.height == 0) {
+        return Size(image.width / tiles.width, image.height / tiles.height);
+    }
+    int padded_w = image.width + tiles.width - image.width % tiles.width;
+    int padded_h = image.height + tiles.height - image.height % tiles.height;
+    return Size(padded_w / tiles.width, padded_h / tiles.height);
+}
+
+inline int reflect101(int i, int n) {
+    if (n == 1) return 0;
+    while (i < 0 || i >= n) {
+        i = i < 0 ? -i : 2 * (n - 1) - i;
+    }
+    return i;
+}
+
+// BT.601 luma with weights summing to 256: (29 B + 150 G + 77 R + 128) >> 8.
+void bgrToLuma(const uint8_t* bgr, uint8_t* luma, int width) {
+    int x = 0;
+#if LUMA_CLAHE_NEON
+    const uint8x8_t wb = vdup_n_u8(29), wg = vdup_n_u8(150), wr = vdup_n_u8(77);
+    for (; x <= width - 16; x += 16) {
+        uint8x16x3_t px = vld3q_u8(bgr + 3 * x);
+        uint16x8_t lo = vmull_u8(vget_low_u8(px.val[0]), wb);
+        lo = vmlal_u8(lo, vget_low_u8(px.val[1]), wg);
+        lo = vmlal_u8(lo, vget_low_u8(px.val[2]), wr);
+        uint16x8_t hi = vmull_u8(vget_high_u8(px.val[0]), wb);
+        hi = vmlal_u8(hi, vget_high_u8(px.val[1]), wg);
+        hi = vmlal_u8(hi, vget_high_u8(px.val[2]), wr);
+        vst1q_u8(luma + x, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+#endif
+    for (; x < width; x++) {
+        const uint8_t* p = bgr + 3 * x;
+        luma[x] = (uint8_t)((29 * p[0] + 150 * p[1] + 77 * p[2] + 128) >> 8);
+    }
+}
+
+// Adds (new_luma - luma) to all three channels, saturating.
+void shiftBgrByLuma(uint8_t* bgr, const uint8_t* luma, const uint8_t* new_luma, int width) {
+    int x = 0;
+#if LUMA_CLAHE_NEON
+    for (; x <= width - 16; x += 16) {
+        uint8x16x3_t px = vld3q_u8(bgr + 3 * x);
+        uint8x16_t y0 = vld1q_u8(luma + x);
+        uint8x16_t y1 = vld1q_u8(new_luma + x);
+        // Wrapping u8 -> u16 subtraction reinterpreted as s16 is the signed difference.
+        int16x8_t d_lo = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(y1), vget_low_u8(y0)));
+        int16x8_t d_hi = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(y1), vget_high_u8(y0)));
+        for (int c = 0; c < 3; c++) {
+            int16x8_t lo = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(px.val[c]))), d_lo);
+            int16x8_t hi = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(px.val[c]))), d_hi);
+            px.val[c] = vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi));
+        }
+        vst3q_u8(bgr + 3 * x, px);
+    }
+#endif
+    for (; x < width; x++) {
+        int d = new_luma[x] - luma[x];
+        uint8_t* p = bgr + 3 * x;
+        p[0] = saturate_cast<uint8_t>(p[0] + d);
+        p[1] = saturate_cast<uint8_t>(p[1] + d);
+        p[2] = saturate_cast<uint8_t>(p[2] + d);
+    }
+}
+
+// out = lut0 * (kWeightOne - w) + lut1 * w, for n entries.
+void blendLuts(const uint8_t* lut0, const uint8_t* lut1, int w, uint16_t* out, int n) {
+    int i = 0;
+#if LUMA_CLAHE_NEON
+    const uint8x8_t w0 = vdup_n_u8((uint8_t)(kWeightOne - w));
+    const uint8x8_t w1 = vdup_n_u8((uint8_t)w);
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t a = vld1q_u8(lut0 + i);
+        uint8x16_t b = vld1q_u8(lut1 + i);
+        vst1q_u16(out + i, vmlal_u8(vmull_u8(vget_low_u8(a), w0), vget_low_u8(b), w1));
+        vst1q_u16(out + i + 8, vmlal_u8(vmull_u8(vget_high_u8(a), w0), vget_high_u8(b), w1));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = (uint16_t)(lut0[i] * (kWeightOne - w) + lut1[i] * w);
+    }
+}
+
+} // namespace
+
+LumaClahe::LumaClahe(double clipLimit, Size tiles) : clip_limit(clipLimit), tiles(tiles) {}
+
+void LumaClahe::applyLuma(Mat& luma) {
+    if (luma.empty()) return;
+    computeLuts(luma, false);
+    interpolate(luma, false, luts.data());
+}
+
+void LumaClahe::applyLuma(Mat& luma, TemporalClaheLuts& temporal, int frameIndex) {
+    if (luma.empty()) return;
+    computeTileMeans(luma);
+
+    bool refresh = false;
+    shared_ptr<TemporalClaheLuts::Slot> slot = temporal.decide(frameIndex, tile_means, refresh);
+    if (refresh) {
+        computeLuts(luma, false);
+        temporal.publish(slot, luts);
+    } else {
+        temporal.wait(slot);
+    }
+    interpolate(luma, false, slot->luts.data());
+}
+
+void LumaClahe::applyBgr(Mat& bgr) {
+    if (bgr.empty()) return;
+    computeLuts(bgr, true);
+    interpolate(bgr, true, luts.data());
+}
+
+const uint8_t* LumaClahe::lumaRow(const Mat& image, int y, bool bgr) {
+    if (!bgr) return image.ptr<uint8_t>(y);
+    luma_buf.resize(image.cols);
+    bgrToLuma(image.ptr<uint8_t>(y), luma_buf.data(), image.cols);
+    return luma_buf.data();
+}
+
+void LumaClahe::computeLuts(const Mat& image, bool bgr) {
+    const int tiles_x = tiles.width;
+    const int tiles_y = tiles.height;
+    Size tile = tileSize(image.size(), tiles);
+
+    // Histograms, row by row so a BGR row is converted to luma once for all tiles
+    hist.assign((size_t)tiles_x * tiles_y * kBins, 0);
+    for (int ty = 0; ty < tiles_y; ty++) {
+        for (int r = ty * tile.height; r < (ty + 1) * tile.height; r++) {
+            const uint8_t* row = lumaRow(image, reflect101(r, image.rows), bgr);
+            int* tile_hist = &hist[(size_t)ty * tiles_x * kBins];
+            for (int tx = 0; tx < tiles_x; tx++, tile_hist += kBins) {
+                int c0 = tx * tile.width;
+                int c1 = c0 + tile.width;
+                int inside = std::min(c1, image.cols);
+                for (int c = c0; c < inside; c++) tile_hist[row[c]]++;
+                for (int c = std::max(c0, image.cols); c < c1; c++) {
+                    tile_hist[row[reflect101(c, image.cols)]]++;
+                }
+            }
+        }
+    }
+
+    // Clip, redistribute and integrate, exactly as cv::CLAHE does
+    int tile_area = tile.area();
+    int clip = 0;
+    if (clip_limit > 0.0) clip = std::max(1, (int)(clip_limit * tile_area / kBins));
+    float lut_scale = (float)(kBins - 1) / tile_area;
+
+    luts.resize(hist.size());
+    for (size_t t = 0; t < (size_t)tiles_x * tiles_y; t++) {
+        int* h = &hist[t * kBins];
+        if (clip > 0) {
+            int clipped = 0;
+            for (int i = 0; i < kBins; i++) {
+                if (h[i] > clip) {
+                    clipped += h[i] - clip;
+                    h[i] = clip;
+                }
+            }
+            int batch = clipped / kBins;
+            int residual = clipped - batch * kBins;
+            for (int i = 0; i < kBins; i++) h[i] += batch;
+            if (residual != 0) {
+                int step = std::max(kBins / residual, 1);
+                for (int i = 0; i < kBins && residual > 0; i += step, residual--) h[i]++;
+            }
+        }
+
+        uint8_t* lut = &luts[t * kBins];
+        int sum = 0;
+        for (int i = 0; i < kBins; i++) {
+            sum += h[i];
+            lut[i] = saturate_cast<uint8_t>(sum * lut_scale);
+        }
+    }
+}
+
+void LumaClahe::computeTileMeans(const Mat& luma) {
+    Size tile = tileSize(luma.size(), tiles);
+    size_t n_tiles = (size_t)tiles.width * tiles.height;
+    tile_means.assign(n_tiles, 0.0f);
+    vector<int> counts(n_tiles, 0);
+
+    for (int y = kProbeStep / 2; y < luma.rows; y += kProbeStep) {
+        const uint8_t* row = luma.ptr<uint8_t>(y);
+        int ty = std::min(y / tile.height, tiles.height - 1);
+        for (int x = kProbeStep / 2; x < luma.cols; x += kProbeStep) {
+            int t = ty * tiles.width + std::min(x / tile.width, tiles.width - 1);
+            tile_means[t] += row[x];
+            counts[t]++;
+        }
+    }
+    for (size_t t = 0; t < n_tiles; t++) {
+        if (counts[t] > 0) tile_means[t] /= counts[t];
+    }
+}
+
+void LumaClahe::interpolate(Mat& image, bool bgr, const uint8_t* tile_luts) {
+    const int tiles_x = tiles.width;
+    const int tiles_y = tiles.height;
+    const int width = image.cols;
+    Size tile = tileSize(image.size(), tiles);
+    float inv_tw = 1.0f / tile.width;
+    float inv_th = 1.0f / tile.height;
+
+    // Horizontal neighbours and weight per column, the same for every row
+    col_lut0.resize(width);
+    col_lut1.resize(width);
+    col_weight.resize(width);
+    for (int x = 0; x < width; x++) {
+        float txf = x * inv_tw - 0.5f;
+        int tx0 = cvFloor(txf);
+        float xa = txf - tx0;
+        int tx1 = std::min(tx0 + 1, tiles_x - 1);
+        tx0 = std::max(tx0, 0);
+        col_lut0[x] = tx0 * kBins;
+        col_lut1[x] = tx1 * kBins;
+        col_weight[x] = (uint8_t)cvRound(xa * kWeightOne);
+    }
+
+    row_luts.resize((size_t)tiles_x * kBins);
+    out_buf.resize(width);
+
+    for (int y = 0; y < image.rows; y++) {
+        // Fold the vertical interpolation into one LUT per tile column, so each
+        // pixel needs two lookups instead of four.
+        float tyf = y * inv_th - 0.5f;
+        int ty0 = cvFloor(tyf);
+        float ya = tyf - ty0;
+        int ty1 = std::min(ty0 + 1, tiles_y - 1);
+        ty0 = std::max(ty0, 0);
+        blendLuts(tile_luts + (size_t)ty0 * tiles_x * kBins, tile_luts + (size_t)ty1 * tiles_x * kBins,
+                  cvRound(ya * kWeightOne), row_luts.data(), tiles_x * kBins);
+
+        const uint8_t* luma = lumaRow(image, y, bgr);
+        const uint16_t* rl = row_luts.data();
+        uint8_t* out = bgr ? out_buf.data() : image.ptr<uint8_t>(y);
+        for (int x = 0; x < width; x++) {
+            int v = luma[x];
+            int w = col_weight[x];
+            int sum = rl[col_lut0[x] + v] * (kWeightOne - w) + rl[col_lut1[x] + v] * w;
+            out[x] = (uint8_t)((sum + (1 << 13)) >> 14);
+        }
+        if (bgr) shiftBgrByLuma(image.ptr<uint8_t>(y), luma, out, width);
+    }
+}
+
+TemporalClaheLuts::TemporalClaheLuts(const TemporalClaheParams& params) : params(params) {}
+
+int TemporalClaheLuts::refreshCount() const {
+    lock_guard<mutex> lock(state_mutex);
+    return refreshes;
+}
+
+int TemporalClaheLuts::sceneCutCount() const {
+    lock_guard<mutex> lock(state_mutex);
+    return cuts;
+}
+
+void TemporalClaheLuts::setRefreshInterval(int frames) {
+    lock_guard<mutex> lock(state_mutex);
+    params.refreshInterval = frames;
+}
+
+shared_ptr<TemporalClaheLuts::Slot> TemporalClaheLuts::decide(int index, const vector<float>& means,
+                                                              bool& refresh) {
+    unique_lock<mutex> lock(state_mutex);
+    changed.wait(lock, [&] { return next_index == index; });
+
+    bool cut = false;
+    if (current && means.size() == key_means.size()) {
+        float change = 0;
+        for (size_t t = 0; t < means.size(); t++) change += std::fabs(means[t] - key_means[t]);
+        cut = change / std::max<size_t>(means.size(), 1) > params.sceneCutThreshold;
+    }
+
+    refresh = !current || cut || means.size() != key_means.size()
+              || index - key_index >= std::max(params.refreshInterval, 1);
+    if (refresh) {
+        auto slot = make_shared<Slot>();
+        slot->cut = cut;
+        slot->previous = current;
+        current = slot;
+        key_index = index;
+        key_means = means;
+        refreshes++;
+        if (cut) cuts++;
+    }
+
+    shared_ptr<Slot> slot = current;
+    next_index++;
+    lock.unlock();
+    changed.notify_all();
+    return slot;
+}
+
+void TemporalClaheLuts::publish(const shared_ptr<Slot>& slot, const vector<uint8_t>& fresh) {
+    shared_ptr<Slot> previous = slot->previous;
+    if (previous) wait(previous);
+
+    // Slots are immutable once ready, so the blend runs without the lock.
+    slot->state.resize(fresh.size());
+    slot->luts.resize(fresh.size());
+    bool blend = previous && !slot->cut && previous->state.size() == fresh.size();
+    for (size_t i = 0; i < fresh.size(); i++) {
+        float v = fresh[i];
+        if (blend) v = previous->state[i] + params.blend * (v - previous->state[i]);
+        slot->state[i] = v;
+        slot->luts[i] = saturate_cast<uint8_t>(v);
+    }
+
+    {
+        lock_guard<mutex> lock(state_mutex);
+        slot->ready = true;
+        slot->previous.reset();
+    }
+    changed.notify_all();
+}
+
+void TemporalClaheLuts::wait(const shared_ptr<Slot>& slot) {
+    unique_lock<mutex> lock(state_mutex);
+    changed.wait(lock, [&] { return slot->ready; });
+}
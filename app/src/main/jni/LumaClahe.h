@@ -0,0 +1,118 @@
+#pragma once
+
+#include "NativeCommon.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class TemporalClaheLuts;
+
+// Contrast-limited adaptive histogram equalization of the luma channel only.
+//
+// Same algorithm and parameters as cv::CLAHE (per-tile histograms, clip and
+// redistribute, bilinear interpolation between the four nearest tile LUTs), but
+// fused with the luma extraction and recombination: a BGR frame is read twice
+// (histograms, then interpolation) and written once, with no Lab conversion, no
+// split/merge and no per-frame allocations. An NV12 Y plane is equalized in place.
+//
+// The luma differs from Lab L (BT.601 luma of the gamma-encoded values vs CIE
+// lightness), so BGR output is close to, but not identical to, the Lab-CLAHE path;
+// compareWithLabEnhancement() in Enhancement.h measures the difference.
+//
+// Keeps its buffers between calls, so each thread needs its own instance.
+class LumaClahe {
+public:
+    explicit LumaClahe(double clipLimit = 2.0, cv::Size tiles = cv::Size(8, 8));
+
+    // 8-bit single-channel image (e.g. the Y plane of an NV12 frame), in place.
+    void applyLuma(cv::Mat& luma);
+
+    // Video variant: frame `frameIndex` of the clip `temporal` belongs to. Only
+    // refresh frames build tile histograms; the others reuse the shared LUTs.
+    void applyLuma(cv::Mat& luma, TemporalClaheLuts& temporal, int frameIndex);
+
+    // 8-bit BGR image, in place. Every channel is shifted by the change of the
+    // BT.601 luma, which leaves Cb and Cr unchanged.
+    void applyBgr(cv::Mat& bgr);
+
+private:
+    void computeLuts(const cv::Mat& image, bool bgr);
+    void interpolate(cv::Mat& image, bool bgr, const uint8_t* tile_luts);
+    void computeTileMeans(const cv::Mat& luma);
+    const uint8_t* lumaRow(const cv::Mat& image, int y, bool bgr);
+
+    double clip_limit;
+    cv::Size tiles;
+
+    std::vector<int> hist;            // 256 bins per tile
+    std::vector<uint8_t> luts;        // 256 entries per tile, row-major tile order
+    std::vector<uint16_t> row_luts;   // Per tile column: LUT blended for the current row
+    std::vector<int> col_lut0;        // Per column: offset of the left/right tile
+    std::vector<int> col_lut1;        //   LUT in row_luts
+    std::vector<uint8_t> col_weight;  // Per column: right tile weight, 0..128
+    std::vector<uint8_t> luma_buf;    // BGR only: luma of the current row
+    std::vector<uint8_t> out_buf;     // Equalized luma of the current row
+    std::vector<float> tile_means;    // Sparse per-tile mean luma (scene-cut probe)
+};
+
+struct TemporalClaheParams {
+    // Frames between tile histogram refreshes. 1 = every frame (blending only).
+    int refreshInterval = 8;
+    // Weight of freshly computed LUTs against the running set (exponential blend).
+    float blend = 0.35f;
+    // Mean per-tile luma change (8-bit levels) against the last refresh frame that
+    // counts as a scene cut: the LUTs are refreshed at once and not blended.
+    float sceneCutThreshold = 20.0f;
+};
+
+// Tile LUTs shared by every LumaClahe rendering one clip.
+//
+// Consecutive frames are nearly identical, so recomputing all tile histograms per
+// frame costs time and makes the equalization flicker. Here only every
+// refreshInterval-th frame (or a scene cut) builds new LUTs, which are blended into
+// the running set; the frames in between reuse it.
+//
+// Refresh decisions are made strictly in frame order and each frame renders with
+// the LUTs of the last refresh at or before it, so the output does not depend on
+// which pipeline worker renders which frame. Every frame index from 0 on must be
+// rendered exactly once; a worker blocks until the frames before it are decided.
+class TemporalClaheLuts {
+public:
+    explicit TemporalClaheLuts(const TemporalClaheParams& params = TemporalClaheParams());
+
+    int refreshCount() const;
+    int sceneCutCount() const;
+
+    // Changes TemporalClaheParams::refreshInterval for the frames not yet decided.
+    void setRefreshInterval(int frames);
+
+private:
+    friend class LumaClahe;
+
+    struct Slot {
+        bool ready = false;
+        bool cut = false;
+        std::vector<float> state;            // Blended LUTs, valid once ready
+        std::vector<uint8_t> luts;           // `state` rounded, what frames render with
+        std::shared_ptr<Slot> previous;      // Blended into; dropped once ready
+    };
+
+    // Called for each frame in index order (blocks until it is this frame's turn).
+    // Returns the slot to render with; `refresh` is set if this frame must fill it.
+    std::shared_ptr<Slot> decide(int index, const std::vector<float>& means, bool& refresh);
+    void publish(const std::shared_ptr<Slot>& slot, const std::vector<uint8_t>& fresh);
+    void wait(const std::shared_ptr<Slot>& slot);
+
+    TemporalClaheParams params;
+    mutable std::mutex state_mutex;
+    std::condition_variable changed;
+    int next_index = 0;
+    int key_index = 0;
+    std::vector<float> key_means;
+    std::shared_ptr<Slot> current;
+    int refreshes = 0;
+    int cuts = 0;
+};
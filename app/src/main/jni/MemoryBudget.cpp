@@ -0,0 +1,69 @@
+#define LOG_TAG "MemoryBudget"
+
+#include "MemoryBudget.h"
+#include "NativeCommon.h"
+#include "FramePool.h"
+#include "DirectBufferPool.h"
+#include "MotionEstimator.h"
+
+#include <algorithm>
+#include <atomic>
+
+using namespace std;
+
+namespace {
+
+// Analysis long edge under Critical pressure; still enough texture for KLT.
+const int kCriticalAnalysisLongEdge = 480;
+
+atomic<size_t> budget_bytes{0};
+atomic<int> pressure_level{(int)MemoryPressure::Normal};
+
+} // namespace
+
+void setMemoryBudget(size_t budgetBytes, MemoryPressure pressure) {
+    budget_bytes.store(budgetBytes, memory_order_relaxed);
+    int previous = pressure_level.exchange((int)pressure, memory_order_relaxed);
+    if (previous == (int)pressure) return;
+
+    LOGI("Memory pressure %d -> %d, budget %zu MB, native buffers %zu MB",
+         previous, (int)pressure, budgetBytes / (1024 * 1024), nativeFootprintBytes() / (1024 * 1024));
+    if (pressure == MemoryPressure::Critical) {
+        framePool().trim();
+        directBufferPool().trim();
+    }
+}
+
+size_t memoryBudgetBytes() {
+    return budget_bytes.load(memory_order_relaxed);
+}
+
+MemoryPressure memoryPressure() {
+    return (MemoryPressure)pressure_level.load(memory_order_relaxed);
+}
+
+int framesWithinBudget(size_t frameBytes, int wanted) {
+    size_t budget = memoryBudgetBytes();
+    if (budget == 0 || frameBytes == 0) return wanted;
+    size_t frames = budget / frameBytes;
+    return (int)std::max<size_t>(1, std::min<size_t>(frames, (size_t)wanted));
+}
+
+int analysisLongEdgeWithinBudget(int requested) {
+    switch (memoryPressure()) {
+        case MemoryPressure::Normal:
+            return requested;
+        case MemoryPressure::Moderate:
+            return requested == ANALYSIS_FULL_RES ? ANALYSIS_AUTO : requested;
+        case MemoryPressure::Critical:
+            if (requested > 0) return std::min(requested, kCriticalAnalysisLongEdge);
+            return kCriticalAnalysisLongEdge;
+    }
+    return requested;
+}
+
+size_t nativeFootprintBytes() {
+    const FrameBufferPool& frames = framePool();
+    const DirectBufferPool& buffers = directBufferPool();
+    return frames.liveBytes() + frames.idleBytes() + buffers.liveBytes() + buffers.idleBytes();
+}
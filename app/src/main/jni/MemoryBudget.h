@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Process-wide memory budget for the native engines, pushed from the Kotlin side
+// (MemoryManager.updateMemoryStatus -> NativeBridge.setMemoryBudget).
+//
+// Jobs read it when they start and size their frame buffers to fit: fewer render
+// workers and shallower queues in the two-pass pipeline, a shorter streaming
+// lookahead, a lower analysis resolution under pressure. A running pipeline also
+// throttles its decoder while the pressure is Critical, and entering Critical
+// returns the idle buffers of the frame pool and the direct buffer pool to the heap.
+//
+// Without a budget (the default, and on a host) the engines run unconstrained.
+
+// Values mirror NativeBridge.MEMORY_PRESSURE_* on the Kotlin side.
+enum class MemoryPressure : int {
+    Normal = 0,
+    // Memory is getting tight: avoid full-resolution analysis.
+    Moderate = 1,
+    // The system is about to kill processes: smallest footprint that still works.
+    Critical = 2,
+};
+
+// `budgetBytes` is what one job may spend on frame buffers; 0 removes the budget.
+void setMemoryBudget(size_t budgetBytes, MemoryPressure pressure);
+
+size_t memoryBudgetBytes();
+MemoryPressure memoryPressure();
+
+// How many frames of `frameBytes` fit in the budget (at least 1), or `wanted`
+// when that many fit or no budget is set.
+int framesWithinBudget(size_t frameBytes, int wanted);
+
+// The analysis long edge to use instead of `requested` (ANALYSIS_* or px) at the
+// current pressure: Moderate turns full-resolution analysis into ANALYSIS_AUTO,
+// Critical caps the long edge at 480 px.
+int analysisLongEdgeWithinBudget(int requested);
+
+// Bytes the native engines currently hold in frame buffers and direct buffers, in
+// use plus idle. Reported to Kotlin by NativeBridge.nativeMemoryFootprint().
+size_t nativeFootprintBytes();
@@ -0,0 +1,330 @@
+#define LOG_TAG "MotionAnalysis"
+
+#include "MotionAnalysis.h"
+#include "JobCheckpoint.h"
+#include "TaskScheduler.h"
+#include "ThroughputGovernor.h"
+#include "YuvFrame.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+// Every segment costs one extra seek + decode, so keep them at least ~2 s long.
+const int kMinSegmentFrames = 60;
+const int kMaxAutoSegments = 8;
+
+// Frame 0 has no predecessor
+FrameMotion identityMotion(double timestamp_ms) {
+    return {{0, 0, 0}, 0, timestamp_ms};
+}
+
+FrameMotion toFrameMotion(const MotionEstimate& estimate, double timestamp_ms) {
+    return {estimate.transform, estimate.inliers, timestamp_ms};
+}
+
+void frameDone(ThroughputGovernor* governor) {
+    if (governor) governor->frameDone();
+}
+
+// Decoded frames a segment's decoder may run ahead of its estimation.
+const int kSegmentQueueFrames = 2;
+
+struct SegmentResult {
+    vector<FrameMotion> motion;
+    bool ok = false;
+    double cost_ms = 0;
+    int frames = 0;
+};
+
+struct DecodedFrame {
+    Mat image;
+    double timestamp_ms = 0;
+};
+
+// Pass 1 over frames [first, end) of the clip; end < 0 means "until the stream ends".
+// decode() runs on a decoder thread of its own: the decoder blocks on the codec,
+// which a scheduler task must not. Estimation is sequential within a segment, so the
+// decoded frames are handed to at most one `estimation` task at a time, which drains
+// them and ends when it runs out.
+class SegmentAnalyzer {
+public:
+    SegmentAnalyzer(const MotionAnalysisParams& params, JobControl* control, TaskGroup& estimation,
+                    SegmentResult& out)
+        : params(params), control(control), stats(jobStats(control)), estimation(estimation), out(out) {}
+
+    void decode(const string& inputPath, int first, int end) {
+        TraceScope segment_trace("segment", first);
+        this->first = first;
+        unique_ptr<FrameSource> source = openFrameSource(inputPath, params.backend);
+        if (!source) return;
+
+        int anchor = first == 0 ? 0 : first - 1;
+        if (anchor > 0 && !source->seekToFrame(anchor)) {
+            LOGW("Segment %d: seek failed", first);
+            return;
+        }
+
+        estimator = createMotionEstimator(params.estimator);
+        estimator->setStats(stats);
+        analysis = make_unique<AnalysisStream>(*estimator, params.analysisScale, params.governor, stats);
+
+        // The anchor frame, then frames anchor + 1 .. end - 1
+        int idx = anchor;
+        while (end < 0 || idx < end) {
+            if (jobCancelled(control)) break;
+            DecodedFrame frame;
+            StageTimer decode_timer(stats, StatStage::Decode, idx);
+            if (!source->read(frame.image, &frame.timestamp_ms)) break;
+            decode_timer.stop();
+            if (!push(std::move(frame))) break;
+            idx++;
+        }
+
+        // Wait for the estimation of the frames already decoded.
+        unique_lock<mutex> lock(feed_mutex);
+        drained.wait(lock, [&] { return !estimating && frames.empty(); });
+        lock.unlock();
+
+        // A segment that ends early (frame count overestimated by the container)
+        // would leave a gap in the middle of the trajectory.
+        out.ok = estimated > 0 && !jobCancelled(control) && (end < 0 || idx == end);
+        out.cost_ms = estimator->averageCostMs() * estimator->framesEstimated();
+        out.frames = estimator->framesEstimated();
+    }
+
+private:
+    // Queues a frame for estimation once there is room. False if the job was cancelled.
+    bool push(DecodedFrame&& frame) {
+        unique_lock<mutex> lock(feed_mutex);
+        drained.wait(lock, [&] { return (int)frames.size() < kSegmentQueueFrames || jobCancelled(control); });
+        if (jobCancelled(control)) return false;
+        frames.push_back(std::move(frame));
+        if (estimating) return true;
+        estimating = true;
+        lock.unlock();
+        estimation.run([this] { estimate(); });
+        return true;
+    }
+
+    void estimate() {
+        while (true) {
+            DecodedFrame frame;
+            {
+                lock_guard<mutex> lock(feed_mutex);
+                if (frames.empty()) {
+                    estimating = false;
+                    drained.notify_all();
+                    return;
+                }
+                frame = std::move(frames.front());
+                frames.pop_front();
+            }
+            drained.notify_all();
+            if (!jobCancelled(control)) estimateFrame(frame);
+        }
+    }
+
+    void estimateFrame(const DecodedFrame& frame) {
+        if (estimated++ == 0) {
+            analysis->reset(frame.image);
+            if (first != 0) return; // The anchor was estimated by the previous segment
+            out.motion.push_back(identityMotion(frame.timestamp_ms)); // Frame 0
+        } else {
+            MotionEstimate estimate = analysis->next(frame.image);
+            recordMotionEstimate(stats, estimate);
+            out.motion.push_back(toFrameMotion(estimate, frame.timestamp_ms));
+        }
+        jobAdvance(control);
+        frameDone(params.governor);
+    }
+
+    const MotionAnalysisParams& params;
+    JobControl* control;
+    JobStats* stats;
+    TaskGroup& estimation;
+    SegmentResult& out;
+    int first = 0;
+
+    // Owned by the one estimation task running at a time
+    unique_ptr<MotionEstimator> estimator;
+    unique_ptr<AnalysisStream> analysis;
+    int estimated = 0;
+
+    mutex feed_mutex; // Everything below
+    condition_variable drained;
+    deque<DecodedFrame> frames;
+    bool estimating = false; // A task is draining `frames`
+};
+
+} // namespace
+
+AnalysisStream::AnalysisStream(MotionEstimator& estimator, double analysisScale,
+                               ThroughputGovernor* governor, JobStats* stats)
+    : estimator(estimator), base_scale(analysisScale), scale(analysisScale), governor(governor), stats(stats) {}
+
+void AnalysisStream::reset(const Mat& frame) {
+    applyKnobs(frame);
+    makeAnalysisGray(frame, gray, scale, stats);
+    estimator.reset(gray);
+}
+
+MotionEstimate AnalysisStream::next(const Mat& frame) {
+    makeAnalysisGray(frame, gray, scale, stats);
+    MotionEstimate estimate = estimator.next(gray);
+    estimate.transform = rescaleTransform(estimate.transform, scale);
+
+    // The next pair is estimated at the new resolution, starting from this frame.
+    if (applyKnobs(frame)) {
+        makeAnalysisGray(frame, gray, scale, stats);
+        estimator.reset(gray);
+    }
+    return estimate;
+}
+
+// True if the analysis resolution changed.
+bool AnalysisStream::applyKnobs(const Mat& frame) {
+    if (!governor) return false;
+    estimator.setFeatureScale(governor->featureScale());
+    double wanted = governor->analysisScale(base_scale, nv12Size(frame));
+    if (wanted == scale) return false;
+    scale = wanted;
+    return true;
+}
+
+bool analyzeMotionSequential(FrameSource& source, MotionEstimator& estimator,
+                             double analysisScale, vector<FrameMotion>& motion,
+                             JobControl* control, ThroughputGovernor* governor) {
+    JobStats* stats = jobStats(control);
+    estimator.setStats(stats);
+    AnalysisStream analysis(estimator, analysisScale, governor, stats);
+
+    Mat prev;
+    double timestamp_ms = 0;
+    StageTimer decode_timer(stats, StatStage::Decode);
+    if (!source.read(prev, &timestamp_ms)) {
+        LOGE("First frame is empty");
+        return false;
+    }
+    decode_timer.stop();
+
+    motion.clear();
+    motion.push_back(identityMotion(timestamp_ms)); // Frame 0
+    analysis.reset(prev);
+    jobAdvance(control);
+    frameDone(governor);
+
+    Mat curr;
+    int frame_idx = 1;
+    while(true) {
+        if (jobCancelled(control)) return false;
+        StageTimer frame_decode_timer(stats, StatStage::Decode, frame_idx);
+        if (!source.read(curr, &timestamp_ms)) break;
+        frame_decode_timer.stop();
+
+        MotionEstimate estimate = analysis.next(curr);
+        recordMotionEstimate(stats, estimate);
+        motion.push_back(toFrameMotion(estimate, timestamp_ms));
+        jobAdvance(control);
+        frameDone(governor);
+
+        if (frame_idx % 30 == 0) LOGI("Pass 1: Analyzing frame %d", frame_idx);
+        frame_idx++;
+    }
+    return true;
+}
+
+bool analyzeMotionSegmented(const string& inputPath, int frameCount,
+                            const MotionAnalysisParams& params,
+                            vector<FrameMotion>& motion,
+                            JobControl* control) {
+    motion.clear();
+    if (frameCount <= 0 || params.threads == 1) return false;
+
+    int threads = params.threads;
+    if (threads <= 0) {
+        threads = std::min(taskScheduler().workerCount(), kMaxAutoSegments);
+    }
+    threads = std::min(threads, frameCount / kMinSegmentFrames);
+    if (threads < 2) return false;
+    // Segments decoded at once, each by a decoder thread of its own.
+    const int decoders = threads;
+    int segments = threads;
+    if (params.checkpoint) {
+        // Short segments lose little work to a killed process, and still only
+        // `decoders` of them run at once.
+        segments = params.checkpoint->analysisSegments(std::max(threads, frameCount / kCheckpointPartFrames));
+    }
+
+    // Probe once so an unseekable source does not cost a full wasted parallel pass.
+    {
+        unique_ptr<FrameSource> probe = openFrameSource(inputPath, params.backend);
+        if (!probe || !probe->seekToFrame(frameCount / 2)) {
+            LOGW("Source is not frame-seekable, analyzing sequentially");
+            return false;
+        }
+    }
+
+    int64 start = getTickCount();
+    vector<SegmentResult> results(segments);
+    int segment_len = frameCount / segments;
+
+    // `decoders` threads take the segments in order; only estimation goes to the scheduler.
+    TaskGroup estimation(jobPriority(control));
+    atomic<int> next_segment{0};
+    auto decodeSegments = [&] {
+        traceThreadName("segment decode");
+        TaskPriorityScope decode_priority(jobPriority(control));
+        int k;
+        while ((k = next_segment.fetch_add(1)) < segments && !jobCancelled(control)) {
+            SegmentResult& result = results[k];
+            if (params.checkpoint && params.checkpoint->loadMotionSegment(k, result.motion)) {
+                result.ok = true;
+                jobAdvance(control, (int)result.motion.size());
+                continue;
+            }
+            int first = k * segment_len;
+            // The last segment runs to the real end of the stream, whatever the container claims.
+            int end = (k == segments - 1) ? -1 : first + segment_len;
+            SegmentAnalyzer(params, control, estimation, result).decode(inputPath, first, end);
+            if (params.checkpoint && result.ok && !jobCancelled(control)) {
+                params.checkpoint->saveMotionSegment(k, result.motion);
+            }
+        }
+    };
+    vector<std::thread> decoder_threads;
+    for (int d = 0; d < std::min(decoders, segments); d++) decoder_threads.emplace_back(decodeSegments);
+    for (std::thread& t : decoder_threads) t.join();
+    estimation.wait();
+
+    if (jobCancelled(control)) {
+        LOGI("Pass 1 cancelled");
+        return false;
+    }
+
+    double cost_ms = 0;
+    int frames = 0;
+    for (int k = 0; k < segments; k++) {
+        if (!results[k].ok) {
+            LOGW("Segment %d/%d failed, analyzing sequentially", k + 1, segments);
+            motion.clear();
+            return false;
+        }
+        motion.insert(motion.end(), results[k].motion.begin(), results[k].motion.end());
+        cost_ms += results[k].cost_ms;
+        frames += results[k].frames;
+    }
+
+    double wall_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+    LOGI("Pass 1: %d segments on %d decoder threads, %zu frames in %.0f ms (estimator %.2f ms/frame)",
+         segments, std::min(decoders, segments), motion.size(), wall_ms, frames > 0 ? cost_ms / frames : 0.0);
+    return true;
+}
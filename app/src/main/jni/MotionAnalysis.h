@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MotionEstimator.h"
+#include "JobControl.h"
+#include "VideoIO.h"
+
+#include <string>
+#include <vector>
+
+class JobCheckpoint;
+class ThroughputGovernor;
+
+// Pass 1 of the two-pass stabilizer: the frame-to-frame motion of a whole clip.
+// motion[i] is the motion from frame i-1 to frame i, motion[0] is the identity.
+
+struct FrameMotion {
+    TransformParam transform; // Full-resolution pixels / radians
+    int inliers;              // RANSAC inliers behind the estimate (0 if it failed)
+    double timestamp_ms;      // Presentation time of frame i
+};
+
+// Feeds consecutive NV12 frames to `estimator` at the analysis resolution. With a
+// governor, the estimator's feature count and the resolution follow its knobs; on a
+// resolution change the estimator restarts on the current frame, so every frame
+// pair is still estimated.
+class AnalysisStream {
+public:
+    AnalysisStream(MotionEstimator& estimator, double analysisScale,
+                   ThroughputGovernor* governor = nullptr, JobStats* stats = nullptr);
+
+    void reset(const cv::Mat& frame);
+    // Motion from the previous frame to `frame`, rescaled to full resolution.
+    MotionEstimate next(const cv::Mat& frame);
+
+private:
+    bool applyKnobs(const cv::Mat& frame);
+
+    MotionEstimator& estimator;
+    double base_scale;
+    double scale;
+    ThroughputGovernor* governor;
+    JobStats* stats;
+    cv::Mat gray;
+};
+
+struct MotionAnalysisParams {
+    MotionEstimatorType estimator = MotionEstimatorType::Klt;
+    double analysisScale = 1.0;
+    // Time segments decoded concurrently. 0 = one per scheduler worker (at most 8), 1 = sequential.
+    int threads = 0;
+    // Decoder each segment opens its own source with.
+    CodecBackend backend = CodecBackend::Auto;
+    // If set, finished segments are saved there and a resumed job skips them; the
+    // segments are then kCheckpointPartFrames long (JobCheckpoint.h).
+    JobCheckpoint* checkpoint = nullptr;
+    // If set, every analyzed frame is reported to it and its knobs apply (AnalysisStream).
+    ThroughputGovernor* governor = nullptr;
+};
+
+// Reads `source` from its current position to the end, one frame after the other.
+// Both analyzers report every frame to `control` (and `governor`, if any) and return
+// false once it is cancelled.
+bool analyzeMotionSequential(FrameSource& source, MotionEstimator& estimator,
+                             double analysisScale, std::vector<FrameMotion>& motion,
+                             JobControl* control = nullptr, ThroughputGovernor* governor = nullptr);
+
+// Splits the clip into time segments, each decoded by its own FrameSource. Up to
+// `threads` segments are decoded at once, on dedicated threads since decoding blocks on
+// the codec; their motion estimation runs as TaskScheduler tasks at the job's priority.
+// Segment k > 0 starts by decoding the last frame of segment k - 1, so the boundary
+// pair is estimated like any other pair and the results concatenate directly.
+//
+// Returns false and leaves `motion` empty when segmenting is not possible or not
+// worth it (unknown frame count, short clip, source that cannot seek frame-accurately);
+// the caller should fall back to analyzeMotionSequential() unless the job was cancelled.
+bool analyzeMotionSegmented(const std::string& inputPath, int frameCount,
+                            const MotionAnalysisParams& params,
+                            std::vector<FrameMotion>& motion,
+                            JobControl* control = nullptr);
@@ -0,0 +1,278 @@
+#define LOG_TAG "MotionEstimator"
+
+#include "MotionEstimator.h"
+#include "YuvFrame.h"
+#include "FramePool.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+void MotionEstimator::reset(const Mat& gray) {
+    onReset(gray);
+}
+
+MotionEstimate MotionEstimator::next(const Mat& gray) {
+    int64 start = getTickCount();
+    MotionEstimate estimate = estimateNext(gray);
+    estimate.cost_ms = (getTickCount() - start) * 1000.0 / getTickFrequency();
+
+    frames++;
+    total_cost_ms += estimate.cost_ms;
+    return estimate;
+}
+
+int MotionEstimator::featureBudget(int nominal) const {
+    return std::max(1, (int)std::lround(nominal * feature_scale));
+}
+
+MotionEstimate MotionEstimator::solvePartialAffine(const vector<Point2f>& p_prev,
+                                                   const vector<Point2f>& p_curr,
+                                                   double ransac_threshold,
+                                                   vector<uchar>* inlier_mask) {
+    if (p_prev.size() <= 10) return {{0, 0, 0}, 0, false, 0};
+
+    StageTimer timer(stats, StatStage::Estimate);
+    vector<uchar>& inliers = ransac_inliers;
+    Mat T = estimateAffinePartial2D(p_prev, p_curr, inliers, RANSAC, ransac_threshold);
+    if (T.empty()) return {{0, 0, 0}, 0, false, 0};
+
+    double dx = T.at<double>(0, 2);
+    double dy = T.at<double>(1, 2);
+    double da = atan2(T.at<double>(1, 0), T.at<double>(0, 0));
+    int count = countNonZero(inliers);
+
+    if (inlier_mask) inlier_mask->swap(inliers);
+    return {{dx, dy, da}, count, true, 0, (int)p_prev.size()};
+}
+
+namespace {
+
+// Original estimator: ORB on every frame, cross-checked brute-force matching.
+class OrbMotionEstimator : public MotionEstimator {
+public:
+    // Feature Detector (ORB is fast and robust)
+    OrbMotionEstimator() : detector(ORB::create(kFeatures)), matcher(NORM_HAMMING, true) {
+        // Descriptor count varies per frame; the pool's size classes absorb that.
+        prev_desc.allocator = &framePool();
+        curr_desc.allocator = &framePool();
+    }
+
+    const char* name() const override { return "ORB"; }
+
+protected:
+    void onReset(const Mat& gray) override {
+        StageTimer timer(stats, StatStage::Detect);
+        detector->setMaxFeatures(featureBudget(kFeatures));
+        detector->detectAndCompute(gray, noArray(), prev_kps, prev_desc);
+    }
+
+    MotionEstimate estimateNext(const Mat& gray) override {
+        StageTimer detect_timer(stats, StatStage::Detect);
+        detector->setMaxFeatures(featureBudget(kFeatures));
+        detector->detectAndCompute(gray, noArray(), curr_kps, curr_desc);
+        detect_timer.stop();
+
+        MotionEstimate estimate = match(curr_kps, curr_desc);
+
+        // Swap rather than copy, so both buffers keep their capacity.
+        prev_kps.swap(curr_kps);
+        cv::swap(prev_desc, curr_desc);
+        return estimate;
+    }
+
+private:
+    MotionEstimate match(const vector<KeyPoint>& curr_kps, const Mat& curr_desc) {
+        if (prev_kps.size() <= 20 || curr_kps.size() <= 20 || prev_desc.empty() || curr_desc.empty()) {
+            return {{0, 0, 0}, 0, false, 0};
+        }
+
+        StageTimer match_timer(stats, StatStage::Match);
+        matcher.match(prev_desc, curr_desc, matches);
+
+        // Filter good matches
+        p_prev.clear();
+        p_curr.clear();
+        // Sort matches by distance
+        std::sort(matches.begin(), matches.end());
+        // Keep top 50%
+        int keep = (int)(matches.size() * 0.5);
+
+        for(int i=0; i<keep; i++) {
+             p_prev.push_back(prev_kps[matches[i].queryIdx].pt);
+             p_curr.push_back(curr_kps[matches[i].trainIdx].pt);
+        }
+        match_timer.stop();
+
+        // RANSAC Global Motion Estimation
+        // limit to 5.0 pixel reprojection error
+        return solvePartialAffine(p_prev, p_curr, 5.0);
+    }
+
+    static const int kFeatures = 3000; // Increased features for better lock
+
+    Ptr<ORB> detector;
+    BFMatcher matcher; // Cross-check
+    vector<KeyPoint> prev_kps;
+    Mat prev_desc;
+
+    // Reused between frames
+    vector<KeyPoint> curr_kps;
+    Mat curr_desc;
+    vector<DMatch> matches;
+    vector<Point2f> p_prev, p_curr;
+};
+
+// Sparse pyramidal LK. Corners are tracked from frame to frame and only
+// topped up when RANSAC leaves fewer than `kMinTracks` of them (both track counts
+// scale with the feature budget), so most frames cost one calcOpticalFlowPyrLK
+// call instead of a full ORB detect + match.
+class KltMotionEstimator : public MotionEstimator {
+public:
+    explicit KltMotionEstimator(unique_ptr<MotionEstimator> fallback)
+        : fallback(std::move(fallback)) {}
+
+    const char* name() const override { return "KLT"; }
+
+protected:
+    void onReset(const Mat& gray) override {
+        gray.copyTo(prev_gray);
+        prev_pts.clear();
+        topUpTracks(prev_gray);
+    }
+
+    MotionEstimate estimateNext(const Mat& gray) override {
+        MotionEstimate estimate = {{0, 0, 0}, 0, false, 0};
+        tracked.clear();
+
+        if (!prev_pts.empty()) {
+            StageTimer match_timer(stats, StatStage::Match);
+            calcOpticalFlowPyrLK(prev_gray, gray, prev_pts, curr_pts, status, err,
+                                 Size(21, 21), 3);
+            match_timer.stop();
+
+            p_prev.clear();
+            p_curr.clear();
+            for (size_t k = 0; k < status.size(); k++) {
+                if (status[k]) {
+                    p_prev.push_back(prev_pts[k]);
+                    p_curr.push_back(curr_pts[k]);
+                }
+            }
+
+            // Tighter threshold than ORB: LK points are sub-pixel accurate.
+            estimate = solvePartialAffine(p_prev, p_curr, 3.0, &inliers);
+
+            // Only inliers survive, so points on moving subjects die off quickly.
+            if (estimate.valid) {
+                for (size_t k = 0; k < inliers.size(); k++) {
+                    if (inliers[k]) tracked.push_back(p_curr[k]);
+                }
+            }
+        }
+
+        // Frames LK cannot solve (fast pans, cuts, heavy blur) go through ORB.
+        if (!estimate.valid && fallback) {
+            fallback->setStats(stats);
+            fallback->setFeatureScale(feature_scale);
+            fallback->reset(prev_gray);
+            estimate = fallback->next(gray);
+            fallback_frames++;
+            if (fallback_frames % 30 == 1) {
+                LOGW("KLT lost lock, used ORB fallback (%d frames so far)", fallback_frames);
+            }
+        }
+
+        prev_pts.swap(tracked);
+        gray.copyTo(prev_gray);
+        if ((int)prev_pts.size() < featureBudget(kMinTracks)) {
+            topUpTracks(prev_gray);
+        }
+        return estimate;
+    }
+
+private:
+    void topUpTracks(const Mat& gray) {
+        int wanted = featureBudget(kMaxTracks) - (int)prev_pts.size();
+        if (wanted <= 0) return;
+
+        // Spacing follows the analysis resolution: 20 px at 1080p, 8 px at 640 px.
+        int min_distance = std::max(8, std::max(gray.cols, gray.rows) / 96);
+
+        // Keep new corners away from the surviving tracks.
+        mask.create(gray.size(), CV_8UC1);
+        mask.setTo(Scalar(255));
+        for (const auto& p : prev_pts) {
+            circle(mask, p, min_distance, Scalar(0), FILLED);
+        }
+
+        StageTimer timer(stats, StatStage::Detect);
+        goodFeaturesToTrack(gray, corners, wanted, 0.01, min_distance, mask);
+        prev_pts.insert(prev_pts.end(), corners.begin(), corners.end());
+    }
+
+    static const int kMaxTracks = 400;
+    static const int kMinTracks = 200;
+
+    unique_ptr<MotionEstimator> fallback;
+    int fallback_frames = 0;
+
+    Mat prev_gray;
+    vector<Point2f> prev_pts;
+
+    // Reused between frames
+    vector<Point2f> curr_pts, p_prev, p_curr, tracked, corners;
+    vector<uchar> status, inliers;
+    vector<float> err;
+    Mat mask;
+};
+
+} // namespace
+
+unique_ptr<MotionEstimator> createMotionEstimator(MotionEstimatorType type) {
+    switch (type) {
+        case MotionEstimatorType::Orb:
+            return make_unique<OrbMotionEstimator>();
+        case MotionEstimatorType::Klt:
+        default:
+            return make_unique<KltMotionEstimator>(make_unique<OrbMotionEstimator>());
+    }
+}
+
+void recordMotionEstimate(JobStats* stats, const MotionEstimate& estimate) {
+    if (stats) stats->recordEstimate(estimate.valid, estimate.inliers, estimate.candidates);
+}
+
+double computeAnalysisScale(Size frameSize, int analysisLongEdge) {
+    int long_edge = std::max(frameSize.width, frameSize.height);
+    if (long_edge <= 0 || analysisLongEdge == ANALYSIS_FULL_RES) return 1.0;
+
+    int target = analysisLongEdge;
+    if (analysisLongEdge == ANALYSIS_AUTO || analysisLongEdge < 0) {
+        target = long_edge > 2560 ? 960 : 640;
+    }
+
+    // Never upscale
+    if (target >= long_edge) return 1.0;
+    return (double)target / long_edge;
+}
+
+void makeAnalysisGray(const Mat& nv12, Mat& gray, double scale, JobStats* stats) {
+    StageTimer timer(stats, StatStage::Resize);
+    Mat luma = nv12Luma(nv12);
+    if (scale >= 1.0) {
+        // A copy: the caller keeps `gray` as the previous frame while the source
+        // decodes into the frame buffer again.
+        luma.copyTo(gray);
+        return;
+    }
+    // INTER_AREA averages the dropped pixels, which also suppresses sensor noise.
+    resize(luma, gray, Size(), scale, scale, INTER_AREA);
+}
+
+TransformParam rescaleTransform(const TransformParam& t, double scale) {
+    if (scale >= 1.0) return t;
+    return {t.dx / scale, t.dy / scale, t.da};
+}
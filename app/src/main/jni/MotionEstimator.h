@@ -0,0 +1,107 @@
+#pragma once
+
+#include "NativeCommon.h"
+#include "JobStats.h"
+
+#include <memory>
+#include <vector>
+
+struct TransformParam {
+    double dx;
+    double dy;
+    double da; // angle
+};
+
+// Values mirror NativeBridge.MOTION_ESTIMATOR_* on the Kotlin side.
+enum class MotionEstimatorType : int {
+    // ORB detect + describe on every frame, cross-checked brute-force matching.
+    Orb = 0,
+    // Pyramidal Lucas-Kanade tracking of corners that are only re-detected
+    // when too many tracks are lost. Falls back to ORB for frames it cannot solve.
+    Klt = 1,
+};
+
+struct MotionEstimate {
+    TransformParam transform; // {0, 0, 0} when the estimate failed
+    int inliers;              // RANSAC inliers behind the estimate
+    bool valid;
+    double cost_ms;           // Time spent estimating this frame
+    int candidates = 0;       // Matched / tracked points RANSAC started from
+};
+
+// Global (camera) motion between consecutive grayscale frames.
+// Call reset() with the first frame, then next() with every following frame.
+class MotionEstimator {
+public:
+    virtual ~MotionEstimator() = default;
+
+    virtual const char* name() const = 0;
+
+    void reset(const cv::Mat& gray);
+    MotionEstimate next(const cv::Mat& gray);
+
+    // Detect / match / RANSAC times go to `stats` (may be null).
+    void setStats(JobStats* jobStats) { stats = jobStats; }
+
+    // Fraction (0, 1] of the nominal feature / track count to detect from now on;
+    // ThroughputGovernor lowers it when a job falls behind.
+    void setFeatureScale(double scale) { feature_scale = scale; }
+
+    int framesEstimated() const { return frames; }
+    double averageCostMs() const { return frames > 0 ? total_cost_ms / frames : 0.0; }
+
+protected:
+    virtual void onReset(const cv::Mat& gray) = 0;
+    virtual MotionEstimate estimateNext(const cv::Mat& gray) = 0;
+
+    // Shared by all estimators: similarity transform (translation, rotation,
+    // uniform scale) from matched points with RANSAC.
+    MotionEstimate solvePartialAffine(const std::vector<cv::Point2f>& p_prev,
+                                      const std::vector<cv::Point2f>& p_curr,
+                                      double ransac_threshold,
+                                      std::vector<uchar>* inlier_mask = nullptr);
+
+    // `nominal` scaled by setFeatureScale(), at least 1.
+    int featureBudget(int nominal) const;
+
+    JobStats* stats = nullptr;
+    double feature_scale = 1.0;
+
+private:
+    std::vector<uchar> ransac_inliers; // Reused between frames
+    int frames = 0;
+    double total_cost_ms = 0;
+};
+
+std::unique_ptr<MotionEstimator> createMotionEstimator(MotionEstimatorType type);
+
+// Counts `estimate` into the inlier ratio / dropped estimates of `stats` (may be null).
+void recordMotionEstimate(JobStats* stats, const MotionEstimate& estimate);
+
+// --- Analysis resolution ---
+// Motion only needs three numbers per frame, so it is estimated on a downscaled
+// luma plane and the result is rescaled to full resolution. Values mirror
+// NativeBridge.ANALYSIS_* on the Kotlin side; any positive value is a long edge in px.
+//
+// Accuracy vs speed: a similarity transform scales exactly (rotation is unchanged,
+// translation is divided by the factor), so the only loss is localisation
+// precision. LK tracks to ~0.1 px, which becomes ~0.3 px at 1080p and ~0.6 px at
+// 4K when analyzing at 640 px - below what the 1.35x crop and Gaussian smoothing
+// can show. Pixel cost drops with the square of the factor (~36x fewer pixels
+// for 4K -> 640). Very fine, low-contrast texture is what suffers first; use
+// ANALYSIS_FULL_RES for such clips.
+constexpr int ANALYSIS_FULL_RES = 0;
+constexpr int ANALYSIS_AUTO = -1;
+
+// Factor (<= 1) that maps full-resolution pixels to analysis pixels.
+// ANALYSIS_AUTO uses a 640 px long edge, or 960 px for sources above 2560 px
+// to keep enough detail for the rotation estimate.
+double computeAnalysisScale(cv::Size frameSize, int analysisLongEdge);
+
+// NV12 frame (see YuvFrame.h) -> analysis-resolution grayscale: the Y plane,
+// downscaled. No color conversion; the chroma plane is never read.
+// Timed as StatStage::Resize into `stats` when given.
+void makeAnalysisGray(const cv::Mat& nv12, cv::Mat& gray, double scale, JobStats* stats = nullptr);
+
+// Maps a transform estimated at analysis resolution back to full resolution.
+TransformParam rescaleTransform(const TransformParam& t, double scale);
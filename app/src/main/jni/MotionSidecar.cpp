@@ -0,0 +1,229 @@
+#define LOG_TAG "MotionSidecar"
+
+#include "MotionSidecar.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+
+const char kMagic[4] = {'F', 'M', 'O', 'T'};
+const uint32_t kVersion = 1;
+const size_t kHashSample = 64 * 1024;
+
+struct FileKey {
+    uint64_t size;
+    int64_t mtime_ns;
+    uint64_t content_hash;
+};
+
+struct FrameRecord {
+    float dx;
+    float dy;
+    float da;
+    int32_t inliers;
+    int64_t timestamp_us;
+};
+static_assert(sizeof(FrameRecord) == 24, "sidecar frame record must stay 24 bytes");
+
+uint64_t fnv1a(uint64_t hash, const unsigned char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Hashing a multi-GB 4K clip would cost more than pass 1 saves, so only the head,
+// middle and tail are hashed. Together with size and mtime this catches re-encodes
+// and in-place edits; it is a cache key, not an integrity check.
+bool computeFileKey(const string& path, FileKey& key) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+
+    key.size = (uint64_t)st.st_size;
+    key.mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    uint64_t hash = 14695981039346656037ull;
+    hash = fnv1a(hash, reinterpret_cast<const unsigned char*>(&key.size), sizeof(key.size));
+
+    vector<unsigned char> buf(kHashSample);
+    uint64_t offsets[3] = {0, key.size / 2, key.size > kHashSample ? key.size - kHashSample : 0};
+    for (uint64_t offset : offsets) {
+        if (fseeko(f, (off_t)offset, SEEK_SET) != 0) break;
+        size_t n = fread(buf.data(), 1, buf.size(), f);
+        hash = fnv1a(hash, buf.data(), n);
+    }
+    fclose(f);
+
+    key.content_hash = hash;
+    return true;
+}
+
+template <typename T>
+bool writeValue(FILE* f, const T& value) {
+    return fwrite(&value, sizeof(T), 1, f) == 1;
+}
+
+template <typename T>
+bool readValue(FILE* f, T& value) {
+    return fread(&value, sizeof(T), 1, f) == 1;
+}
+
+bool writeFrames(FILE* f, const vector<FrameMotion>& frames) {
+    vector<FrameRecord> records;
+    records.reserve(frames.size());
+    for (const auto& m : frames) {
+        records.push_back({(float)m.transform.dx, (float)m.transform.dy, (float)m.transform.da,
+                           (int32_t)m.inliers, (int64_t)(m.timestamp_ms * 1000.0)});
+    }
+    return writeValue(f, (uint32_t)frames.size())
+        && fwrite(records.data(), sizeof(FrameRecord), records.size(), f) == records.size();
+}
+
+// Bytes between the read position and the end of `f`, or -1.
+int64_t remainingBytes(FILE* f) {
+    struct stat st;
+    off_t position = ftello(f);
+    if (position < 0 || fstat(fileno(f), &st) != 0) return -1;
+    return (int64_t)st.st_size - position;
+}
+
+bool readFrames(FILE* f, vector<FrameMotion>& frames) {
+    uint32_t count = 0;
+    if (!readValue(f, count)) return false;
+    // A truncated or corrupt count must not turn into a huge allocation.
+    int64_t remaining = remainingBytes(f);
+    if (remaining < 0 || (uint64_t)count * sizeof(FrameRecord) > (uint64_t)remaining) {
+        LOGW("Motion file claims %u frames, more than it holds", count);
+        return false;
+    }
+    vector<FrameRecord> records(count);
+    if (fread(records.data(), sizeof(FrameRecord), count, f) != count) return false;
+
+    frames.clear();
+    frames.reserve(records.size());
+    for (const auto& r : records) {
+        frames.push_back({{r.dx, r.dy, r.da}, r.inliers, r.timestamp_us / 1000.0});
+    }
+    return true;
+}
+
+// Writes through a temp file and renames it over `path`, so readers only ever see
+// a complete file.
+template <typename Write>
+bool writeAtomically(const string& path, Write write) {
+    string tmp_path = path + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = write(f);
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+string motionSidecarPath(const string& inputPath) {
+    return inputPath + ".motion";
+}
+
+bool saveMotionSidecar(const string& inputPath, const MotionSidecar& sidecar) {
+    FileKey key;
+    if (!computeFileKey(inputPath, key)) {
+        LOGW("Cannot stat %s, motion sidecar not written", inputPath.c_str());
+        return false;
+    }
+
+    string path = motionSidecarPath(inputPath);
+    bool ok = writeAtomically(path, [&](FILE* f) {
+        return fwrite(kMagic, 1, sizeof(kMagic), f) == sizeof(kMagic)
+            && writeValue(f, kVersion)
+            && writeValue(f, key.size)
+            && writeValue(f, key.mtime_ns)
+            && writeValue(f, key.content_hash)
+            && writeValue(f, (int32_t)sidecar.estimator)
+            && writeValue(f, (int32_t)sidecar.analysisLongEdge)
+            && writeFrames(f, sidecar.frames);
+    });
+    if (!ok) {
+        LOGW("Failed to write motion sidecar %s", path.c_str());
+        return false;
+    }
+
+    LOGI("Motion sidecar written: %s (%zu frames)", path.c_str(), sidecar.frames.size());
+    return true;
+}
+
+bool loadMotionSidecar(const string& inputPath, MotionSidecar& sidecar) {
+    string path = motionSidecarPath(inputPath);
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    FileKey key;
+    if (!computeFileKey(inputPath, key)) {
+        fclose(f);
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    FileKey stored;
+    int32_t estimator = 0, analysis_long_edge = 0;
+
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+        && memcmp(magic, kMagic, sizeof(kMagic)) == 0
+        && readValue(f, version) && version == kVersion
+        && readValue(f, stored.size)
+        && readValue(f, stored.mtime_ns)
+        && readValue(f, stored.content_hash)
+        && readValue(f, estimator)
+        && readValue(f, analysis_long_edge);
+
+    if (ok && (stored.size != key.size || stored.mtime_ns != key.mtime_ns
+               || stored.content_hash != key.content_hash)) {
+        LOGI("Motion sidecar is stale for %s", inputPath.c_str());
+        ok = false;
+    }
+
+    vector<FrameMotion> frames;
+    ok = ok && readFrames(f, frames);
+    fclose(f);
+
+    if (!ok || frames.empty()) return false;
+
+    sidecar.estimator = (MotionEstimatorType)estimator;
+    sidecar.analysisLongEdge = analysis_long_edge;
+    sidecar.frames = std::move(frames);
+    return true;
+}
+
+bool saveMotionFrames(const string& path, const vector<FrameMotion>& frames) {
+    return writeAtomically(path, [&](FILE* f) {
+        return fwrite(kMagic, 1, sizeof(kMagic), f) == sizeof(kMagic)
+            && writeValue(f, kVersion)
+            && writeFrames(f, frames);
+    });
+}
+
+bool loadMotionFrames(const string& path, vector<FrameMotion>& frames) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char magic[4];
+    uint32_t version = 0;
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+        && memcmp(magic, kMagic, sizeof(kMagic)) == 0
+        && readValue(f, version) && version == kVersion
+        && readFrames(f, frames);
+    fclose(f);
+    return ok && !frames.empty();
+}
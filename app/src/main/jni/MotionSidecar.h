@@ -0,0 +1,36 @@
+#pragma once
+
+#include "MotionAnalysis.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Pass-1 results persisted next to the input ("<input>.motion"), so re-rendering
+// the same clip with another smoothing radius or crop only costs pass 2.
+//
+// Binary layout (little-endian, as on every ABI we ship):
+//   header  "FMOT", u32 version, u64 file size, i64 mtime (ns), u64 content hash,
+//           i32 estimator, i32 analysis long edge, u32 frame count
+//   frames  f32 dx, f32 dy, f32 da, i32 inliers, i64 timestamp (us)   (24 bytes each)
+// float32 keeps per-frame deltas well below 1e-3 px of error for any real frame size.
+struct MotionSidecar {
+    MotionEstimatorType estimator = MotionEstimatorType::Klt;
+    int analysisLongEdge = ANALYSIS_AUTO;
+    std::vector<FrameMotion> frames;
+};
+
+std::string motionSidecarPath(const std::string& inputPath);
+
+// Writes atomically (temp file + rename). Returns false if the input cannot be
+// stat'ed or the sidecar cannot be written; the caller just skips caching then.
+bool saveMotionSidecar(const std::string& inputPath, const MotionSidecar& sidecar);
+
+// Loads the sidecar if it exists and still matches the input's size, mtime and
+// content hash. A stale or corrupt sidecar is treated as missing.
+bool loadMotionSidecar(const std::string& inputPath, MotionSidecar& sidecar);
+
+// Just the frame records, without the input key: pass-1 checkpoints of one job
+// (JobCheckpoint.h), which track the input themselves. Same atomic write.
+bool saveMotionFrames(const std::string& path, const std::vector<FrameMotion>& frames);
+bool loadMotionFrames(const std::string& path, std::vector<FrameMotion>& frames);
@@ -4,504 +4,768 @@
 #include <numeric>
 #include <cmath>
 #include <algorithm>
-#include <android/log.h>
-
-// Disable FP16 optimization in OpenCV headers to avoid NDK NEON issues
-#define CV_FP16 0
-#undef __ARM_NEON
-#undef __ARM_FP16_FORMAT_IEEE
-
-#include <opencv2/opencv.hpp>
-#include <opencv2/video.hpp>
-#include <opencv2/imgproc.hpp>
-#include <opencv2/highgui.hpp>
-#include <opencv2/calib3d.hpp>
-
-#define LOG_TAG "NativeBridge"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#include <functional>
+#include <mutex>
+
+#include <sys/stat.h>
+
+#include "NativeCommon.h"
+#include "MotionEstimator.h"
+#include "VideoStabilizer.h"
+#include "ObjectTracker.h"
+#include "JobControl.h"
+#include "JobRunner.h"
+#include "RenderQueue.h"
+#include "ThroughputGovernor.h"
+#include "Trace.h"
+#include "MemoryBudget.h"
+#include "DirectBufferPool.h"
+#include "Enhancement.h"
+#include "TaskScheduler.h"
 
 using namespace std;
 using namespace cv;
 
-struct TransformParam {
-    double dx;
-    double dy;
-    double da; // angle
-};
+namespace {
 
-struct Trajectory {
-    double x;
-    double y;
-    double a;
-};
+SmootherType toSmootherType(jint smoother) {
+    switch (smoother) {
+        case (jint)SmootherType::Kalman: return SmootherType::Kalman;
+        case (jint)SmootherType::CropConstrained: return SmootherType::CropConstrained;
+        default: return SmootherType::Gaussian;
+    }
+}
 
-// Helper to apply CLAHE for "Smart" enhancement
-void applySmartEnhancement(Mat& frame, Ptr<CLAHE>& clahe) {
-    Mat lab;
-    cvtColor(frame, lab, COLOR_BGR2Lab);
+TaskPriority toTaskPriority(jint priority) {
+    switch (priority) {
+        case (jint)TaskPriority::Interactive: return TaskPriority::Interactive;
+        case (jint)TaskPriority::Capture: return TaskPriority::Capture;
+        default: return TaskPriority::Background;
+    }
+}
 
-    vector<Mat> lab_planes(3);
-    split(lab, lab_planes);
+EnhancementMode toEnhancementMode(jint enhancement) {
+    return enhancement == (jint)EnhancementMode::PerFrame ? EnhancementMode::PerFrame : EnhancementMode::Temporal;
+}
 
-    // Apply CLAHE to L channel
-    clahe->apply(lab_planes[0], lab_planes[0]);
+string toString(JNIEnv* env, jstring jValue) {
+    const char* chars = env->GetStringUTFChars(jValue, 0);
+    string value(chars);
+    env->ReleaseStringUTFChars(jValue, chars);
+    return value;
+}
 
-    merge(lab_planes, lab);
-    cvtColor(lab, frame, COLOR_Lab2BGR);
+StabilizationOptions stabilizationOptions(jint mode, jint estimator, jint analysisLongEdge,
+                                          jint outputLongEdge, jint smoother, jint enhancement,
+                                          jfloat targetFps) {
+    StabilizationOptions options;
+    options.mode = (mode == (jint)StabilizationMode::Streaming)
+        ? StabilizationMode::Streaming
+        : StabilizationMode::TwoPass;
+    options.estimator = (estimator == (jint)MotionEstimatorType::Orb)
+        ? MotionEstimatorType::Orb
+        : MotionEstimatorType::Klt;
+    options.analysisLongEdge = analysisLongEdge;
+    options.outputLongEdge = outputLongEdge;
+    options.smoother = toSmootherType(smoother);
+    options.enhancement = toEnhancementMode(enhancement);
+    options.targetFps = targetFps > 0 ? targetFps : 0;
+    return options;
 }
 
-extern "C" {
+StabilizationOptions gyroStabilizationOptions(JNIEnv* env, jstring gyroLogPath, jdouble timeOffsetMs,
+                                              jdouble focalLengthPx, jint outputLongEdge) {
+    StabilizationOptions options;
+    options.gyroLogPath = toString(env, gyroLogPath);
+    options.gyroTimeOffsetMs = timeOffsetMs;
+    options.focalLengthPx = focalLengthPx;
+    options.outputLongEdge = outputLongEdge;
+    return options;
+}
 
-JNIEXPORT void JNICALL
-Java_com_kashif_folar_utils_NativeBridge_stabilizeVideo(
-    JNIEnv* env,
-    jobject /* this */,
-    jstring jInputPath,
-    jstring jOutputPath) {
+StabilizationOptions renderOptions(jint radius, jdouble scale, jint outputLongEdge, jint smoother,
+                                   jint enhancement) {
+    StabilizationOptions options;
+    if (radius > 0) options.radius = radius;
+    if (scale >= 1.0) options.scale = scale;
+    options.outputLongEdge = outputLongEdge;
+    options.smoother = toSmootherType(smoother);
+    options.enhancement = toEnhancementMode(enhancement);
+    return options;
+}
 
-    const char* inputPath = env->GetStringUTFChars(jInputPath, 0);
-    const char* outputPath = env->GetStringUTFChars(jOutputPath, 0);
+TrackingOptions trackingOptions(jint analysisLongEdge, jint outputLongEdge, jint enhancement) {
+    TrackingOptions options;
+    options.analysisLongEdge = analysisLongEdge;
+    options.outputLongEdge = outputLongEdge;
+    options.enhancement = toEnhancementMode(enhancement);
+    return options;
+}
 
-    LOGI("Starting Super Gimbal Stabilization: %s", inputPath);
+// Native side of a Kotlin NativeJob: the JobControl plus the listener it reports to.
+struct JniJob {
+    JavaVM* vm = nullptr;
+    jobject listener = nullptr; // Global ref, null without a listener
+    jmethodID on_progress = nullptr;
+    jobject completion = nullptr; // Global ref to the NativeJob while a submitted job runs
+    jmethodID on_complete = nullptr;
+    unique_ptr<JobControl> control;
+
+    mutex state_mutex;
+    bool running = false;  // Claimed by NativeJob (beginJobRun) and not yet ended
+    bool blocking = false; // A blocking call is using the job
+    bool released = false; // releaseJob() came while running; whoever ends the run frees it
+};
 
-    VideoCapture cap(inputPath);
-    if (!cap.isOpened()) {
-        LOGE("CRITICAL: Failed to open input video at path: %s", inputPath);
-        env->ReleaseStringUTFChars(jInputPath, inputPath);
-        env->ReleaseStringUTFChars(jOutputPath, outputPath);
-        // TODO: Throw Java Exception
-        return;
-    }
+JobControl* jobControl(jlong handle) {
+    return handle ? reinterpret_cast<JniJob*>(handle)->control.get() : nullptr;
+}
 
-    int n_frames = int(cap.get(CAP_PROP_FRAME_COUNT));
-    int width = int(cap.get(CAP_PROP_FRAME_WIDTH));
-    int height = int(cap.get(CAP_PROP_FRAME_HEIGHT));
-    double fps = cap.get(CAP_PROP_FPS);
+// Progress is reported from whichever thread finished the frame (segmented pass 1
+// runs on native threads), so attach for the call when needed. Rate-limited by
+// JobControl, so the attach cost does not matter.
+void deliverProgress(JniJob* job, const JobProgress& progress) {
+    JNIEnv* env = nullptr;
+    bool attached = false;
+    if (job->vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+        if (job->vm->AttachCurrentThread(&env, nullptr) != JNI_OK) return;
+        attached = true;
+    }
 
-    if (n_frames <= 0) {
-        LOGW("Warning: Frame count is 0 or unreadable, processing until stream ends.");
-        n_frames = 100000; // Arbitrary high limit
+    env->CallVoidMethod(job->listener, job->on_progress, (jint)progress.stage, (jint)progress.frame,
+                        (jint)progress.totalFrames, (jlong)progress.etaMs);
+    if (env->ExceptionCheck()) {
+        // A throwing listener must not unwind through native frames.
+        env->ExceptionDescribe();
+        env->ExceptionClear();
     }
 
-    LOGI("Video Info: %dx%d @ %.2f fps, Frames: %d", width, height, fps, n_frames);
+    if (attached) job->vm->DetachCurrentThread();
+}
 
-    // Ensure dimensions are even to make encoders happy
-    int safe_width = (width % 2 == 0) ? width : width - 1;
-    int safe_height = (height % 2 == 0) ? height : height - 1;
-    Size safeSize(safe_width, safe_height);
+// Without `env` (a thread that could not attach) the global refs leak, the job does not.
+void destroyJob(JNIEnv* env, JniJob* job) {
+    if (env) {
+        if (job->listener) env->DeleteGlobalRef(job->listener);
+        if (job->completion) env->DeleteGlobalRef(job->completion);
+    }
+    delete job;
+}
 
-    // Setup Video Writer - Strict H.264 Requirement with Fallbacks
-    VideoWriter writer;
-    int fourcc;
+// Marks a job no longer running and frees it if releaseJob() came meanwhile.
+// `job` must not be touched after this returns.
+void endJobRun(JNIEnv* env, JniJob* job) {
+    bool release;
+    {
+        lock_guard<mutex> lock(job->state_mutex);
+        job->running = false;
+        release = job->released;
+    }
+    if (release) destroyJob(env, job);
+}
 
-    // 1. Try AVC1 (H.264)
-    LOGI("Attempting avc1 (H.264)...");
-    fourcc = VideoWriter::fourcc('a', 'v', 'c', '1');
-    writer.open(outputPath, fourcc, fps, safeSize);
+bool fileExists(const string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
 
-    // 2. Try H264 (Common alias)
-    if (!writer.isOpened()) {
-        LOGW("avc1 failed, trying H264...");
-        fourcc = VideoWriter::fourcc('H', '2', '6', '4');
-        writer.open(outputPath, fourcc, fps, safeSize);
+// Runs on the job thread once the engine returned: reports the result to
+// NativeJob.onNativeComplete and frees the job if it was released meanwhile.
+void finishJob(JniJob* job, bool succeeded, const string& outputPath) {
+    JobControl& control = *job->control;
+    JobError error = control.outcome(succeeded);
+    string message = error == JobError::None ? "" : control.errorMessage();
+    if (error != JobError::None && message.empty()) message = jobErrorName(error);
+    // A cancelled job may have kept a partial video; failed ones report no output.
+    bool has_output = error == JobError::None || (error == JobError::Cancelled && fileExists(outputPath));
+    LOGI("Job finished (%s): %s", jobErrorName(error), has_output ? outputPath.c_str() : "no output");
+
+    JavaVM* vm = job->vm; // Still needed after endJobRun() may have freed the job
+    JNIEnv* env = nullptr;
+    if (vm->AttachCurrentThread(&env, nullptr) != JNI_OK) {
+        LOGE("Cannot attach job thread, completion of %s is lost", outputPath.c_str());
+        endJobRun(nullptr, job);
+        return;
     }
 
-    // 3. Try mp4v (MPEG-4) - Good compatibility
-    if (!writer.isOpened()) {
-        LOGW("H264 failed, trying mp4v...");
-        fourcc = VideoWriter::fourcc('m', 'p', '4', 'v');
-        writer.open(outputPath, fourcc, fps, safeSize);
+    jstring j_message = env->NewStringUTF(message.c_str());
+    jstring j_output = env->NewStringUTF(has_output ? outputPath.c_str() : "");
+    jstring j_stats = env->NewStringUTF(control.stats().toJson().c_str());
+    env->CallVoidMethod(job->completion, job->on_complete, (jint)error, j_message, j_output, j_stats);
+    if (env->ExceptionCheck()) {
+        // A throwing callback must not unwind through native frames.
+        env->ExceptionDescribe();
+        env->ExceptionClear();
     }
-
-    // 4. Last Resort: MJPG
-    if (!writer.isOpened()) {
-        LOGW("mp4v failed, trying MJPG (Low efficiency)...");
-        fourcc = VideoWriter::fourcc('M', 'J', 'P', 'G');
-        writer.open(outputPath, fourcc, fps, safeSize);
+    env->DeleteLocalRef(j_message);
+    env->DeleteLocalRef(j_output);
+    env->DeleteLocalRef(j_stats);
+
+    {
+        lock_guard<mutex> lock(job->state_mutex);
+        env->DeleteGlobalRef(job->completion);
+        job->completion = nullptr;
     }
+    // Only now, after the callback returned: a close() it triggered (e.g. a coroutine
+    // resumed by the completion) leaves the job to this thread to free.
+    endJobRun(env, job);
+    vm->DetachCurrentThread();
+}
 
-    if (!writer.isOpened()) {
-         LOGE("CRITICAL: Failed to open output writer. File permissions?");
-         cap.release();
-         env->ReleaseStringUTFChars(jInputPath, inputPath);
-         env->ReleaseStringUTFChars(jOutputPath, outputPath);
-         return;
-    }
-    LOGI("Writer opened successfully with codec: %d", fourcc);
-
-    // --- Step 1: Analyze Motion (Feature Matching Pipeline) ---
-    Mat prev, prev_gray;
-    cap >> prev;
-    if (prev.empty()) {
-        LOGE("First frame is empty");
-        cap.release();
-        writer.release();
+// Queues `work` on the job runner for the NativeJob `jJob` and returns at once.
+// Throws IllegalStateException if the job was closed or already run: a JobControl
+// carries exactly one job. NativeJob.claimHandle() marks the job running under the
+// same lock close() takes, so the job cannot be freed between the claim and here.
+void submitJob(JNIEnv* env, jobject jJob, const string& outputPath, function<bool(JobControl*)> work) {
+    jclass cls = env->GetObjectClass(jJob);
+    jmethodID claim = env->GetMethodID(cls, "claimHandle", "()J");
+    jmethodID on_complete = env->GetMethodID(cls, "onNativeComplete",
+                                             "(ILjava/lang/String;Ljava/lang/String;Ljava/lang/String;)V");
+    env->DeleteLocalRef(cls);
+    if (!claim || !on_complete) return; // NoSuchMethodError is pending
+
+    jlong handle = env->CallLongMethod(jJob, claim);
+    if (env->ExceptionCheck()) return;
+    if (!handle) {
+        jclass error = env->FindClass("java/lang/IllegalStateException");
+        env->ThrowNew(error, "NativeJob is closed or was already run");
         return;
     }
-    cvtColor(prev, prev_gray, COLOR_BGR2GRAY);
-
-    vector<TransformParam> transforms;
-    transforms.push_back({0, 0, 0}); // Frame 0
-
-    // Feature Detector (ORB is fast and robust)
-    Ptr<Feature2D> detector = ORB::create(3000); // Increased features for better lock
-    vector<KeyPoint> prev_kps;
-    Mat prev_desc;
-    detector->detectAndCompute(prev_gray, noArray(), prev_kps, prev_desc);
-
-    Mat curr, curr_gray;
-
-    // We need to read all frames to build the full trajectory for global smoothing
-    // But memory is limited on Android. We will process in two passes:
-    // Pass 1: Read video, compute transforms, save transforms.
-    // Pass 2: Re-open video, apply smoothed transforms.
-
-    int frame_idx = 1;
-    while(true) {
-        if (!cap.read(curr)) break;
-        if (curr.empty()) break;
-
-        cvtColor(curr, curr_gray, COLOR_BGR2GRAY);
-
-        vector<KeyPoint> curr_kps;
-        Mat curr_desc;
-        detector->detectAndCompute(curr_gray, noArray(), curr_kps, curr_desc);
-
-        if (prev_kps.size() > 20 && curr_kps.size() > 20 && !prev_desc.empty() && !curr_desc.empty()) {
-            BFMatcher matcher(NORM_HAMMING, true); // Cross-check
-            vector<DMatch> matches;
-            matcher.match(prev_desc, curr_desc, matches);
-
-            // Filter good matches
-            vector<Point2f> p_prev, p_curr;
-            // Sort matches by distance
-            std::sort(matches.begin(), matches.end());
-            // Keep top 50%
-            int keep = (int)(matches.size() * 0.5);
-
-            for(int i=0; i<keep; i++) {
-                 p_prev.push_back(prev_kps[matches[i].queryIdx].pt);
-                 p_curr.push_back(curr_kps[matches[i].trainIdx].pt);
-            }
-
-            if (p_prev.size() > 10) {
-                // RANSAC Global Motion Estimation
-                // limit to 5.0 pixel reprojection error
-                Mat T = estimateAffinePartial2D(p_prev, p_curr, noArray(), RANSAC, 5.0);
-
-                if (!T.empty()) {
-                    double dx = T.at<double>(0, 2);
-                    double dy = T.at<double>(1, 2);
-                    double da = atan2(T.at<double>(1, 0), T.at<double>(0, 0));
-                    transforms.push_back({dx, dy, da});
-                } else {
-                    transforms.push_back({0, 0, 0});
-                }
-            } else {
-                transforms.push_back({0, 0, 0});
-            }
-        } else {
-            transforms.push_back({0, 0, 0});
-        }
 
-        prev_kps = curr_kps;
-        curr_desc.copyTo(prev_desc);
-
-        if (frame_idx % 30 == 0) LOGI("Pass 1: Analyzing frame %d", frame_idx);
-        frame_idx++;
+    JniJob* job = reinterpret_cast<JniJob*>(handle);
+    {
+        lock_guard<mutex> lock(job->state_mutex);
+        job->completion = env->NewGlobalRef(jJob);
+        job->on_complete = on_complete;
     }
+    jobRunner().submit(job->control->priority(), [job, outputPath, work]() {
+        bool ok = work(job->control.get());
+        finishJob(job, ok, outputPath);
+    });
+}
 
-    // --- Step 2: Compute Trajectory ---
-    vector<Trajectory> trajectory;
-    double x = 0, y = 0, a = 0;
+// The job behind the `jobHandle` of a blocking call. The handle comes from
+// NativeJob.withHandle(), which keeps the job marked running until the call has
+// returned, so a NativeJob.close() from another thread cancels it instead of freeing
+// the JobControl the engine still uses. A handle that is not claimed that way, or
+// that a submitted job or another blocking call is using, is refused: ok() is false
+// and an IllegalStateException is pending.
+class BlockingJobScope {
+public:
+    BlockingJobScope(JNIEnv* env, jlong handle) : job(reinterpret_cast<JniJob*>(handle)) {
+        if (!job) return;
+        lock_guard<mutex> lock(job->state_mutex);
+        if (!job->running || job->completion || job->blocking) {
+            job = nullptr;
+            refused = true;
+            jclass error = env->FindClass("java/lang/IllegalStateException");
+            env->ThrowNew(error, "NativeJob handle is only valid for one call inside NativeJob.withHandle");
+            return;
+        }
+        job->blocking = true;
+    }
 
-    for(const auto& t : transforms) {
-        x += t.dx;
-        y += t.dy;
-        a += t.da;
-        trajectory.push_back({x, y, a});
+    ~BlockingJobScope() {
+        if (!job) return;
+        lock_guard<mutex> lock(job->state_mutex);
+        job->blocking = false;
     }
 
-    // --- Step 3: Smooth Trajectory (Super Stable Gimbal Mode) ---
-    vector<Trajectory> smoothed_trajectory;
-    // Radius 90 means ~3 seconds of lookahead/lookbehind at 30fps.
-    // This creates a very "floating" feel.
-    int radius = 90;
-
-    for(size_t i=0; i < trajectory.size(); i++) {
-        double sum_x = 0, sum_y = 0, sum_a = 0;
-        double sum_weight = 0;
-
-        for(int j = -radius; j <= radius; j++) {
-            if(i+j >= 0 && i+j < trajectory.size()) {
-                // Gaussian weight
-                // Sigma = radius / 3 ensures 99% of weight is within radius
-                double sigma = radius / 2.5;
-                double dist = (double)j;
-                double weight = exp(-(dist*dist) / (2.0 * sigma * sigma));
-
-                sum_x += trajectory[i+j].x * weight;
-                sum_y += trajectory[i+j].y * weight;
-                sum_a += trajectory[i+j].a * weight;
-                sum_weight += weight;
-            }
-        }
+    BlockingJobScope(const BlockingJobScope&) = delete;
+    BlockingJobScope& operator=(const BlockingJobScope&) = delete;
 
-        if (sum_weight > 0) {
-            smoothed_trajectory.push_back({sum_x/sum_weight, sum_y/sum_weight, sum_a/sum_weight});
-        } else {
-            smoothed_trajectory.push_back(trajectory[i]);
-        }
-    }
+    bool ok() const { return !refused; }
+    JobControl* control() const { return job ? job->control.get() : nullptr; }
 
-    // --- Step 4: Apply Stabilization & Enhancement ---
-    // Re-open video for Pass 2
-    cap.open(inputPath);
-    if (!cap.isOpened()) {
-        LOGE("Failed to re-open video for pass 2");
-        return;
-    }
+private:
+    JniJob* job;
+    bool refused = false;
+};
 
-    Mat T(2, 3, CV_64F);
-    Mat frame, stabilized;
-
-    // CLAHE for smart enhancement
-    Ptr<CLAHE> clahe = createCLAHE();
-    clahe->setClipLimit(2.0);
-    clahe->setTilesGridSize(Size(8, 8));
-
-    // Dynamic Zoom Strategy
-    // For "Super Stable", we need significant cropping to allow for the frame to shift.
-    // 1.35x zoom provides ~17% buffer on all sides.
-    double scale = 1.35;
-    Mat T_scale = getRotationMatrix2D(Point2f(width/2, height/2), 0, scale);
-    Mat T_scale_3x3 = Mat::eye(3, 3, CV_64F);
-    T_scale.copyTo(T_scale_3x3(Rect(0,0,3,2)));
-
-    int current_frame = 0;
-    while(true) {
-        if (!cap.read(frame)) break;
-        if (frame.empty()) break;
-
-        if (current_frame >= smoothed_trajectory.size()) break;
-
-        // Calculate jitter correction (Smoothed - Actual)
-        // We want to move the frame such that the Actual path becomes the Smoothed path.
-        // Diff = Smoothed - Actual
-        double diff_x = smoothed_trajectory[current_frame].x - trajectory[current_frame].x;
-        double diff_y = smoothed_trajectory[current_frame].y - trajectory[current_frame].y;
-        double diff_a = smoothed_trajectory[current_frame].a - trajectory[current_frame].a;
-
-        // Construct transform matrix
-        T.at<double>(0,0) = cos(diff_a);
-        T.at<double>(0,1) = -sin(diff_a);
-        T.at<double>(1,0) = sin(diff_a);
-        T.at<double>(1,1) = cos(diff_a);
-        T.at<double>(0,2) = diff_x;
-        T.at<double>(1,2) = diff_y;
-
-        // Combine Stabilization and Zoom
-        // T_final = T_scale * T_stabilize
-        Mat T_3x3 = Mat::eye(3, 3, CV_64F);
-        T.copyTo(T_3x3(Rect(0,0,3,2)));
-
-        Mat T_final_3x3 = T_scale_3x3 * T_3x3;
-        Mat T_final = T_final_3x3(Rect(0,0,3,2));
-
-        warpAffine(frame, stabilized, T_final, frame.size());
-
-        // Apply Smart Enhancement
-        applySmartEnhancement(stabilized, clahe);
-
-        // Ensure output matches safe writer dimensions
-        if (stabilized.size() != safeSize) {
-            Mat resized;
-            resize(stabilized, resized, safeSize);
-            writer.write(resized);
-        } else {
-            writer.write(stabilized);
-        }
+// Reports a finished RenderQueue job to the Kotlin RenderQueue. Runs on the job
+// thread, or on the JNI caller's thread for a job cancelled before it started.
+void deliverRenderJobFinished(JavaVM* vm, jobject queue, jmethodID onJobFinished, const string& id,
+                              JobError error, const string& message, const string& outputPath,
+                              const string& statsJson) {
+    JNIEnv* env = nullptr;
+    bool attached = false;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) == JNI_EDETACHED) {
+        if (vm->AttachCurrentThread(&env, nullptr) != JNI_OK) return;
+        attached = true;
+    }
 
-        if (current_frame % 30 == 0) LOGI("Pass 2: Writing frame %d", current_frame);
-        current_frame++;
+    jstring j_id = env->NewStringUTF(id.c_str());
+    jstring j_message = env->NewStringUTF(message.c_str());
+    jstring j_output = env->NewStringUTF(outputPath.c_str());
+    jstring j_stats = env->NewStringUTF(statsJson.c_str());
+    env->CallVoidMethod(queue, onJobFinished, j_id, (jint)error, j_message, j_output, j_stats);
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        env->ExceptionClear();
     }
+    env->DeleteLocalRef(j_id);
+    env->DeleteLocalRef(j_message);
+    env->DeleteLocalRef(j_output);
+    env->DeleteLocalRef(j_stats);
 
-    cap.release();
-    writer.release();
+    if (attached) vm->DetachCurrentThread();
+}
+
+} // namespace
 
-    LOGI("Super Gimbal Stabilization Complete. Output at: %s", outputPath);
+extern "C" {
 
-    env->ReleaseStringUTFChars(jInputPath, inputPath);
-    env->ReleaseStringUTFChars(jOutputPath, outputPath);
+JNIEXPORT jint JNICALL
+JNI_OnLoad(JavaVM* vm, void* /* reserved */) {
+    // Before any OpenCV call, as setParallelForBackend() requires
+    installOpenCvParallelBackend();
+    return JNI_VERSION_1_6;
 }
 
-JNIEXPORT void JNICALL
-Java_com_kashif_folar_utils_NativeBridge_processImage(
+JNIEXPORT jboolean JNICALL
+Java_com_kashif_folar_utils_NativeBridge_stabilizeVideo(
     JNIEnv* env,
     jobject /* this */,
-    jstring jPath) {
-    LOGW("processImage called but implementation is disabled/removed.");
+    jstring jInputPath,
+    jstring jOutputPath,
+    jint jMode,
+    jint jEstimator,
+    jint jAnalysisLongEdge,
+    jint jOutputLongEdge,
+    jint jSmoother,
+    jint jEnhancement,
+    jfloat jTargetFps,
+    jlong jJobHandle) {
+
+    string input = toString(env, jInputPath);
+    StabilizationOptions options =
+        stabilizationOptions(jMode, jEstimator, jAnalysisLongEdge, jOutputLongEdge, jSmoother, jEnhancement,
+                             jTargetFps);
+
+    BlockingJobScope job(env, jJobHandle);
+    if (!job.ok()) return JNI_FALSE;
+    JobControl* control = job.control();
+    if (stabilizeVideoFile(input, toString(env, jOutputPath), options, control)) return JNI_TRUE;
+    if (!jobCancelled(control)) LOGE("Stabilization failed for %s", input.c_str());
+    return JNI_FALSE;
 }
 
-JNIEXPORT void JNICALL
-Java_com_kashif_folar_utils_NativeBridge_trackObjectVideo(
+JNIEXPORT jobject JNICALL
+Java_com_kashif_folar_utils_NativeBridge_submitStabilizeVideo(
     JNIEnv* env,
     jobject /* this */,
+    jobject jJob,
     jstring jInputPath,
-    jstring jOutputPath) {
+    jstring jOutputPath,
+    jint jMode,
+    jint jEstimator,
+    jint jAnalysisLongEdge,
+    jint jOutputLongEdge,
+    jint jSmoother,
+    jint jEnhancement,
+    jfloat jTargetFps) {
+
+    string input = toString(env, jInputPath);
+    string output = toString(env, jOutputPath);
+    StabilizationOptions options =
+        stabilizationOptions(jMode, jEstimator, jAnalysisLongEdge, jOutputLongEdge, jSmoother, jEnhancement,
+                             jTargetFps);
+
+    submitJob(env, jJob, output, [input, output, options](JobControl* control) {
+        return stabilizeVideoFile(input, output, options, control);
+    });
+    return jJob;
+}
 
-    const char* inputPath = env->GetStringUTFChars(jInputPath, 0);
-    const char* outputPath = env->GetStringUTFChars(jOutputPath, 0);
+JNIEXPORT jboolean JNICALL
+Java_com_kashif_folar_utils_NativeBridge_stabilizeVideoWithGyro(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jInputPath,
+    jstring jOutputPath,
+    jstring jGyroLogPath,
+    jdouble jTimeOffsetMs,
+    jdouble jFocalLengthPx,
+    jint jOutputLongEdge,
+    jlong jJobHandle) {
+
+    string input = toString(env, jInputPath);
+    StabilizationOptions options =
+        gyroStabilizationOptions(env, jGyroLogPath, jTimeOffsetMs, jFocalLengthPx, jOutputLongEdge);
+
+    BlockingJobScope job(env, jJobHandle);
+    if (!job.ok()) return JNI_FALSE;
+    JobControl* control = job.control();
+    if (stabilizeVideoFile(input, toString(env, jOutputPath), options, control)) return JNI_TRUE;
+    if (!jobCancelled(control)) LOGE("Gyro stabilization failed for %s", input.c_str());
+    return JNI_FALSE;
+}
 
-    LOGI("Starting Object Lock Tracking: %s", inputPath);
+JNIEXPORT jobject JNICALL
+Java_com_kashif_folar_utils_NativeBridge_submitStabilizeVideoWithGyro(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jJob,
+    jstring jInputPath,
+    jstring jOutputPath,
+    jstring jGyroLogPath,
+    jdouble jTimeOffsetMs,
+    jdouble jFocalLengthPx,
+    jint jOutputLongEdge) {
+
+    string input = toString(env, jInputPath);
+    string output = toString(env, jOutputPath);
+    StabilizationOptions options =
+        gyroStabilizationOptions(env, jGyroLogPath, jTimeOffsetMs, jFocalLengthPx, jOutputLongEdge);
+
+    submitJob(env, jJob, output, [input, output, options](JobControl* control) {
+        return stabilizeVideoFile(input, output, options, control);
+    });
+    return jJob;
+}
 
-    VideoCapture cap(inputPath);
-    if (!cap.isOpened()) {
-        LOGE("Failed to open input video for tracking");
-        env->ReleaseStringUTFChars(jInputPath, inputPath);
-        env->ReleaseStringUTFChars(jOutputPath, outputPath);
-        return;
-    }
+JNIEXPORT jboolean JNICALL
+Java_com_kashif_folar_utils_NativeBridge_renderStabilizedVideo(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jInputPath,
+    jstring jOutputPath,
+    jint jRadius,
+    jdouble jScale,
+    jint jOutputLongEdge,
+    jint jSmoother,
+    jint jEnhancement,
+    jlong jJobHandle) {
+
+    StabilizationOptions options = renderOptions(jRadius, jScale, jOutputLongEdge, jSmoother, jEnhancement);
+    BlockingJobScope job(env, jJobHandle);
+    if (!job.ok()) return JNI_FALSE;
+    return renderFromMotionSidecar(toString(env, jInputPath), toString(env, jOutputPath), options,
+                                   job.control()) ? JNI_TRUE : JNI_FALSE;
+}
 
-    int n_frames = int(cap.get(CAP_PROP_FRAME_COUNT));
-    int width = int(cap.get(CAP_PROP_FRAME_WIDTH));
-    int height = int(cap.get(CAP_PROP_FRAME_HEIGHT));
-    double fps = cap.get(CAP_PROP_FPS);
+JNIEXPORT jobject JNICALL
+Java_com_kashif_folar_utils_NativeBridge_submitRenderStabilizedVideo(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jJob,
+    jstring jInputPath,
+    jstring jOutputPath,
+    jint jRadius,
+    jdouble jScale,
+    jint jOutputLongEdge,
+    jint jSmoother,
+    jint jEnhancement) {
+
+    string input = toString(env, jInputPath);
+    string output = toString(env, jOutputPath);
+    StabilizationOptions options = renderOptions(jRadius, jScale, jOutputLongEdge, jSmoother, jEnhancement);
+
+    submitJob(env, jJob, output, [input, output, options](JobControl* control) {
+        return renderFromMotionSidecar(input, output, options, control);
+    });
+    return jJob;
+}
 
-    // Setup Video Writer (Same robust codec logic)
-    int safe_width = (width % 2 == 0) ? width : width - 1;
-    int safe_height = (height % 2 == 0) ? height : height - 1;
-    Size safeSize(safe_width, safe_height);
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_openRenderQueue(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jDirectory,
+    jobject jQueue) {
+
+    jclass cls = env->GetObjectClass(jQueue);
+    jmethodID on_job_finished = env->GetMethodID(
+        cls, "onJobFinished", "(Ljava/lang/String;ILjava/lang/String;Ljava/lang/String;Ljava/lang/String;)V");
+    env->DeleteLocalRef(cls);
+    if (!on_job_finished) return; // NoSuchMethodError is pending
+
+    JavaVM* vm = nullptr;
+    env->GetJavaVM(&vm);
+    // Lives as long as the queue, i.e. the process.
+    jobject queue = env->NewGlobalRef(jQueue);
+    renderQueue().open(toString(env, jDirectory),
+        [vm, queue, on_job_finished](const string& id, JobError error, const string& message,
+                                     const string& outputPath, const string& statsJson) {
+            deliverRenderJobFinished(vm, queue, on_job_finished, id, error, message, outputPath, statsJson);
+        });
+}
 
-    VideoWriter writer;
-    int fourcc = VideoWriter::fourcc('a', 'v', 'c', '1');
-    writer.open(outputPath, fourcc, fps, safeSize);
+JNIEXPORT jstring JNICALL
+Java_com_kashif_folar_utils_NativeBridge_enqueueStabilization(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jInputPath,
+    jstring jOutputPath,
+    jint jMode,
+    jint jEstimator,
+    jint jAnalysisLongEdge,
+    jint jOutputLongEdge,
+    jint jSmoother,
+    jint jEnhancement,
+    jfloat jTargetFps) {
+
+    RenderJobSpec spec;
+    spec.inputPath = toString(env, jInputPath);
+    spec.outputPath = toString(env, jOutputPath);
+    spec.options = stabilizationOptions(jMode, jEstimator, jAnalysisLongEdge, jOutputLongEdge, jSmoother,
+                                        jEnhancement, jTargetFps);
+    string id = renderQueue().enqueue(spec);
+    return id.empty() ? nullptr : env->NewStringUTF(id.c_str());
+}
 
-    if (!writer.isOpened()) {
-        fourcc = VideoWriter::fourcc('m', 'p', '4', 'v');
-        writer.open(outputPath, fourcc, fps, safeSize);
-    }
-    if (!writer.isOpened()) {
-         LOGE("Failed to open writer for tracking.");
-         cap.release();
-         env->ReleaseStringUTFChars(jInputPath, inputPath);
-         env->ReleaseStringUTFChars(jOutputPath, outputPath);
-         return;
-    }
+JNIEXPORT jboolean JNICALL
+Java_com_kashif_folar_utils_NativeBridge_cancelRenderJob(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jJobId) {
+    return renderQueue().cancel(toString(env, jJobId)) ? JNI_TRUE : JNI_FALSE;
+}
 
-    // --- Object Tracking Logic (Lock-On) ---
-    Mat prev, prev_gray;
-    cap >> prev;
-    if (prev.empty()) return;
-    cvtColor(prev, prev_gray, COLOR_BGR2GRAY);
+JNIEXPORT jstring JNICALL
+Java_com_kashif_folar_utils_NativeBridge_renderQueueJson(
+    JNIEnv* env,
+    jobject /* this */) {
+    return env->NewStringUTF(renderQueue().statusJson().c_str());
+}
 
-    // Initialize tracking on the center subject
-    // We use a central ROI (Region of Interest)
-    Rect roi(width * 0.35, height * 0.35, width * 0.3, height * 0.3);
-    Mat mask = Mat::zeros(prev_gray.size(), CV_8UC1);
-    mask(roi).setTo(255);
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_processImage(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jPath) {
+    LOGW("processImage called but implementation is disabled/removed.");
+}
 
-    vector<Point2f> prev_pts;
-    goodFeaturesToTrack(prev_gray, prev_pts, 200, 0.01, 10, mask);
+JNIEXPORT jboolean JNICALL
+Java_com_kashif_folar_utils_NativeBridge_trackObjectVideo(
+    JNIEnv* env,
+    jobject /* this */,
+    jstring jInputPath,
+    jstring jOutputPath,
+    jint jAnalysisLongEdge,
+    jint jOutputLongEdge,
+    jint jEnhancement,
+    jlong jJobHandle) {
+
+    string input = toString(env, jInputPath);
+    TrackingOptions options = trackingOptions(jAnalysisLongEdge, jOutputLongEdge, jEnhancement);
+
+    BlockingJobScope job(env, jJobHandle);
+    if (!job.ok()) return JNI_FALSE;
+    JobControl* control = job.control();
+    if (trackObjectVideoFile(input, toString(env, jOutputPath), options, control)) return JNI_TRUE;
+    if (!jobCancelled(control)) LOGE("Object tracking failed for %s", input.c_str());
+    return JNI_FALSE;
+}
 
-    // Cumulative camera motion (to compensate)
-    double cum_dx = 0;
-    double cum_dy = 0;
+JNIEXPORT jobject JNICALL
+Java_com_kashif_folar_utils_NativeBridge_submitTrackObjectVideo(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jJob,
+    jstring jInputPath,
+    jstring jOutputPath,
+    jint jAnalysisLongEdge,
+    jint jOutputLongEdge,
+    jint jEnhancement) {
+
+    string input = toString(env, jInputPath);
+    string output = toString(env, jOutputPath);
+    TrackingOptions options = trackingOptions(jAnalysisLongEdge, jOutputLongEdge, jEnhancement);
+
+    submitJob(env, jJob, output, [input, output, options](JobControl* control) {
+        return trackObjectVideoFile(input, output, options, control);
+    });
+    return jJob;
+}
 
-    Mat curr, curr_gray;
-    Mat frame_out;
+JNIEXPORT jlong JNICALL
+Java_com_kashif_folar_utils_NativeBridge_createJob(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jListener,
+    jboolean jKeepPartialOutput,
+    jint jPriority) {
+
+    JniJob* job = new JniJob();
+    env->GetJavaVM(&job->vm);
+
+    JobControl::Listener listener;
+    if (jListener) {
+        job->listener = env->NewGlobalRef(jListener);
+        jclass cls = env->GetObjectClass(jListener);
+        job->on_progress = env->GetMethodID(cls, "onProgress", "(IIIJ)V");
+        env->DeleteLocalRef(cls);
+        if (job->on_progress) {
+            listener = [job](const JobProgress& progress) { deliverProgress(job, progress); };
+        } else {
+            env->ExceptionClear();
+            LOGW("Progress listener has no onProgress(IIIJ)V, progress is not reported");
+        }
+    }
+    job->control = make_unique<JobControl>(listener, jKeepPartialOutput == JNI_TRUE, 250,
+                                           toTaskPriority(jPriority));
+    return reinterpret_cast<jlong>(job);
+}
 
-    // Zoom scale to hide edges (1.4x is aggressive but needed for lock-on)
-    double scale = 1.4;
-    Mat T_scale = getRotationMatrix2D(Point2f(width/2, height/2), 0, scale);
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_cancelJob(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jJobHandle) {
+    if (JobControl* control = jobControl(jJobHandle)) control->cancel();
+}
 
-    Ptr<CLAHE> clahe = createCLAHE();
-    clahe->setClipLimit(2.0);
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_setTracingEnabled(
+    JNIEnv* env,
+    jobject /* this */,
+    jboolean jEnabled) {
+    setTraceEnabled(jEnabled == JNI_TRUE);
+}
 
-    for (int i = 1; i < n_frames; i++) {
-        if (!cap.read(curr)) break;
-        cvtColor(curr, curr_gray, COLOR_BGR2GRAY);
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_setMemoryBudget(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jBudgetBytes,
+    jint jPressure) {
+    MemoryPressure pressure = MemoryPressure::Normal;
+    if (jPressure == (jint)MemoryPressure::Moderate) pressure = MemoryPressure::Moderate;
+    if (jPressure == (jint)MemoryPressure::Critical) pressure = MemoryPressure::Critical;
+    setMemoryBudget(jBudgetBytes > 0 ? (size_t)jBudgetBytes : 0, pressure);
+}
 
-        vector<Point2f> curr_pts;
-        vector<uchar> status;
-        vector<float> err;
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_setThermalStatus(
+    JNIEnv* env,
+    jobject /* this */,
+    jint jStatus) {
+    int status = std::max(0, std::min((int)jStatus, (int)ThermalStatus::Shutdown));
+    setThermalStatus((ThermalStatus)status);
+}
 
-        if (prev_pts.size() > 0) {
-            calcOpticalFlowPyrLK(prev_gray, curr_gray, prev_pts, curr_pts, status, err);
-        }
+JNIEXPORT jlong JNICALL
+Java_com_kashif_folar_utils_NativeBridge_acquireDirectBuffer(
+    JNIEnv* env,
+    jobject /* this */,
+    jint jSize) {
+    if (jSize <= 0) return 0;
+    return (jlong)directBufferPool().acquire((size_t)jSize);
+}
 
-        // Calculate average motion of the tracked object
-        double dx = 0, dy = 0;
-        int count = 0;
-        vector<Point2f> good_new_pts;
-
-        for(size_t k=0; k < status.size(); k++) {
-            if(status[k]) {
-                dx += (curr_pts[k].x - prev_pts[k].x);
-                dy += (curr_pts[k].y - prev_pts[k].y);
-                count++;
-                good_new_pts.push_back(curr_pts[k]);
-            }
-        }
+JNIEXPORT jobject JNICALL
+Java_com_kashif_folar_utils_NativeBridge_wrapDirectBuffer(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jHandle,
+    jint jSize) {
+    DirectBufferPool& pool = directBufferPool();
+    uint32_t handle = (uint32_t)jHandle;
+    if (jSize < 0 || (size_t)jSize > pool.capacity(handle)) return nullptr;
+    return env->NewDirectByteBuffer(pool.data(handle), jSize);
+}
 
-        // If the object moved (dx, dy), the camera must shift (-dx, -dy) to keep it in place.
-        if (count > 0) {
-            dx /= count;
-            dy /= count;
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_releaseDirectBuffer(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jHandle) {
+    directBufferPool().release((uint32_t)jHandle);
+}
 
-            // Accumulate required compensation
-            cum_dx -= dx;
-            cum_dy -= dy;
-        }
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_trimDirectBuffers(
+    JNIEnv* env,
+    jobject /* this */) {
+    directBufferPool().trim();
+}
 
-        // Apply Shift + Zoom
-        // T_final = T_scale * T_shift
-        Mat T_shift = (Mat_<double>(2,3) << 1, 0, cum_dx, 0, 1, cum_dy);
+JNIEXPORT jboolean JNICALL
+Java_com_kashif_folar_utils_NativeBridge_enhanceNv12Buffer(
+    JNIEnv* env,
+    jobject /* this */,
+    jobject jBuffer,
+    jint jWidth,
+    jint jHeight) {
+    uint8_t* data = (uint8_t*)env->GetDirectBufferAddress(jBuffer);
+    jlong capacity = env->GetDirectBufferCapacity(jBuffer);
+    if (!data || jWidth <= 0 || jHeight <= 0 || (jWidth | jHeight) & 1
+        || capacity < (jlong)jWidth * jHeight * 3 / 2) {
+        LOGE("enhanceNv12Buffer: not a direct buffer holding a %dx%d NV12 frame", jWidth, jHeight);
+        return JNI_FALSE;
+    }
 
-        // We can't multiply 2x3 easily, so we expand to 3x3
-        Mat T_scale_3x3 = Mat::eye(3, 3, CV_64F);
-        T_scale.copyTo(T_scale_3x3(Rect(0,0,3,2)));
+    // Wraps the Java-visible memory, so the frame is enhanced where it is.
+    Mat nv12(jHeight * 3 / 2, jWidth, CV_8UC1, data);
+    TaskPriorityScope capture_priority(TaskPriority::Capture);
+    thread_local LumaClahe clahe;
+    applySmartEnhancementLuma(nv12, clahe);
+    return JNI_TRUE;
+}
 
-        Mat T_shift_3x3 = Mat::eye(3, 3, CV_64F);
-        T_shift.copyTo(T_shift_3x3(Rect(0,0,3,2)));
+JNIEXPORT jlong JNICALL
+Java_com_kashif_folar_utils_NativeBridge_nativeMemoryFootprint(
+    JNIEnv* env,
+    jobject /* this */) {
+    return (jlong)nativeFootprintBytes();
+}
 
-        Mat T_final_3x3 = T_scale_3x3 * T_shift_3x3;
-        Mat T_final = T_final_3x3(Rect(0,0,3,2));
+JNIEXPORT jstring JNICALL
+Java_com_kashif_folar_utils_NativeBridge_schedulerStatsJson(
+    JNIEnv* env,
+    jobject /* this */) {
+    return env->NewStringUTF(taskScheduler().statsJson().c_str());
+}
 
-        warpAffine(curr, frame_out, T_final, curr.size());
+JNIEXPORT jstring JNICALL
+Java_com_kashif_folar_utils_NativeBridge_jobStatsJson(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jJobHandle) {
+    JobControl* control = jobControl(jJobHandle);
+    return env->NewStringUTF(control ? control->stats().toJson().c_str() : "{}");
+}
 
-        applySmartEnhancement(frame_out, clahe);
+JNIEXPORT jboolean JNICALL
+Java_com_kashif_folar_utils_NativeBridge_beginJobRun(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jJobHandle) {
+    if (!jJobHandle) return JNI_FALSE;
+    JniJob* job = reinterpret_cast<JniJob*>(jJobHandle);
+    lock_guard<mutex> lock(job->state_mutex);
+    if (job->running || job->released) return JNI_FALSE;
+    job->running = true;
+    return JNI_TRUE;
+}
 
-        if (frame_out.size() != safeSize) {
-            Mat resized;
-            resize(frame_out, resized, safeSize);
-            writer.write(resized);
-        } else {
-            writer.write(frame_out);
-        }
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_endJobRun(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jJobHandle) {
+    if (jJobHandle) endJobRun(env, reinterpret_cast<JniJob*>(jJobHandle));
+}
 
-        // Refresh tracking points if they are lost or drift off screen
-        if (good_new_pts.size() < 30 || i % 30 == 0) {
-             // Re-detect in the center of the shifted frame?
-             // Ideally we want to track the *original* object which might have moved.
-             // But for "Digital Gimbal", we just want to latch onto whatever is in the center NOW.
-             goodFeaturesToTrack(curr_gray, good_new_pts, 200, 0.01, 10, mask);
+JNIEXPORT void JNICALL
+Java_com_kashif_folar_utils_NativeBridge_releaseJob(
+    JNIEnv* env,
+    jobject /* this */,
+    jlong jJobHandle) {
+    if (!jJobHandle) return;
+    JniJob* job = reinterpret_cast<JniJob*>(jJobHandle);
+    {
+        lock_guard<mutex> lock(job->state_mutex);
+        if (job->running) {
+            // Still running (job thread or blocking call): stop it there, endJobRun() frees it.
+            job->released = true;
+            job->control->cancel();
+            return;
         }
-
-        prev_pts = good_new_pts;
-        curr_gray.copyTo(prev_gray);
-
-        if (i % 30 == 0) LOGI("Tracking frame %d", i);
     }
-
-    cap.release();
-    writer.release();
-    LOGI("Object Tracking Complete");
-
-    env->ReleaseStringUTFChars(jInputPath, inputPath);
-    env->ReleaseStringUTFChars(jOutputPath, outputPath);
+    destroyJob(env, job);
 }
 
 }
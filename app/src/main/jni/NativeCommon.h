@@ -0,0 +1,45 @@
+#pragma once
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+#else
+#include <cstdarg>
+#include <cstdio>
+#endif
+
+// Disable FP16 optimization in OpenCV headers to avoid NDK NEON issues
+#define CV_FP16 0
+#undef __ARM_NEON
+#undef __ARM_FP16_FORMAT_IEEE
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/video.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/highgui.hpp>
+#include <opencv2/calib3d.hpp>
+
+// Each translation unit may define its own LOG_TAG before including this header.
+#ifndef LOG_TAG
+#define LOG_TAG "NativeBridge"
+#endif
+
+#if defined(__ANDROID__)
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+// Host builds (folar-core, folar-bench) log to stderr, one line per call so that
+// lines from worker threads do not interleave.
+inline void folarHostLog(char level, const char* tag, const char* format, ...) {
+    char message[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    fprintf(stderr, "%c/%s: %s\n", level, tag, message);
+}
+
+#define LOGI(...) folarHostLog('I', LOG_TAG, __VA_ARGS__)
+#define LOGW(...) folarHostLog('W', LOG_TAG, __VA_ARGS__)
+#define LOGE(...) folarHostLog('E', LOG_TAG, __VA_ARGS__)
+#endif
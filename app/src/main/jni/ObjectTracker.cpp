@@ -0,0 +1,211 @@
+#define LOG_TAG "ObjectTracker"
+
+#include "ObjectTracker.h"
+#include "Enhancement.h"
+#include "GeometricWarp.h"
+#include "MotionEstimator.h"
+#include "FramePool.h"
+#include "MemoryBudget.h"
+
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+bool trackObjectVideoFile(const string& inputPath, const string& outputPath,
+                          const TrackingOptions& options, JobControl* control) {
+    LOGI("Starting Object Lock Tracking: %s", inputPath.c_str());
+    TraceScope job_trace("track");
+    TaskPriorityScope job_priority(jobPriority(control));
+
+    unique_ptr<FrameSource> source = openFrameSource(inputPath, options.codecBackend);
+    if (!source) {
+        LOGE("Failed to open input video for tracking");
+        jobFail(control, JobError::InputUnreadable, "Cannot open " + inputPath);
+        return false;
+    }
+
+    const VideoInfo& info = source->info();
+    int n_frames = info.frameCount;
+    int width = info.width;
+    int height = info.height;
+    double fps = info.fps;
+
+    // Zoom scale to hide edges (1.4x is aggressive but needed for lock-on)
+    WarpGeometry geometry;
+    geometry.sourceSize = Size(width, height);
+    geometry.outputSize = computeOutputSize(geometry.sourceSize, options.outputLongEdge);
+    geometry.zoom = 1.4;
+
+    // Frame 0 only seeds the tracker, so the output starts at input frame 1, and so does its audio.
+    unique_ptr<FrameSink> sink = openFrameSink(outputPath, geometry.outputSize, fps, info.rotationDegrees,
+                                               options.codecBackend, AudioSource{inputPath, 1});
+    if (!sink) {
+         LOGE("Failed to open writer for tracking.");
+         jobFail(control, JobError::OutputUnwritable, "Cannot create " + outputPath);
+         return false;
+    }
+
+    // --- Object Tracking Logic (Lock-On) ---
+    // Points are tracked on a downscaled luma plane; motion is rescaled to full resolution.
+    double analysis_scale =
+        computeAnalysisScale(Size(width, height), analysisLongEdgeWithinBudget(options.analysisLongEdge));
+
+    JobStats* stats = jobStats(control);
+    Mat prev, prev_gray;
+    StageTimer decode_timer(stats, StatStage::Decode, 0);
+    if (!source->read(prev)) {
+        LOGE("First frame is empty");
+        jobFail(control, JobError::InputUnreadable, "No decodable frames in " + inputPath);
+        return false;
+    }
+    decode_timer.stop();
+    makeAnalysisGray(prev, prev_gray, analysis_scale, stats);
+
+    // Initialize tracking on the center subject
+    // We use a central ROI (Region of Interest)
+    int gray_w = prev_gray.cols;
+    int gray_h = prev_gray.rows;
+    Rect roi(gray_w * 0.35, gray_h * 0.35, gray_w * 0.3, gray_h * 0.3);
+    Mat mask = Mat::zeros(prev_gray.size(), CV_8UC1);
+    mask(roi).setTo(255);
+    double min_distance = std::max(3.0, 10 * analysis_scale);
+
+    vector<Point2f> prev_pts;
+    StageTimer detect_timer(stats, StatStage::Detect);
+    goodFeaturesToTrack(prev_gray, prev_pts, 200, 0.01, min_distance, mask);
+    detect_timer.stop();
+
+    // Cumulative camera motion (to compensate)
+    double cum_dx = 0;
+    double cum_dy = 0;
+
+    FramePoolProbe pool_probe; // Declared first: `curr` allocates through it
+    Mat curr, curr_gray;
+    Mat frame_out;
+    curr.allocator = &pool_probe;
+
+    // Reused between frames
+    vector<Point2f> curr_pts, good_new_pts;
+    vector<uchar> status;
+    vector<float> err;
+
+    LumaClahe clahe;
+    unique_ptr<TemporalClaheLuts> enhancement_luts;
+    if (options.enhancement == EnhancementMode::Temporal) enhancement_luts = make_unique<TemporalClaheLuts>();
+
+    jobBeginStage(control, JobStage::Tracking, n_frames);
+    jobAdvance(control); // Frame 0 only seeds the tracker
+    bool write_failed = false;
+
+    for (int i = 1; i < n_frames; i++) {
+        if (jobCancelled(control)) break;
+        StageTimer frame_decode_timer(stats, StatStage::Decode, i);
+        if (!source->read(curr)) break;
+        frame_decode_timer.stop();
+        makeAnalysisGray(curr, curr_gray, analysis_scale, stats);
+
+        status.clear();
+        if (prev_pts.size() > 0) {
+            StageTimer match_timer(stats, StatStage::Match, i);
+            calcOpticalFlowPyrLK(prev_gray, curr_gray, prev_pts, curr_pts, status, err);
+        }
+
+        // Calculate average motion of the tracked object
+        double dx = 0, dy = 0;
+        int count = 0;
+        good_new_pts.clear();
+
+        for(size_t k=0; k < status.size(); k++) {
+            if(status[k]) {
+                dx += (curr_pts[k].x - prev_pts[k].x);
+                dy += (curr_pts[k].y - prev_pts[k].y);
+                count++;
+                good_new_pts.push_back(curr_pts[k]);
+            }
+        }
+
+        // No RANSAC here: every tracked point counts, and a frame without any is dropped.
+        if (stats) stats->recordEstimate(count > 0, count, (int)status.size());
+
+        // If the object moved (dx, dy), the camera must shift (-dx, -dy) to keep it in place.
+        if (count > 0) {
+            dx /= count * analysis_scale;
+            dy /= count * analysis_scale;
+
+            // Accumulate required compensation
+            cum_dx -= dx;
+            cum_dy -= dy;
+        }
+
+        // Apply Shift + Zoom + output sizing in one resampling pass
+        StageTimer warp_timer(stats, StatStage::Warp, i);
+        warpNv12ToOutput(curr, frame_out, geometry, stabilizationTransform(cum_dx, cum_dy, 0));
+        warp_timer.stop();
+
+        // Frame 0 only seeds the tracker, so the written frames are numbered from 1.
+        StageTimer enhance_timer(stats, StatStage::Enhance, i);
+        if (enhancement_luts) {
+            applySmartEnhancementLuma(frame_out, clahe, *enhancement_luts, i - 1);
+        } else {
+            applySmartEnhancementLuma(frame_out, clahe);
+        }
+        enhance_timer.stop();
+
+        StageTimer encode_timer(stats, StatStage::Encode, i);
+        if (!sink->write(frame_out)) {
+            // Every later frame would be tracked, warped and enhanced for nothing.
+            LOGE("Cannot write tracking frame %d", i);
+            jobFail(control, JobError::OutputUnwritable, "Cannot write frame " + to_string(i) + " of " + outputPath);
+            write_failed = true;
+            break;
+        }
+        encode_timer.stop();
+        jobAdvance(control);
+        pool_probe.frame(i);
+
+        // Refresh tracking points if they are lost or drift off screen
+        if (good_new_pts.size() < 30 || i % 30 == 0) {
+             // Re-detect in the center of the shifted frame?
+             // Ideally we want to track the *original* object which might have moved.
+             // But for "Digital Gimbal", we just want to latch onto whatever is in the center NOW.
+             StageTimer redetect_timer(stats, StatStage::Detect);
+             goodFeaturesToTrack(curr_gray, good_new_pts, 200, 0.01, min_distance, mask);
+        }
+
+        prev_pts.swap(good_new_pts);
+        cv::swap(prev_gray, curr_gray);
+
+        if (i % 30 == 0) LOGI("Tracking frame %d", i);
+    }
+
+    StageTimer close_timer(stats, StatStage::Encode);
+    bool finalized = sink->close();
+    close_timer.stop();
+    pool_probe.finish(stats);
+    if (stats) LOGI("Job stats: %s", stats->toJson().c_str());
+
+    if (jobCancelled(control)) {
+        // close() above finalized the container, so a kept partial output plays.
+        if (control->keepPartialOutput()) {
+            LOGI("Tracking cancelled, partial output kept at: %s", outputPath.c_str());
+        } else {
+            LOGI("Tracking cancelled, output removed");
+            remove(outputPath.c_str());
+        }
+        return false;
+    }
+
+    if (write_failed) return false;
+    if (!finalized) {
+        LOGE("Failed to finalize tracking output");
+        jobFail(control, JobError::OutputUnwritable, "Cannot finalize " + outputPath);
+        return false;
+    }
+
+    LOGI("Object Tracking Complete");
+    return true;
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "MotionEstimator.h"
+#include "JobControl.h"
+#include "VideoIO.h"
+#include "Enhancement.h"
+
+#include <string>
+
+struct TrackingOptions {
+    // Long edge (px) the tracked points live on, or ANALYSIS_AUTO / ANALYSIS_FULL_RES.
+    int analysisLongEdge = ANALYSIS_AUTO;
+    // Output long edge in px; 0 keeps the source resolution.
+    int outputLongEdge = 0;
+    // Decoder/encoder for the input and output files. See VideoIO.h.
+    CodecBackend codecBackend = CodecBackend::Auto;
+    // Per-frame or temporally reused CLAHE tile LUTs. See EnhancementMode.
+    EnhancementMode enhancement = EnhancementMode::Temporal;
+};
+
+// Object-lock "digital gimbal": tracks the central subject and shifts every frame
+// so it stays in place. Returns false if the input could not be read, the output
+// could not be written or `control` was cancelled (the output is then handled
+// as in stabilizeVideoFile()).
+bool trackObjectVideoFile(const std::string& inputPath,
+                          const std::string& outputPath,
+                          const TrackingOptions& options,
+                          JobControl* control = nullptr);
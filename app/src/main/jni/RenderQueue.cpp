@@ -0,0 +1,300 @@
+#define LOG_TAG "RenderQueue"
+
+#include "RenderQueue.h"
+#include "JobRunner.h"
+#include "MemoryBudget.h"
+#include "NativeCommon.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <map>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+// Input size and mtime, so a resumed job notices that its input was replaced.
+string inputKey(const string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return "";
+    return to_string((long long)st.st_size) + ":" + to_string((long long)st.st_mtime);
+}
+
+// One "key=value" per line. Values run to the end of the line, so paths may hold '='.
+bool writeSpec(const string& path, const RenderJobSpec& spec, size_t footprintBytes) {
+    const StabilizationOptions& o = spec.options;
+    string text = "input=" + spec.inputPath + "\n"
+        + "output=" + spec.outputPath + "\n"
+        + "inputKey=" + inputKey(spec.inputPath) + "\n"
+        + "footprint=" + to_string(footprintBytes) + "\n"
+        + "mode=" + to_string((int)o.mode) + "\n"
+        + "estimator=" + to_string((int)o.estimator) + "\n"
+        + "analysisLongEdge=" + to_string(o.analysisLongEdge) + "\n"
+        + "outputLongEdge=" + to_string(o.outputLongEdge) + "\n"
+        + "smoother=" + to_string((int)o.smoother) + "\n"
+        + "enhancement=" + to_string((int)o.enhancement) + "\n"
+        + "codecBackend=" + to_string((int)o.codecBackend) + "\n"
+        + "targetFps=" + to_string(o.targetFps) + "\n";
+
+    string tmp_path = path + ".tmp";
+    FILE* f = fopen(tmp_path.c_str(), "w");
+    if (!f) return false;
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok = (fclose(f) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readSpec(const string& path, RenderJobSpec& spec, size_t& footprintBytes, bool& inputChanged) {
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) return false;
+    map<string, string> values;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        string entry(line);
+        if (!entry.empty() && entry.back() == '\n') entry.pop_back();
+        size_t eq = entry.find('=');
+        if (eq != string::npos) values[entry.substr(0, eq)] = entry.substr(eq + 1);
+    }
+    fclose(f);
+    if (values["input"].empty() || values["output"].empty()) return false;
+
+    auto number = [&](const char* key, long long fallback) {
+        auto it = values.find(key);
+        return it == values.end() ? fallback : atoll(it->second.c_str());
+    };
+    spec.inputPath = values["input"];
+    spec.outputPath = values["output"];
+    StabilizationOptions& o = spec.options;
+    o.mode = (StabilizationMode)number("mode", (int)o.mode);
+    o.estimator = (MotionEstimatorType)number("estimator", (int)o.estimator);
+    o.analysisLongEdge = (int)number("analysisLongEdge", o.analysisLongEdge);
+    o.outputLongEdge = (int)number("outputLongEdge", o.outputLongEdge);
+    o.smoother = (SmootherType)number("smoother", (int)o.smoother);
+    o.enhancement = (EnhancementMode)number("enhancement", (int)o.enhancement);
+    o.codecBackend = (CodecBackend)number("codecBackend", (int)o.codecBackend);
+    o.targetFps = values.count("targetFps") ? atof(values["targetFps"].c_str()) : 0.0;
+    footprintBytes = (size_t)number("footprint", 0);
+    inputChanged = values["inputKey"] != inputKey(spec.inputPath);
+    return true;
+}
+
+void removeTree(const string& path) {
+    if (DIR* d = opendir(path.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            string child = path + "/" + name;
+            struct stat st;
+            if (stat(child.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+                removeTree(child);
+            } else {
+                remove(child.c_str());
+            }
+        }
+        closedir(d);
+    }
+    rmdir(path.c_str());
+}
+
+string jsonString(const string& value) {
+    string out = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+void RenderQueue::open(const string& directory, Listener newListener) {
+    lock_guard<mutex> lock(queue_mutex);
+    if (!queue_dir.empty()) return;
+    queue_dir = directory;
+    listener = std::move(newListener);
+    mkdir(queue_dir.c_str(), 0755);
+
+    // Job ids sort in the order the jobs were queued.
+    vector<string> ids;
+    if (DIR* d = opendir(queue_dir.c_str())) {
+        while (dirent* entry = readdir(d)) {
+            string name = entry->d_name;
+            if (name != "." && name != "..") ids.push_back(name);
+        }
+        closedir(d);
+    }
+    sort(ids.begin(), ids.end());
+
+    for (const string& id : ids) {
+        string dir = queue_dir + "/" + id;
+        RenderJobSpec spec;
+        size_t footprint = 0;
+        bool input_changed = false;
+        if (!readSpec(dir + "/job", spec, footprint, input_changed)) {
+            LOGW("Dropping unreadable render job %s", id.c_str());
+            removeTree(dir);
+            continue;
+        }
+        shared_ptr<Job> job = makeJob(id, spec, footprint);
+        if (input_changed) {
+            LOGW("Input of render job %s changed, starting it over", id.c_str());
+            job->checkpoint->clear();
+            job->checkpoint = make_unique<JobCheckpoint>(dir + "/checkpoint");
+        }
+        jobs.push_back(job);
+    }
+    LOGI("Render queue at %s: %zu jobs to resume", queue_dir.c_str(), jobs.size());
+    schedule();
+}
+
+string RenderQueue::enqueue(const RenderJobSpec& spec) {
+    // Before taking the lock: the frame size decides which jobs can run together.
+    size_t footprint = 0;
+    {
+        unique_ptr<FrameSource> probe = openFrameSource(spec.inputPath, spec.options.codecBackend);
+        if (!probe) return "";
+        footprint = stabilizationFootprintBytes(Size(probe->info().width, probe->info().height), spec.options);
+    }
+
+    lock_guard<mutex> lock(queue_mutex);
+    if (queue_dir.empty()) {
+        LOGE("Render queue is not open");
+        return "";
+    }
+    long long now_ms = chrono::duration_cast<chrono::milliseconds>(
+        chrono::system_clock::now().time_since_epoch()).count();
+    char id[32];
+    snprintf(id, sizeof(id), "%013lld-%04d", now_ms, next_sequence++ % 10000);
+
+    string dir = queue_dir + "/" + id;
+    if (mkdir(dir.c_str(), 0755) != 0 || !writeSpec(dir + "/job", spec, footprint)) {
+        LOGE("Cannot persist render job in %s", dir.c_str());
+        removeTree(dir);
+        return "";
+    }
+    jobs.push_back(makeJob(id, spec, footprint));
+    LOGI("Render job %s queued: %s (%zu MB of frames)", id, spec.inputPath.c_str(), footprint / (1024 * 1024));
+    schedule();
+    return id;
+}
+
+bool RenderQueue::cancel(const string& id) {
+    shared_ptr<Job> job;
+    {
+        lock_guard<mutex> lock(queue_mutex);
+        auto it = find_if(jobs.begin(), jobs.end(), [&](const shared_ptr<Job>& j) { return j->id == id; });
+        if (it == jobs.end()) return false;
+        job = *it;
+        if (job->running) {
+            job->control->cancel(); // run() reports it
+            return true;
+        }
+        jobs.erase(it); // Before schedule() can start it
+    }
+    finish(job, JobError::Cancelled, jobErrorName(JobError::Cancelled), "");
+    return true;
+}
+
+string RenderQueue::statusJson() {
+    lock_guard<mutex> lock(queue_mutex);
+    string json = "{\"running\":" + to_string(running) + ",\"jobs\":[";
+    for (size_t i = 0; i < jobs.size(); i++) {
+        const Job& job = *jobs[i];
+        JobProgress progress = job.control->progress();
+        json += string(i ? "," : "") + "{\"id\":" + jsonString(job.id)
+            + ",\"input\":" + jsonString(job.spec.inputPath)
+            + ",\"output\":" + jsonString(job.spec.outputPath)
+            + ",\"state\":\"" + (job.running ? "running" : "queued") + "\""
+            + ",\"stage\":" + to_string((int)progress.stage)
+            + ",\"frame\":" + to_string(progress.frame)
+            + ",\"totalFrames\":" + to_string(progress.totalFrames) + "}";
+    }
+    return json + "]}";
+}
+
+shared_ptr<RenderQueue::Job> RenderQueue::makeJob(const string& id, const RenderJobSpec& spec,
+                                                  size_t footprintBytes) {
+    auto job = make_shared<Job>();
+    job->id = id;
+    job->spec = spec;
+    job->footprint_bytes = footprintBytes;
+    job->control = make_unique<JobControl>(nullptr, false, 250, TaskPriority::Background);
+    job->checkpoint = make_unique<JobCheckpoint>(queue_dir + "/" + id + "/checkpoint");
+    return job;
+}
+
+void RenderQueue::schedule() {
+    // Strictly in queue order: a job that does not fit yet is not overtaken.
+    for (const shared_ptr<Job>& job : jobs) {
+        if (job->running) continue;
+        if (running > 0 && !fitsNext(*job)) break;
+        job->running = true;
+        running++;
+        shared_ptr<Job> started = job;
+        jobRunner().submit(TaskPriority::Background, [this, started] { run(started); });
+    }
+}
+
+bool RenderQueue::fitsNext(const Job& next) const {
+    if (running >= JobRunner::kMaxRunningJobs) return false;
+    if (memoryPressure() != MemoryPressure::Normal) return false;
+    size_t budget = memoryBudgetBytes();
+    if (budget == 0) return true;
+
+    size_t total = next.footprint_bytes;
+    for (const shared_ptr<Job>& job : jobs) {
+        if (job->running) total += job->footprint_bytes;
+    }
+    return total <= budget;
+}
+
+void RenderQueue::run(const shared_ptr<Job>& job) {
+    LOGI("Render job %s started", job->id.c_str());
+    StabilizationOptions options = job->spec.options;
+    options.checkpoint = job->checkpoint.get();
+    bool ok = stabilizeVideoFile(job->spec.inputPath, job->spec.outputPath, options, job->control.get());
+
+    JobError error = job->control->outcome(ok);
+    string message = error == JobError::None ? "" : job->control->errorMessage();
+    if (error != JobError::None && message.empty()) message = jobErrorName(error);
+    finish(job, error, message, error == JobError::None ? job->spec.outputPath : "");
+}
+
+void RenderQueue::finish(const shared_ptr<Job>& job, JobError error, const string& message,
+                         const string& outputPath) {
+    LOGI("Render job %s finished (%s)", job->id.c_str(), jobErrorName(error));
+    // Told before the job is deleted: a process killed in between runs it again
+    // rather than losing its result.
+    if (listener) listener(job->id, error, message, outputPath, job->control->stats().toJson());
+    removeTree(queue_dir + "/" + job->id);
+
+    lock_guard<mutex> lock(queue_mutex);
+    auto it = find(jobs.begin(), jobs.end(), job);
+    if (it != jobs.end()) jobs.erase(it);
+    if (job->running) running--;
+    schedule();
+}
+
+RenderQueue& renderQueue() {
+    static RenderQueue* queue = new RenderQueue();
+    return *queue;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "JobCheckpoint.h"
+#include "JobControl.h"
+#include "VideoStabilizer.h"
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Persistent queue of stabilization renders, for clips long enough to outlive the
+// screen that started them or the process itself.
+//
+// Every job has a directory under the queue directory: "job" holds its spec,
+// written once when it is queued, and "checkpoint/" its JobCheckpoint. open()
+// queues every job it finds there again, oldest first, and each resumes from its
+// checkpoint. A job's directory is deleted once it ended (done, failed or
+// cancelled) and the listener was told.
+//
+// Jobs run on the JobRunner at Background priority. Two run at once while both of
+// their render pipelines fit in the memory budget at Normal pressure, otherwise one
+// after the other; this is decided again whenever a job is queued or ends.
+
+struct RenderJobSpec {
+    std::string inputPath;
+    std::string outputPath;
+    StabilizationOptions options; // `checkpoint` is set by the queue
+};
+
+class RenderQueue {
+public:
+    // Called on the job thread once a job ended. `outputPath` is empty unless the
+    // job wrote a (complete, or kept partial) video.
+    using Listener = std::function<void(const std::string& id, JobError error, const std::string& message,
+                                        const std::string& outputPath, const std::string& statsJson)>;
+
+    // Starts the queue in `directory` and resumes the jobs persisted there. Only the
+    // first call counts.
+    void open(const std::string& directory, Listener listener);
+
+    // Persists the job and schedules it. Returns its id, or "" if the queue is not
+    // open or the job cannot be persisted.
+    std::string enqueue(const RenderJobSpec& spec);
+
+    // A queued job ends at once, a running one within a frame or two. Its checkpoint
+    // is deleted either way. False if there is no such job.
+    bool cancel(const std::string& id);
+
+    // {"running":..,"jobs":[{"id","input","output","state":"queued"|"running",
+    //   "stage","frame","totalFrames"},...]} in queue order.
+    std::string statusJson();
+
+private:
+    friend RenderQueue& renderQueue();
+    RenderQueue() = default;
+
+    struct Job {
+        std::string id;
+        RenderJobSpec spec;
+        size_t footprint_bytes = 0;
+        std::unique_ptr<JobControl> control;
+        std::unique_ptr<JobCheckpoint> checkpoint;
+        bool running = false;
+    };
+
+    void schedule(); // Requires queue_mutex
+    bool fitsNext(const Job& next) const; // Requires queue_mutex
+    void run(const std::shared_ptr<Job>& job);
+    void finish(const std::shared_ptr<Job>& job, JobError error, const std::string& message,
+                const std::string& outputPath);
+    std::shared_ptr<Job> makeJob(const std::string& id, const RenderJobSpec& spec, size_t footprintBytes);
+
+    std::mutex queue_mutex;
+    std::string queue_dir; // Empty until open()
+    Listener listener;
+    std::deque<std::shared_ptr<Job>> jobs;
+    int running = 0;
+    int next_sequence = 0;
+};
+
+// Process-wide queue, never destroyed.
+RenderQueue& renderQueue();
@@ -0,0 +1,378 @@
+#define LOG_TAG "TaskScheduler"
+
+#include "TaskScheduler.h"
+#include "NativeCommon.h"
+#include "Trace.h"
+
+#include <opencv2/core/parallel/parallel_backend.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+int64_t nowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+thread_local int tls_worker = -1;
+thread_local int tls_task_depth = 0;
+thread_local TaskPriority tls_priority = TaskPriority::Interactive;
+thread_local int tls_opencv_threads = 0; // 0 = all workers
+
+// CPUs above the slowest cluster, or empty on a homogeneous (or unreadable) CPU.
+vector<int> bigCores() {
+    vector<int> big;
+#if defined(__linux__)
+    int cpus = (int)std::thread::hardware_concurrency();
+    vector<pair<int, long>> freqs;
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        ifstream file("/sys/devices/system/cpu/cpu" + to_string(cpu) + "/cpufreq/cpuinfo_max_freq");
+        long khz = 0;
+        if (file >> khz) freqs.emplace_back(cpu, khz);
+    }
+    if (freqs.size() < 2) return big;
+    long slowest = freqs[0].second;
+    for (const auto& f : freqs) slowest = std::min(slowest, f.second);
+    for (const auto& f : freqs) {
+        if (f.second > slowest) big.push_back(f.first);
+    }
+#endif
+    return big;
+}
+
+void pinCurrentThread(const vector<int>& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) LOGW("Cannot pin worker to big cores");
+#endif
+}
+
+// One cv::parallel_for_ call: stripes are claimed one at a time by the caller and by
+// up to `threads - 1` helper tasks. Helpers that start after the last stripe was
+// claimed do nothing, so the loop may return before they run.
+struct ParallelLoop {
+    cv::parallel::ParallelForAPI::FN_parallel_for_body_cb_t body;
+    void* data;
+    int stripes;
+    atomic<int> next{0};
+    mutex state_mutex;
+    condition_variable finished;
+    int done = 0;
+
+    void work() {
+        int claimed = 0;
+        for (int i; (i = next.fetch_add(1, memory_order_relaxed)) < stripes;) {
+            body(i, i + 1, data);
+            claimed++;
+        }
+        if (claimed == 0) return;
+        lock_guard<mutex> lock(state_mutex);
+        done += claimed;
+        if (done == stripes) finished.notify_all();
+    }
+};
+
+class SchedulerParallelFor : public cv::parallel::ParallelForAPI {
+public:
+    void parallel_for(int tasks, FN_parallel_for_body_cb_t body_callback, void* callback_data) override {
+        int threads = std::min(currentOpenCvThreads(), thread_cap.load(memory_order_relaxed));
+        if (tasks <= 1 || threads <= 1) {
+            body_callback(0, tasks, callback_data);
+            return;
+        }
+
+        auto loop = make_shared<ParallelLoop>();
+        loop->body = body_callback;
+        loop->data = callback_data;
+        loop->stripes = tasks;
+
+        TaskScheduler& scheduler = taskScheduler();
+        TaskPriority priority = currentTaskPriority();
+        int helpers = std::min(threads, tasks) - 1;
+        for (int i = 0; i < helpers; i++) {
+            scheduler.submit(priority, 1, [loop] { loop->work(); });
+        }
+        loop->work();
+
+        unique_lock<mutex> lock(loop->state_mutex);
+        loop->finished.wait(lock, [&] { return loop->done == loop->stripes; });
+    }
+
+    // Workers are 1..n, any other thread is 0.
+    int getThreadNum() const override { return TaskScheduler::currentWorker() + 1; }
+    int getNumThreads() const override { return taskScheduler().workerCount() + 1; }
+
+    // Caps every parallel loop (cv::setNumThreads); 0 or 1 runs them inline.
+    int setNumThreads(int nThreads) override {
+        int cap = nThreads < 0 ? taskScheduler().workerCount() + 1 : std::max(1, nThreads);
+        return thread_cap.exchange(cap, memory_order_relaxed);
+    }
+
+    const char* getName() const override { return "folar"; }
+
+private:
+    atomic<int> thread_cap{taskScheduler().workerCount() + 1};
+};
+
+} // namespace
+
+const char* taskPriorityName(TaskPriority priority) {
+    switch (priority) {
+        case TaskPriority::Interactive: return "interactive";
+        case TaskPriority::Capture: return "capture";
+        case TaskPriority::Background: return "background";
+    }
+    return "unknown";
+}
+
+TaskScheduler::TaskScheduler() {
+    int count = std::max(1, (int)std::thread::hardware_concurrency());
+    vector<int> big = bigCores();
+    if (big.size() >= 2) {
+        pinned_cpus = big;
+        count = (int)big.size();
+    }
+    count = std::max(2, count);
+    stats_start_ns = nowNs();
+
+    for (int i = 0; i < count; i++) workers.push_back(make_unique<Worker>());
+    for (int i = 0; i < count; i++) workers[i]->thread = std::thread(&TaskScheduler::workerLoop, this, i);
+
+    if (pinned_cpus.empty()) {
+        LOGI("%d workers", count);
+    } else {
+        LOGI("%d workers pinned to the %zu big cores", count, pinned_cpus.size());
+    }
+}
+
+int TaskScheduler::workerCount() const {
+    return (int)workers.size();
+}
+
+int TaskScheduler::currentWorker() {
+    return tls_worker;
+}
+
+void TaskScheduler::submit(TaskPriority priority, int openCvThreads, Task task) {
+    int p = (int)priority;
+    QueuedTask queued_task{std::move(task), priority, openCvThreads};
+    if (tls_worker >= 0) {
+        // Tasks spawned by a task stay on its worker (hot caches) unless stolen.
+        Worker& worker = *workers[tls_worker];
+        lock_guard<mutex> lock(worker.queue_mutex);
+        worker.queues[p].push_back(std::move(queued_task));
+    } else {
+        lock_guard<mutex> lock(shared_mutex);
+        shared_queues[p].push_back(std::move(queued_task));
+    }
+
+    {
+        // Under the idle lock, so a worker cannot check the counts and then miss the wakeup.
+        lock_guard<mutex> lock(idle_mutex);
+        queued[p].fetch_add(1, memory_order_relaxed);
+        queued_total.fetch_add(1, memory_order_relaxed);
+    }
+    work_available.notify_one();
+    if (priority != TaskPriority::Background) urgent_available.notify_one();
+}
+
+bool TaskScheduler::takeTask(int index, QueuedTask& task) {
+    int n = (int)workers.size();
+    for (int p = 0; p < kTaskPriorities; p++) {
+        if (index == 0 && p == (int)TaskPriority::Background) break;
+        if (queued[p].load(memory_order_relaxed) <= 0) continue;
+
+        auto take = [&](deque<QueuedTask>& queue, bool back) {
+            if (queue.empty()) return false;
+            task = std::move(back ? queue.back() : queue.front());
+            if (back) {
+                queue.pop_back();
+            } else {
+                queue.pop_front();
+            }
+            queued[p].fetch_sub(1, memory_order_relaxed);
+            queued_total.fetch_sub(1, memory_order_relaxed);
+            return true;
+        };
+
+        {
+            Worker& own = *workers[index];
+            lock_guard<mutex> lock(own.queue_mutex);
+            if (take(own.queues[p], true)) return true;
+        }
+        {
+            lock_guard<mutex> lock(shared_mutex);
+            if (take(shared_queues[p], false)) return true;
+        }
+        for (int k = 1; k < n; k++) {
+            Worker& victim = *workers[(index + k) % n];
+            lock_guard<mutex> lock(victim.queue_mutex);
+            if (take(victim.queues[p], false)) {
+                steals.fetch_add(1, memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::execute(int index, QueuedTask& task) {
+    TaskPriority saved_priority = tls_priority;
+    int saved_threads = tls_opencv_threads;
+    tls_priority = task.priority;
+    tls_opencv_threads = task.opencv_threads;
+
+    // Tasks run while a TaskGroup waits inside another task count only once.
+    int64_t start = tls_task_depth++ == 0 ? nowNs() : 0;
+    task.run();
+    task.run = nullptr;
+    if (--tls_task_depth == 0) workers[index]->busy_ns.fetch_add(nowNs() - start, memory_order_relaxed);
+    executed[(int)task.priority].fetch_add(1, memory_order_relaxed);
+
+    tls_priority = saved_priority;
+    tls_opencv_threads = saved_threads;
+}
+
+void TaskScheduler::workerLoop(int index) {
+    tls_worker = index;
+    char name[16];
+    snprintf(name, sizeof(name), "task-%d", index);
+    traceThreadName(name);
+    if (!pinned_cpus.empty()) pinCurrentThread(pinned_cpus);
+
+    const int background = (int)TaskPriority::Background;
+    QueuedTask task;
+    while (true) {
+        if (takeTask(index, task)) {
+            execute(index, task);
+            continue;
+        }
+        unique_lock<mutex> lock(idle_mutex);
+        if (index == 0) {
+            urgent_available.wait(lock, [&] {
+                return queued_total.load(memory_order_relaxed) - queued[background].load(memory_order_relaxed) > 0;
+            });
+        } else {
+            work_available.wait(lock, [&] { return queued_total.load(memory_order_relaxed) > 0; });
+        }
+    }
+}
+
+bool TaskScheduler::runPendingTask() {
+    if (tls_worker < 0) return false;
+    QueuedTask task;
+    if (!takeTask(tls_worker, task)) return false;
+    execute(tls_worker, task);
+    return true;
+}
+
+string TaskScheduler::statsJson() {
+    lock_guard<mutex> lock(stats_mutex);
+    int64_t now = nowNs();
+    int64_t busy = 0;
+    for (const auto& worker : workers) busy += worker->busy_ns.load(memory_order_relaxed);
+    double window = (double)(now - stats_start_ns) * workers.size();
+    double utilization = window > 0 ? std::min(1.0, (busy - stats_busy_ns) / window) : 0.0;
+    stats_start_ns = now;
+    stats_busy_ns = busy;
+
+    string json = "{\"workers\":" + to_string(workers.size()) + ",\"pinnedCpus\":[";
+    for (size_t i = 0; i < pinned_cpus.size(); i++) {
+        json += (i ? "," : "") + to_string(pinned_cpus[i]);
+    }
+    char numbers[96];
+    snprintf(numbers, sizeof(numbers), "],\"utilization\":%.3f,\"busyMs\":%.1f,\"steals\":%lld",
+             utilization, busy / 1e6, (long long)steals.load(memory_order_relaxed));
+    json += numbers;
+    for (int pass = 0; pass < 2; pass++) {
+        json += pass == 0 ? ",\"queued\":{" : ",\"executed\":{";
+        for (int p = 0; p < kTaskPriorities; p++) {
+            long long value = pass == 0 ? std::max(0, queued[p].load(memory_order_relaxed))
+                                        : (long long)executed[p].load(memory_order_relaxed);
+            json += string(p ? "," : "") + "\"" + taskPriorityName((TaskPriority)p) + "\":" + to_string(value);
+        }
+        json += "}";
+    }
+    return json + "}";
+}
+
+TaskScheduler& taskScheduler() {
+    static TaskScheduler* scheduler = new TaskScheduler();
+    return *scheduler;
+}
+
+TaskGroup::TaskGroup(TaskPriority priority, int openCvThreads)
+    : group_priority(priority), opencv_threads(std::max(1, openCvThreads)) {}
+
+void TaskGroup::run(function<void()> task) {
+    {
+        lock_guard<mutex> lock(state_mutex);
+        pending++;
+    }
+    taskScheduler().submit(group_priority, opencv_threads, [this, task = std::move(task)] {
+        task();
+        // Notify under the lock: once it is released, wait() may return and destroy the group.
+        lock_guard<mutex> lock(state_mutex);
+        if (--pending == 0) finished.notify_all();
+    });
+}
+
+void TaskGroup::wait() {
+    TaskScheduler& scheduler = taskScheduler();
+    unique_lock<mutex> lock(state_mutex);
+    while (pending > 0) {
+        // A worker keeps working instead of blocking, so waiting from a task cannot
+        // starve the pool.
+        lock.unlock();
+        bool ran = scheduler.runPendingTask();
+        lock.lock();
+        if (ran) continue;
+        if (TaskScheduler::currentWorker() < 0) {
+            finished.wait(lock, [&] { return pending == 0; });
+        } else {
+            finished.wait_for(lock, chrono::milliseconds(1), [&] { return pending == 0; });
+        }
+    }
+}
+
+TaskPriorityScope::TaskPriorityScope(TaskPriority priority, int openCvThreads)
+    : previous_priority(tls_priority), previous_threads(tls_opencv_threads) {
+    if (openCvThreads <= 0) {
+        int workers = taskScheduler().workerCount();
+        openCvThreads = priority == TaskPriority::Background ? std::max(1, workers / 2) : workers;
+    }
+    tls_priority = priority;
+    tls_opencv_threads = openCvThreads;
+}
+
+TaskPriorityScope::~TaskPriorityScope() {
+    tls_priority = previous_priority;
+    tls_opencv_threads = previous_threads;
+}
+
+TaskPriority currentTaskPriority() {
+    return tls_priority;
+}
+
+int currentOpenCvThreads() {
+    return tls_opencv_threads > 0 ? tls_opencv_threads : taskScheduler().workerCount();
+}
+
+void installOpenCvParallelBackend() {
+    static once_flag installed;
+    call_once(installed, [] {
+        cv::parallel::setParallelForBackend(make_shared<SchedulerParallelFor>(), false);
+        LOGI("OpenCV parallel loops run on the task scheduler");
+    });
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One work-stealing thread pool shared by every native engine, and by OpenCV's own
+// parallel loops (installOpenCvParallelBackend), so concurrent jobs share the cores
+// instead of each oversubscribing them.
+//
+// Every task has a priority class. Idle workers always take the most urgent task
+// there is: their own queue first, then the shared queue, then stealing from the
+// other workers. Worker 0 never runs Background tasks, so interactive work waits
+// for at most one task, never for a whole background render.
+//
+// On heterogeneous CPUs (big.LITTLE) the pool has one worker per big core and pins
+// them there; codec threads are left to the system.
+
+// Values mirror NativeBridge.TASK_PRIORITY_* on the Kotlin side.
+enum class TaskPriority : int {
+    Interactive = 0, // Live preview analysis
+    Capture = 1,     // Post-processing of a photo or clip the user is waiting for
+    Background = 2,  // Video renders that can take as long as they take
+};
+
+constexpr int kTaskPriorities = 3;
+
+const char* taskPriorityName(TaskPriority priority);
+
+class TaskScheduler {
+public:
+    using Task = std::function<void()>;
+
+    int workerCount() const;
+
+    // Runs `task` on some worker. Prefer TaskGroup, which can wait for its tasks.
+    void submit(TaskPriority priority, int openCvThreads, Task task);
+
+    // Index of the calling worker, or -1 off the pool.
+    static int currentWorker();
+
+    // Runs one queued task on the calling worker; false if there was none.
+    bool runPendingTask();
+
+    // {"workers":..,"pinnedCpus":[..],"utilization":..,"busyMs":..,"steals":..,
+    //  "queued":{"interactive":..,"capture":..,"background":..},"executed":{...}}.
+    // utilization is the busy share of all workers since the previous call.
+    std::string statsJson();
+
+private:
+    friend TaskScheduler& taskScheduler();
+    TaskScheduler();
+
+    struct QueuedTask {
+        Task run;
+        TaskPriority priority;
+        int opencv_threads;
+    };
+
+    // Each deque is pushed and popped at the back by its owner and stolen from at
+    // the front by the other workers.
+    struct Worker {
+        std::mutex queue_mutex;
+        std::deque<QueuedTask> queues[kTaskPriorities];
+        std::thread thread;
+        std::atomic<int64_t> busy_ns{0};
+    };
+
+    void workerLoop(int index);
+    bool takeTask(int index, QueuedTask& task);
+    void execute(int index, QueuedTask& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<int> pinned_cpus; // Empty when not pinned
+
+    std::mutex shared_mutex;      // Queues of tasks submitted from outside the pool
+    std::deque<QueuedTask> shared_queues[kTaskPriorities];
+
+    std::mutex idle_mutex;
+    std::condition_variable work_available;   // Workers 1..n-1
+    std::condition_variable urgent_available; // Worker 0: non-Background tasks only
+    std::atomic<int> queued_total{0};
+    std::atomic<int> queued[kTaskPriorities] = {};
+    std::atomic<int64_t> executed[kTaskPriorities] = {};
+    std::atomic<int64_t> steals{0};
+
+    std::mutex stats_mutex;
+    int64_t stats_start_ns = 0;
+    int64_t stats_busy_ns = 0;
+};
+
+// Process-wide scheduler, started on first use and never destroyed.
+TaskScheduler& taskScheduler();
+
+// Tasks of one job stage. wait() (or the destructor) returns once all of them have
+// finished; on a worker it runs other tasks meanwhile instead of blocking.
+// `openCvThreads` is how many threads an OpenCV call inside a task may spread over:
+// 1 when the tasks themselves already fill the cores (e.g. one task per frame).
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskPriority priority, int openCvThreads = 1);
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    void wait();
+
+    TaskPriority priority() const { return group_priority; }
+
+private:
+    TaskPriority group_priority;
+    int opencv_threads;
+    int pending = 0;
+    std::mutex state_mutex;
+    std::condition_variable finished;
+};
+
+// Sets the priority and OpenCV thread count of the work the calling thread does
+// itself, e.g. a whole job on the thread that called into JNI. openCvThreads <= 0
+// picks the default for the priority: all workers, half of them for Background.
+// Threads without a scope use all workers at Interactive priority.
+class TaskPriorityScope {
+public:
+    explicit TaskPriorityScope(TaskPriority priority, int openCvThreads = 0);
+    ~TaskPriorityScope();
+
+    TaskPriorityScope(const TaskPriorityScope&) = delete;
+    TaskPriorityScope& operator=(const TaskPriorityScope&) = delete;
+
+private:
+    TaskPriority previous_priority;
+    int previous_threads;
+};
+
+// Priority and OpenCV thread count of the calling thread's current work.
+TaskPriority currentTaskPriority();
+int currentOpenCvThreads();
+
+// Routes cv::parallel_for_ through the scheduler at the calling task's priority and
+// OpenCV thread count. Call once, before any other OpenCV work (JNI_OnLoad).
+void installOpenCvParallelBackend();
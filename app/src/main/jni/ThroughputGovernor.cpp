@@ -0,0 +1,264 @@
+#define LOG_TAG "ThroughputGovernor"
+
+#include "ThroughputGovernor.h"
+#include "JobStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// Quality at each step of each knob, full quality first.
+const double kFeatureScales[] = {1.0, 0.7, 0.5, 0.35};
+const double kAnalysisFactors[] = {1.0, 0.75, 0.5};
+const int kClaheRefreshFactors[] = {1, 2, 4, 8};
+// Share of the render workers below Severe, at Severe, Critical, and Emergency or worse.
+const double kWorkerShares[] = {1.0, 0.75, 0.5, 0.25};
+
+template <typename T, size_t N>
+constexpr int stepCount(const T (&)[N]) { return (int)N; }
+
+// Long enough to average out frame-time jitter and codec bursts.
+const double kWindowSeconds = 1.0;
+const int kMinWindowFrames = 5;
+// Below kSlowShare of the target steps down; above kFastShare for kFastWindows
+// windows in a row steps up. The gap keeps a restored knob from flapping.
+const double kSlowShare = 0.95;
+const double kFastShare = 1.2;
+const int kFastWindows = 3;
+// KLT still holds lock at this long edge.
+const int kMinAnalysisLongEdge = 320;
+
+double analysisMs(const JobStats& stats) {
+    return stats.totalMs(StatStage::Resize) + stats.totalMs(StatStage::Detect)
+        + stats.totalMs(StatStage::Match) + stats.totalMs(StatStage::Estimate);
+}
+
+int workerStep(ThermalStatus status) {
+    if (status >= ThermalStatus::Emergency) return 3;
+    if (status >= ThermalStatus::Critical) return 2;
+    if (status >= ThermalStatus::Severe) return 1;
+    return 0;
+}
+
+atomic<int> system_status{(int)ThermalStatus::None};
+
+class SystemThermalSource : public ThermalSource {
+public:
+    ThermalStatus status() const override {
+        return (ThermalStatus)system_status.load(memory_order_relaxed);
+    }
+};
+
+bool parseThermalStatus(const string& text, ThermalStatus& status) {
+    for (int s = 0; s <= (int)ThermalStatus::Shutdown; s++) {
+        if (text == thermalStatusName((ThermalStatus)s) || text == to_string(s)) {
+            status = (ThermalStatus)s;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const char* thermalStatusName(ThermalStatus status) {
+    switch (status) {
+        case ThermalStatus::None: return "none";
+        case ThermalStatus::Light: return "light";
+        case ThermalStatus::Moderate: return "moderate";
+        case ThermalStatus::Severe: return "severe";
+        case ThermalStatus::Critical: return "critical";
+        case ThermalStatus::Emergency: return "emergency";
+        case ThermalStatus::Shutdown: return "shutdown";
+    }
+    return "unknown";
+}
+
+void setThermalStatus(ThermalStatus status) {
+    int previous = system_status.exchange((int)status, memory_order_relaxed);
+    if (previous == (int)status) return;
+    LOGI("Thermal status %s -> %s", thermalStatusName((ThermalStatus)previous), thermalStatusName(status));
+}
+
+ThermalSource& systemThermalSource() {
+    static SystemThermalSource* source = new SystemThermalSource();
+    return *source;
+}
+
+unique_ptr<SyntheticThermalSource> SyntheticThermalSource::parse(const string& schedule) {
+    unique_ptr<SyntheticThermalSource> source(new SyntheticThermalSource());
+    stringstream list(schedule);
+    string entry;
+    while (getline(list, entry, ',')) {
+        size_t colon = entry.find(':');
+        if (colon == string::npos) return nullptr;
+        char* end = nullptr;
+        double seconds = strtod(entry.c_str(), &end);
+        ThermalStatus status;
+        if (end != entry.c_str() + colon || seconds < 0
+            || !parseThermalStatus(entry.substr(colon + 1), status)) {
+            return nullptr;
+        }
+        if (!source->steps.empty() && seconds <= source->steps.back().first) return nullptr;
+        source->steps.emplace_back(seconds, status);
+    }
+    if (source->steps.empty()) return nullptr;
+    return source;
+}
+
+ThermalStatus SyntheticThermalSource::status() const {
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    ThermalStatus status = ThermalStatus::None;
+    for (const auto& step : steps) {
+        if (step.first > seconds) break;
+        status = step.second;
+    }
+    return status;
+}
+
+ThroughputGovernor::ThroughputGovernor(double targetFps, const ThermalSource& thermal, JobStats* stats)
+    : target_fps(targetFps), thermal(thermal), stats(stats) {
+    beginPass();
+}
+
+void ThroughputGovernor::beginPass() {
+    lock_guard<mutex> lock(eval_mutex);
+    pending_frames.store(0, memory_order_relaxed);
+    window_start = Clock::now();
+    analysis_ms_seen = stats ? analysisMs(*stats) : 0;
+    enhance_ms_seen = stats ? stats->totalMs(StatStage::Enhance) : 0;
+    fast_windows = 0;
+}
+
+void ThroughputGovernor::frameDone() {
+    if (pending_frames.fetch_add(1, memory_order_relaxed) + 1 < kMinWindowFrames) return;
+    unique_lock<mutex> lock(eval_mutex, try_to_lock);
+    if (!lock.owns_lock()) return; // Another frame is evaluating
+
+    Clock::time_point now = Clock::now();
+    double seconds = chrono::duration<double>(now - window_start).count();
+    if (seconds < kWindowSeconds) return;
+    int frames = pending_frames.exchange(0, memory_order_relaxed);
+    window_start = now;
+    evaluate(frames / seconds);
+}
+
+void ThroughputGovernor::evaluate(double fps) {
+    ThermalStatus status = thermal.status();
+    hottest = std::max(hottest, status);
+
+    double analysis_total = stats ? analysisMs(*stats) : 0;
+    double enhance_total = stats ? stats->totalMs(StatStage::Enhance) : 0;
+    double analysis_ms = analysis_total - analysis_ms_seen;
+    double enhance_ms = enhance_total - enhance_ms_seen;
+    analysis_ms_seen = analysis_total;
+    enhance_ms_seen = enhance_total;
+
+    int workers = workerStep(status);
+    if (worker_step.exchange(workers, memory_order_relaxed) != workers) {
+        LOGI("Thermal status %s: render workers at %.0f%%", thermalStatusName(status), kWorkerShares[workers] * 100);
+    }
+
+    // Heat is what makes the next minutes slow, so it is shed before fps drops.
+    if (fps < target_fps * kSlowShare || status >= ThermalStatus::Severe) {
+        fast_windows = 0;
+        if (stepDown(analysis_ms, enhance_ms)) {
+            steps_down++;
+            LOGI("%.1f fps for %.1f target, thermal %s: stepped down to %s",
+                 fps, target_fps, thermalStatusName(status), describe().c_str());
+        }
+        return;
+    }
+
+    if (fps <= target_fps * kFastShare || status >= ThermalStatus::Moderate || history.empty()) {
+        fast_windows = 0;
+        return;
+    }
+    if (++fast_windows < kFastWindows) return;
+    fast_windows = 0;
+    Knob knob = history.back();
+    history.pop_back();
+    steps[knob].fetch_sub(1, memory_order_relaxed);
+    steps_up++;
+    LOGI("%.1f fps for %.1f target: stepped up to %s", fps, target_fps, describe().c_str());
+}
+
+bool ThroughputGovernor::stepDown(double analysis_ms, double enhance_ms) {
+    // Only stages this pass runs are worth degrading; without stats, analysis goes first.
+    bool analysis_active = !stats || analysis_ms > 0;
+    bool enhance_active = !stats || enhance_ms > 0;
+    if (enhance_active && (!analysis_active || enhance_ms > analysis_ms)) {
+        return step(Clahe) || (analysis_active && stepAnalysis());
+    }
+    return (analysis_active && stepAnalysis()) || (enhance_active && step(Clahe));
+}
+
+// Features and resolution take turns, features first: losing features costs less lock.
+bool ThroughputGovernor::stepAnalysis() {
+    if (steps[Features].load(memory_order_relaxed) <= steps[Analysis].load(memory_order_relaxed)
+        && step(Features)) {
+        return true;
+    }
+    return step(Analysis) || step(Features);
+}
+
+bool ThroughputGovernor::step(Knob knob) {
+    static const int counts[KnobCount] = {
+        stepCount(kFeatureScales), stepCount(kAnalysisFactors), stepCount(kClaheRefreshFactors)};
+    int current = steps[knob].load(memory_order_relaxed);
+    if (current + 1 >= counts[knob]) return false;
+    steps[knob].store(current + 1, memory_order_relaxed);
+    history.push_back(knob);
+    return true;
+}
+
+string ThroughputGovernor::describe() const {
+    char buf[128];
+    snprintf(buf, sizeof(buf), "features x%.2f, analysis x%.2f, CLAHE refresh x%d, workers x%.2f",
+             featureScale(), kAnalysisFactors[steps[Analysis].load(memory_order_relaxed)],
+             kClaheRefreshFactors[steps[Clahe].load(memory_order_relaxed)],
+             kWorkerShares[worker_step.load(memory_order_relaxed)]);
+    return buf;
+}
+
+double ThroughputGovernor::featureScale() const {
+    return kFeatureScales[steps[Features].load(memory_order_relaxed)];
+}
+
+double ThroughputGovernor::analysisScale(double baseScale, Size frameSize) const {
+    double scale = baseScale * kAnalysisFactors[steps[Analysis].load(memory_order_relaxed)];
+    int long_edge = std::max(frameSize.width, frameSize.height);
+    if (long_edge <= 0) return baseScale;
+    return std::max(scale, std::min(baseScale, (double)kMinAnalysisLongEdge / long_edge));
+}
+
+int ThroughputGovernor::claheRefreshInterval(int baseInterval) const {
+    return std::max(baseInterval, 1) * kClaheRefreshFactors[steps[Clahe].load(memory_order_relaxed)];
+}
+
+int ThroughputGovernor::workerLimit(int workers) const {
+    double share = kWorkerShares[worker_step.load(memory_order_relaxed)];
+    return std::max(1, (int)std::lround(workers * share));
+}
+
+void ThroughputGovernor::report(JobStats* out) const {
+    if (!out) return;
+    lock_guard<mutex> lock(eval_mutex);
+    out->setCounter("governorTargetFps", target_fps);
+    out->setCounter("governorStepsDown", steps_down);
+    out->setCounter("governorStepsUp", steps_up);
+    out->setCounter("governorFeatureScale", featureScale());
+    out->setCounter("governorAnalysisFactor", kAnalysisFactors[steps[Analysis].load(memory_order_relaxed)]);
+    out->setCounter("governorClaheRefreshFactor", kClaheRefreshFactors[steps[Clahe].load(memory_order_relaxed)]);
+    out->setCounter("governorWorkerShare", kWorkerShares[worker_step.load(memory_order_relaxed)]);
+    out->setCounter("thermalStatusMax", (int)hottest);
+}
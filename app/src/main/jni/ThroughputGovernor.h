@@ -0,0 +1,122 @@
+#pragma once
+
+#include "NativeCommon.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class JobStats;
+
+// Keeps a long render near a target frame rate once the device heats up.
+//
+// A job's fixed workload (feature count, analysis resolution, CLAHE refreshes,
+// render workers) runs fine on a cool phone and collapses once the SoC throttles.
+// A governed job reports every finished frame; about once a second the governor
+// compares the frame rate against the target and steps one quality knob:
+//
+//   - too slow: down, on the stage that took most of the time in that second
+//     (JobStats): estimator features, then analysis resolution, for analysis;
+//     the temporal CLAHE refresh interval for enhancement.
+//   - well above the target for several seconds, and not warm: the last step
+//     is undone.
+//   - Severe thermal status or worse: down every second regardless of the frame
+//     rate, and the render workers are capped (fewer hot cores hold their clocks).
+//
+// The knobs are plain atomics, read by the job wherever it would use the fixed
+// value, so a step takes effect on the next frame.
+
+// Values mirror PowerManager.THERMAL_STATUS_* on the Kotlin side.
+enum class ThermalStatus : int {
+    None = 0,
+    Light = 1,
+    Moderate = 2,
+    Severe = 3,
+    Critical = 4,
+    Emergency = 5,
+    Shutdown = 6,
+};
+
+const char* thermalStatusName(ThermalStatus status);
+
+// Where a governor reads the device temperature from.
+class ThermalSource {
+public:
+    virtual ~ThermalSource() = default;
+    virtual ThermalStatus status() const = 0;
+};
+
+// The status the app last pushed (ThermalMonitor -> NativeBridge.setThermalStatus).
+// None until then, and always on a host.
+void setThermalStatus(ThermalStatus status);
+ThermalSource& systemThermalSource();
+
+// Replays a fixed schedule, timed from construction. Drives the governor on a host,
+// where nothing heats up on cue (folar-bench --thermal).
+class SyntheticThermalSource : public ThermalSource {
+public:
+    // "0:none,20:moderate,45:severe": each status from that second on. Statuses are
+    // names or 0..6. Returns null for a malformed schedule.
+    static std::unique_ptr<SyntheticThermalSource> parse(const std::string& schedule);
+
+    ThermalStatus status() const override;
+
+private:
+    std::vector<std::pair<double, ThermalStatus>> steps; // Ascending seconds
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+class ThroughputGovernor {
+public:
+    // `stats` (may be null) tells which stage to step; without it analysis goes first.
+    ThroughputGovernor(double targetFps, const ThermalSource& thermal, JobStats* stats);
+
+    // Frames of different passes are not comparable: restarts the measurement.
+    void beginPass();
+
+    // One frame of the current pass is finished. Thread-safe.
+    void frameDone();
+
+    // Fraction of the estimator's nominal feature / track count.
+    double featureScale() const;
+    // `baseScale` (computeAnalysisScale) lowered by the governor, but never below a
+    // 320 px long edge unless `baseScale` already is.
+    double analysisScale(double baseScale, cv::Size frameSize) const;
+    int claheRefreshInterval(int baseInterval) const;
+    // Render tasks that may run at once, of `workers` (at least 1).
+    int workerLimit(int workers) const;
+
+    // Final knobs, step counts and the hottest status seen, as JobStats counters.
+    void report(JobStats* stats) const;
+
+private:
+    enum Knob { Features, Analysis, Clahe, KnobCount };
+
+    void evaluate(double fps);
+    bool stepDown(double analysis_ms, double enhance_ms);
+    bool stepAnalysis();
+    bool step(Knob knob);
+    std::string describe() const;
+
+    double target_fps;
+    const ThermalSource& thermal;
+    JobStats* stats;
+
+    std::atomic<int> steps[KnobCount] = {};
+    std::atomic<int> worker_step{0};
+    std::atomic<int> pending_frames{0};
+
+    mutable std::mutex eval_mutex; // Everything below
+    std::chrono::steady_clock::time_point window_start;
+    double analysis_ms_seen = 0;
+    double enhance_ms_seen = 0;
+    int fast_windows = 0;
+    std::vector<Knob> history; // Steps down not yet undone, oldest first
+    int steps_down = 0;
+    int steps_up = 0;
+    ThermalStatus hottest = ThermalStatus::None;
+};
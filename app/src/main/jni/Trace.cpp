@@ -0,0 +1,219 @@
+#define LOG_TAG "Trace"
+
+#include "Trace.h"
+#include "NativeCommon.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(__ANDROID__)
+#include <android/trace.h>
+#include <pthread.h>
+#endif
+
+namespace trace_detail {
+std::atomic<bool> enabled{false};
+}
+
+#if defined(__ANDROID__)
+
+void setTraceEnabled(bool enabled) {
+    trace_detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void traceThreadName(const char* name) {
+    // Perfetto shows the kernel thread name (15 characters at most).
+    char truncated[16];
+    snprintf(truncated, sizeof(truncated), "%s", name);
+    pthread_setname_np(pthread_self(), truncated);
+}
+
+bool writeChromeTrace(const std::string& path) {
+    LOGW("Chrome trace export is host only; capture ATrace sections with Perfetto instead");
+    return false;
+}
+
+void TraceScope::begin(const char* scopeName, int scopeFrame) {
+    active = true;
+    if (scopeFrame < 0) {
+        ATrace_beginSection(scopeName);
+        return;
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "%s #%d", scopeName, scopeFrame);
+    ATrace_beginSection(label);
+}
+
+void TraceScope::finish() {
+    active = false;
+    ATrace_endSection();
+}
+
+#else
+
+namespace {
+
+// Per-thread capacity; 64k events is minutes of video at ~10 scopes per frame.
+const size_t kEventsPerThread = 1 << 16;
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TraceEvent {
+    const char* name;
+    int frame;
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+// Written only by its thread; `count` publishes the events to the flush.
+struct ThreadBuffer {
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> count{0};
+    std::atomic<size_t> dropped{0};
+    int tid = 0;
+    int session = 0;
+    std::string name;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::atomic<int> session{0};
+    int64_t session_start_ns = 0;
+    int next_tid = 1;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+thread_local std::shared_ptr<ThreadBuffer> tls_buffer;
+thread_local std::string tls_name;
+
+// Registers a fresh buffer on the first event of each thread in each session.
+ThreadBuffer* threadBuffer() {
+    Registry& r = registry();
+    int session = r.session.load(std::memory_order_acquire);
+    if (tls_buffer && tls_buffer->session == session) return tls_buffer.get();
+
+    auto buffer = std::make_shared<ThreadBuffer>();
+    buffer->events.resize(kEventsPerThread);
+    buffer->session = session;
+    buffer->name = tls_name;
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    buffer->tid = r.next_tid++;
+    r.buffers.push_back(buffer);
+    tls_buffer = buffer;
+    return buffer.get();
+}
+
+void appendJsonString(std::string& json, const std::string& value) {
+    json += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') json += '\\';
+        if ((unsigned char)c >= 0x20) json += c;
+    }
+    json += '"';
+}
+
+} // namespace
+
+void setTraceEnabled(bool enabled) {
+    if (enabled && !traceEnabled()) {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.buffers.clear();
+        r.next_tid = 1;
+        r.session_start_ns = nowNs();
+        r.session.fetch_add(1, std::memory_order_release);
+    }
+    trace_detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void traceThreadName(const char* name) {
+    tls_name = name;
+    if (tls_buffer) {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        tls_buffer->name = name;
+    }
+}
+
+bool writeChromeTrace(const std::string& path) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        LOGE("Cannot write trace to %s", path.c_str());
+        return false;
+    }
+
+    size_t events = 0, dropped = 0;
+    bool first = true;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+    for (const auto& buffer : r.buffers) {
+        std::string json;
+        if (!buffer->name.empty()) {
+            json += first ? "\n" : ",\n";
+            first = false;
+            json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buffer->tid) +
+                    ",\"args\":{\"name\":";
+            appendJsonString(json, buffer->name);
+            json += "}}";
+        }
+
+        size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; i++) {
+            const TraceEvent& e = buffer->events[i];
+            char line[256];
+            snprintf(line, sizeof(line),
+                     "%s{\"name\":\"%s\",\"cat\":\"folar\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                     "\"ts\":%.3f,\"dur\":%.3f",
+                     first ? "\n" : ",\n", e.name, buffer->tid,
+                     (e.start_ns - r.session_start_ns) / 1000.0, e.duration_ns / 1000.0);
+            first = false;
+            json += line;
+            json += e.frame >= 0 ? ",\"args\":{\"frame\":" + std::to_string(e.frame) + "}}" : "}";
+        }
+        fputs(json.c_str(), file);
+        events += count;
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    fputs("\n]}\n", file);
+    bool ok = fclose(file) == 0;
+
+    LOGI("Trace: %zu events from %zu threads written to %s", events, r.buffers.size(), path.c_str());
+    if (dropped > 0) LOGW("Trace: %zu events dropped (per-thread buffer full)", dropped);
+    return ok;
+}
+
+void TraceScope::begin(const char* scopeName, int scopeFrame) {
+    active = true;
+    name = scopeName;
+    frame = scopeFrame;
+    start_ns = nowNs();
+}
+
+void TraceScope::finish() {
+    active = false;
+    int64_t end_ns = nowNs();
+
+    ThreadBuffer* buffer = threadBuffer();
+    size_t n = buffer->count.load(std::memory_order_relaxed);
+    if (n >= buffer->events.size()) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->events[n] = {name, frame, start_ns, end_ns - start_ns};
+    buffer->count.store(n + 1, std::memory_order_release);
+}
+
+#endif // __ANDROID__
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Timeline tracing of the native pipeline: begin/end of every stage, per frame and
+// per thread, to see the bubbles between decode, compute and encode that the
+// aggregate JobStats cannot show.
+//
+//   Android  Each scope is an ATrace section; capture with Perfetto or systrace
+//            with app tracing enabled for the package.
+//   Host     Each scope is stored in a preallocated per-thread buffer (single
+//            writer, no locks on the recording path) and writeChromeTrace() flushes
+//            all buffers as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Off by default and switchable at runtime; a disabled scope costs one relaxed load.
+// Scope names must be string literals (they are stored by pointer).
+
+namespace trace_detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool traceEnabled() {
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// Enabling starts a new session: on the host, events of earlier sessions are dropped.
+void setTraceEnabled(bool enabled);
+
+// Names the calling thread in the trace. Only for threads the pipeline creates.
+void traceThreadName(const char* name);
+
+// Host only: writes every event of the current session as Chrome trace JSON.
+// Call once the traced jobs have finished. Returns false on Android or on I/O error.
+bool writeChromeTrace(const std::string& path);
+
+// Traces the enclosing scope (or until end()). `frame` < 0 means no frame index.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, int frame = -1) {
+        if (traceEnabled()) begin(name, frame);
+    }
+    ~TraceScope() { end(); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    void end() {
+        if (active) finish();
+    }
+
+private:
+    void begin(const char* name, int frame);
+    void finish();
+
+    bool active = false;
+    const char* name = nullptr;
+    int frame = -1;
+    int64_t start_ns = 0;
+};
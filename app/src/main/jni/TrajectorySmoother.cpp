@@ -0,0 +1,329 @@
+#define LOG_TAG "TrajectorySmoother"
+
+#include "TrajectorySmoother.h"
+#include "NativeCommon.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// Below this sigma the recursive coefficients lose accuracy, and the direct
+// window is only a handful of taps anyway.
+const double kMinRecursiveSigma = 2.0;
+
+double sigmaForRadius(int radius) {
+    return radius / 2.5;
+}
+
+// Young & van Vliet recursive Gaussian: a causal and an anti-causal third-order
+// IIR pass, O(n) regardless of sigma. The signal is treated as zero outside
+// [0, n); `padded` must hold n + tail samples, the tail lets the forward
+// response decay before the backward pass starts from a zero state.
+void recursiveGaussian(vector<double>& padded, double sigma) {
+    double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330
+                            : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q, q3 = q2 * q;
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    double b3 = (0.422205 * q3) / b0;
+    double B = 1.0 - (b1 + b2 + b3);
+
+    size_t n = padded.size();
+    double w1 = 0, w2 = 0, w3 = 0;
+    for (size_t i = 0; i < n; i++) {
+        double w = B * padded[i] + b1 * w1 + b2 * w2 + b3 * w3;
+        padded[i] = w;
+        w3 = w2; w2 = w1; w1 = w;
+    }
+    w1 = w2 = w3 = 0;
+    for (size_t i = n; i-- > 0;) {
+        double w = B * padded[i] + b1 * w1 + b2 * w2 + b3 * w3;
+        padded[i] = w;
+        w3 = w2; w2 = w1; w1 = w;
+    }
+}
+
+// Filters the signal and the indicator of [0, n) with the same kernel and divides,
+// which normalizes by the weight that falls inside the clip. That is how the
+// windowed Gaussian treats the ends, so the start and end of a clip do not get
+// pulled towards zero.
+class RecursiveGaussian {
+public:
+    explicit RecursiveGaussian(double sigma) : sigma(sigma), tail((size_t)std::ceil(5 * sigma) + 3) {}
+
+    void prepare(size_t n) {
+        norm.assign(n + tail, 0.0);
+        std::fill(norm.begin(), norm.begin() + n, 1.0);
+        recursiveGaussian(norm, sigma);
+    }
+
+    void apply(const double* in, double* out, size_t n) {
+        buf.assign(n + tail, 0.0);
+        std::copy(in, in + n, buf.begin());
+        recursiveGaussian(buf, sigma);
+        for (size_t i = 0; i < n; i++) out[i] = norm[i] > 0 ? buf[i] / norm[i] : in[i];
+    }
+
+private:
+    double sigma;
+    size_t tail;
+    vector<double> norm, buf;
+};
+
+class GaussianSmoother : public TrajectorySmoother {
+public:
+    explicit GaussianSmoother(int radius) : radius(radius) {}
+
+    const char* name() const override { return "gaussian"; }
+
+    void smooth(const TrajectoryBuffer& in, TrajectoryBuffer& out) override {
+        size_t n = in.size();
+        out.resize(n);
+        if (n == 0) return;
+
+        if (radius <= 0) {
+            out = in;
+        } else if (sigmaForRadius(radius) < kMinRecursiveSigma) {
+            GaussianWindow window(radius);
+            for (size_t i = 0; i < n; i++) {
+                Trajectory t = window.at(in, i);
+                out.x[i] = t.x; out.y[i] = t.y; out.a[i] = t.a;
+            }
+        } else {
+            RecursiveGaussian filter(sigmaForRadius(radius));
+            filter.prepare(n);
+            filter.apply(in.x.data(), out.x.data(), n);
+            filter.apply(in.y.data(), out.y.data(), n);
+            filter.apply(in.a.data(), out.a.data(), n);
+        }
+    }
+
+private:
+    int radius;
+};
+
+class KalmanSmoother : public TrajectorySmoother {
+public:
+    explicit KalmanSmoother(const SmootherParams& params) : params(params) {}
+
+    const char* name() const override { return "kalman"; }
+
+    void smooth(const TrajectoryBuffer& in, TrajectoryBuffer& out) override {
+        out.resize(in.size());
+        KalmanTrajectoryFilter filter(params.processNoise, params.measurementNoise);
+        for (size_t i = 0; i < in.size(); i++) {
+            Trajectory t = filter.update(in.at(i));
+            out.x[i] = t.x; out.y[i] = t.y; out.a[i] = t.a;
+        }
+    }
+
+private:
+    SmootherParams params;
+};
+
+struct PathPoint {
+    long i;
+    double v;
+};
+
+double slope(const PathPoint& p, const PathPoint& q) {
+    return (q.v - p.v) / double(q.i - p.i);
+}
+
+// Shortest path from (0, start) to (n-1, end) that stays within [lo, hi] at every
+// index (the "taut string"). Funnel algorithm: the upper chain holds the convex
+// hull of the upper bounds seen from the apex, the lower chain the concave hull of
+// the lower bounds. When a new bound crosses the opposite chain, the path is fixed
+// up to the vertex it wraps around, which becomes the new apex. Every point enters
+// and leaves a chain once, so this is O(n).
+void tautString(const double* lo, const double* hi, size_t n, double start, double end, double* out) {
+    out[0] = start;
+    if (n < 2) return;
+
+    auto emit = [&](const PathPoint& a, const PathPoint& b) {
+        for (long i = a.i + 1; i <= b.i; i++) out[i] = a.v + (b.v - a.v) * double(i - a.i) / double(b.i - a.i);
+    };
+
+    vector<PathPoint> upper, lower;
+    upper.reserve(n);
+    lower.reserve(n);
+    size_t uh = 0, lh = 0; // Apex position in each chain
+    upper.push_back({0, start});
+    lower.push_back({0, start});
+
+    for (size_t k = 1; k < n; k++) {
+        bool last = k + 1 == n;
+        PathPoint pu = {(long)k, last ? end : hi[k]};
+        PathPoint pl = {(long)k, last ? end : lo[k]};
+
+        // Upper bound below the lower chain: the path bends down around lower vertices.
+        bool wrapped = false;
+        while (lower.size() - lh >= 2 && slope(lower[lh], pu) <= slope(lower[lh], lower[lh + 1])) {
+            emit(lower[lh], lower[lh + 1]);
+            lh++;
+            wrapped = true;
+        }
+        if (wrapped) {
+            upper.clear();
+            uh = 0;
+            upper.push_back(lower[lh]);
+        }
+        while (upper.size() - uh >= 2
+               && slope(upper[upper.size() - 2], upper.back()) >= slope(upper.back(), pu)) {
+            upper.pop_back();
+        }
+        upper.push_back(pu);
+
+        // Lower bound above the upper chain: the path bends up around upper vertices.
+        wrapped = false;
+        while (upper.size() - uh >= 2 && slope(upper[uh], pl) >= slope(upper[uh], upper[uh + 1])) {
+            emit(upper[uh], upper[uh + 1]);
+            uh++;
+            wrapped = true;
+        }
+        if (wrapped) {
+            lower.clear();
+            lh = 0;
+            lower.push_back(upper[uh]);
+        }
+        while (lower.size() - lh >= 2
+               && slope(lower[lower.size() - 2], lower.back()) <= slope(lower.back(), pl)) {
+            lower.pop_back();
+        }
+        if (pl.i > lower.back().i) lower.push_back(pl);
+    }
+
+    // Both chains end at (n-1, end); whatever is left of the upper chain is the tail.
+    for (size_t k = uh; k + 1 < upper.size(); k++) emit(upper[k], upper[k + 1]);
+}
+
+// Among all paths whose correction stays within the crop margin, the taut string
+// is simultaneously the shortest and the one minimizing any convex function of
+// the camera velocity, so it is the smoothest motion the crop can hide. The clip
+// ends are anchored on the Gaussian path, clamped into the margin.
+class CropConstrainedSmoother : public TrajectorySmoother {
+public:
+    explicit CropConstrainedSmoother(const SmootherParams& params) : params(params), anchor(params.radius) {}
+
+    const char* name() const override { return "crop-constrained"; }
+
+    void smooth(const TrajectoryBuffer& in, TrajectoryBuffer& out) override {
+        size_t n = in.size();
+        out.resize(n);
+        if (n == 0) return;
+
+        TrajectoryBuffer gaussian;
+        anchor.smooth(in, gaussian);
+
+        smoothChannel(in.x, gaussian.x, params.maxShiftX, out.x);
+        smoothChannel(in.y, gaussian.y, params.maxShiftY, out.y);
+        smoothChannel(in.a, gaussian.a, params.maxAngle, out.a);
+    }
+
+private:
+    void smoothChannel(const vector<double>& actual, const vector<double>& gaussian,
+                       double margin, vector<double>& out) {
+        size_t n = actual.size();
+        margin = std::max(margin, 0.0);
+        lo.resize(n);
+        hi.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            lo[i] = actual[i] - margin;
+            hi[i] = actual[i] + margin;
+        }
+        double start = std::min(std::max(gaussian[0], lo[0]), hi[0]);
+        double end = std::min(std::max(gaussian[n - 1], lo[n - 1]), hi[n - 1]);
+        tautString(lo.data(), hi.data(), n, start, end, out.data());
+    }
+
+    SmootherParams params;
+    GaussianSmoother anchor;
+    vector<double> lo, hi;
+};
+
+} // namespace
+
+void cropMarginsForZoom(double zoom, int width, int height, SmootherParams& params) {
+    if (zoom <= 1.0) {
+        params.maxShiftX = params.maxShiftY = params.maxAngle = 0;
+        return;
+    }
+    // Slack on each side between the source frame and the visible window.
+    double slack = (1.0 - 1.0 / zoom) / 2.0;
+    double slack_x = slack * width;
+    double slack_y = slack * height;
+
+    // 80% for translation. A rotation by θ moves the visible corners by about
+    // θ times the window's half-diagonal, which the remaining 20% covers.
+    params.maxShiftX = 0.8 * slack_x;
+    params.maxShiftY = 0.8 * slack_y;
+    double half_diagonal = 0.5 * std::hypot(width, height) / zoom;
+    params.maxAngle = half_diagonal > 0 ? 0.2 * std::min(slack_x, slack_y) / half_diagonal : 0;
+}
+
+unique_ptr<TrajectorySmoother> createTrajectorySmoother(SmootherType type, const SmootherParams& params) {
+    switch (type) {
+        case SmootherType::Kalman:
+            return make_unique<KalmanSmoother>(params);
+        case SmootherType::CropConstrained:
+            return make_unique<CropConstrainedSmoother>(params);
+        case SmootherType::Gaussian:
+            return make_unique<GaussianSmoother>(params.radius);
+    }
+    LOGW("Unknown smoother %d, using gaussian", (int)type);
+    return make_unique<GaussianSmoother>(params.radius);
+}
+
+GaussianWindow::GaussianWindow(int radius) : r(std::max(radius, 0)), weights(2 * r + 1) {
+    double sigma = sigmaForRadius(r);
+    for (int j = -r; j <= r; j++) {
+        weights[j + r] = sigma > 0 ? std::exp(-(double)(j * j) / (2.0 * sigma * sigma)) : 1.0;
+    }
+}
+
+Trajectory GaussianWindow::at(const TrajectoryBuffer& trajectory, size_t i) const {
+    long n = (long)trajectory.size();
+    long lo = std::max<long>((long)i - r, 0);
+    long hi = std::min<long>((long)i + r, n - 1);
+
+    double sum_x = 0, sum_y = 0, sum_a = 0;
+    double sum_weight = 0;
+    for (long k = lo; k <= hi; k++) {
+        double w = weights[k - (long)i + r];
+        sum_x += trajectory.x[k] * w;
+        sum_y += trajectory.y[k] * w;
+        sum_a += trajectory.a[k] * w;
+        sum_weight += w;
+    }
+
+    if (sum_weight > 0) {
+        return {sum_x / sum_weight, sum_y / sum_weight, sum_a / sum_weight};
+    }
+    return trajectory.at(i);
+}
+
+KalmanTrajectoryFilter::KalmanTrajectoryFilter(double processNoise, double measurementNoise)
+    : q(processNoise), r(measurementNoise) {}
+
+Trajectory KalmanTrajectoryFilter::update(const Trajectory& measured) {
+    if (!initialized) {
+        estimate = measured;
+        initialized = true;
+        return estimate;
+    }
+
+    double* x[3] = {&estimate.x, &estimate.y, &estimate.a};
+    const double z[3] = {measured.x, measured.y, measured.a};
+    for (int c = 0; c < 3; c++) {
+        // Constant-position model: predict, then correct towards the measurement.
+        double p_pred = p[c] + q;
+        double gain = p_pred / (p_pred + r);
+        *x[c] += gain * (z[c] - *x[c]);
+        p[c] = (1.0 - gain) * p_pred;
+    }
+    return estimate;
+}
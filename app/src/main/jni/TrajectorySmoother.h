@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct Trajectory {
+    double x;
+    double y;
+    double a;
+};
+
+// Structure-of-arrays trajectory: one contiguous array per component, so the
+// smoothers run the same scalar filter over three flat buffers.
+struct TrajectoryBuffer {
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> a;
+
+    size_t size() const { return x.size(); }
+    void reserve(size_t n) { x.reserve(n); y.reserve(n); a.reserve(n); }
+    void resize(size_t n) { x.resize(n); y.resize(n); a.resize(n); }
+    void push_back(const Trajectory& t) { x.push_back(t.x); y.push_back(t.y); a.push_back(t.a); }
+    Trajectory at(size_t i) const { return {x[i], y[i], a[i]}; }
+};
+
+// Values mirror NativeBridge.SMOOTHER_* on the Kotlin side.
+enum class SmootherType : int {
+    // Gaussian over the whole clip, as a recursive (IIR) filter: O(N) for any radius.
+    Gaussian = 0,
+    // Causal constant-position Kalman filter. Needs no future frames, so it also
+    // works in real time and lets the streaming mode run without lookahead.
+    Kalman = 1,
+    // Shortest ("taut string") path that keeps every correction inside the crop
+    // margin. Smoothest result the crop allows, never shows a border.
+    CropConstrained = 2,
+};
+
+struct SmootherParams {
+    // Gaussian support: sigma = radius / 2.5.
+    // Radius 90 means ~3 seconds of lookahead/lookbehind at 30fps.
+    int radius = 90;
+
+    // Kalman: only the ratio matters; 4e-3 / 0.25 follows a slow, "floating" path.
+    double processNoise = 4e-3;
+    double measurementNoise = 0.25;
+
+    // Crop-constrained: largest correction (smoothed - actual) per component.
+    // See cropMarginsForZoom().
+    double maxShiftX = 0;
+    double maxShiftY = 0;
+    double maxAngle = 0;
+};
+
+// Margins that the crop zoom leaves around the visible window. Most of it goes
+// to translation; a small share is kept for rotation, which also moves corners.
+void cropMarginsForZoom(double zoom, int width, int height, SmootherParams& params);
+
+class TrajectorySmoother {
+public:
+    virtual ~TrajectorySmoother() = default;
+
+    virtual const char* name() const = 0;
+
+    // Whole-trajectory smoothing; `out` is resized to match `in`.
+    virtual void smooth(const TrajectoryBuffer& in, TrajectoryBuffer& out) = 0;
+};
+
+std::unique_ptr<TrajectorySmoother> createTrajectorySmoother(SmootherType type, const SmootherParams& params);
+
+// Truncated, normalized Gaussian window evaluated at one index, for the
+// streaming mode where only `radius` future samples exist. Weights are computed
+// once, so a sample costs 2 * radius + 1 multiply-adds and no exp().
+class GaussianWindow {
+public:
+    explicit GaussianWindow(int radius);
+
+    int radius() const { return r; }
+    Trajectory at(const TrajectoryBuffer& trajectory, size_t i) const;
+
+private:
+    int r;
+    std::vector<double> weights;
+};
+
+// Incremental form of SmootherType::Kalman for frame-by-frame use.
+class KalmanTrajectoryFilter {
+public:
+    KalmanTrajectoryFilter(double processNoise, double measurementNoise);
+
+    Trajectory update(const Trajectory& measured);
+
+private:
+    double q;
+    double r;
+    bool initialized = false;
+    Trajectory estimate = {0, 0, 0};
+    double p[3] = {1, 1, 1};
+};
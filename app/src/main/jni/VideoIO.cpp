@@ -0,0 +1,109 @@
+#define LOG_TAG "VideoIO"
+
+#include "VideoIO.h"
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+// Fallback for backends that cannot remux: decode every part, encode one file.
+bool reencodeVideos(const vector<string>& inputPaths, const string& outputPath, double fps,
+                    int rotationDegrees, CodecBackend backend, const AudioSource& audio) {
+    unique_ptr<FrameSink> sink;
+    Mat frame;
+    for (const string& path : inputPaths) {
+        unique_ptr<FrameSource> source = openFrameSource(path, backend);
+        if (!source) return false;
+        if (!sink) {
+            Size size(source->info().width, source->info().height);
+            sink = openFrameSink(outputPath, size, fps, rotationDegrees, backend, audio);
+            if (!sink) return false;
+        }
+        while (source->read(frame)) {
+            if (!sink->write(frame)) return false;
+        }
+    }
+    return sink && sink->close();
+}
+
+} // namespace
+
+unique_ptr<FrameSource> openFrameSource(const string& path, CodecBackend backend) {
+    unique_ptr<FrameSource> source;
+#if defined(__ANDROID__)
+    if (backend != CodecBackend::OpenCV) {
+        source = openMediaCodecFrameSource(path);
+        if (!source && backend == CodecBackend::MediaCodec) {
+            LOGE("MediaCodec cannot decode %s", path.c_str());
+            return nullptr;
+        }
+    }
+#else
+    if (backend == CodecBackend::MediaCodec) {
+        LOGW("MediaCodec backend is Android only, using OpenCV");
+    }
+#endif
+    if (!source) source = openOpenCvFrameSource(path);
+
+    if (!source) {
+        LOGE("CRITICAL: Failed to open input video at path: %s", path.c_str());
+        return nullptr;
+    }
+    const VideoInfo& info = source->info();
+    LOGI("Decoding with %s: %dx%d @ %.2f fps, %d frames, rotation %d",
+         source->backendName(), info.width, info.height, info.fps, info.frameCount, info.rotationDegrees);
+    return source;
+}
+
+unique_ptr<FrameSink> openFrameSink(const string& path, Size size, double fps,
+                                    int rotationDegrees, CodecBackend backend, const AudioSource& audio) {
+    unique_ptr<FrameSink> sink;
+#if defined(__ANDROID__)
+    if (backend != CodecBackend::OpenCV) {
+        sink = openMediaCodecFrameSink(path, size, fps, rotationDegrees, audio);
+        if (!sink && backend == CodecBackend::MediaCodec) {
+            LOGE("MediaCodec cannot encode %dx%d", size.width, size.height);
+            return nullptr;
+        }
+    }
+#else
+    if (backend == CodecBackend::MediaCodec) {
+        LOGW("MediaCodec backend is Android only, using OpenCV");
+    }
+#endif
+    if (!sink) {
+        sink = openOpenCvFrameSink(path, size, fps);
+        if (sink && rotationDegrees != 0) {
+            LOGW("OpenCV writer cannot store rotation %d, output plays unrotated", rotationDegrees);
+        }
+        if (sink && !audio.path.empty()) {
+            LOGW("OpenCV writer cannot copy audio, output is silent");
+        }
+    }
+
+    if (!sink) {
+        LOGE("CRITICAL: Failed to open output writer. File permissions?");
+        return nullptr;
+    }
+    LOGI("Encoding with %s: %dx%d @ %.2f fps", sink->backendName(), size.width, size.height, fps);
+    return sink;
+}
+
+bool concatenateVideos(const vector<string>& inputPaths, const string& outputPath, double fps,
+                       int rotationDegrees, CodecBackend backend, const AudioSource& audio) {
+    if (inputPaths.empty()) return false;
+#if defined(__ANDROID__)
+    if (backend != CodecBackend::OpenCV
+        && remuxMediaCodecVideos(inputPaths, outputPath, fps, rotationDegrees, audio)) {
+        LOGI("Remuxed %zu parts into %s", inputPaths.size(), outputPath.c_str());
+        return true;
+    }
+#endif
+    if (!reencodeVideos(inputPaths, outputPath, fps, rotationDegrees, backend, audio)) {
+        LOGE("Cannot join %zu parts into %s", inputPaths.size(), outputPath.c_str());
+        return false;
+    }
+    LOGI("Re-encoded %zu parts into %s", inputPaths.size(), outputPath.c_str());
+    return true;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "NativeCommon.h"
+#include "YuvFrame.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Frame source/sink abstraction between the processing pipeline and the codecs.
+// Frames cross it as NV12 (see YuvFrame.h), which is what hardware codecs produce
+// and consume, so the MediaCodec path never converts to BGR.
+//
+// Backends:
+//   MediaCodec  AMediaExtractor + AMediaCodec decode, AMediaCodec (H.264) +
+//               AMediaMuxer encode. Hardware codecs, no software fallback chain.
+//               Android only.
+//   OpenCV      cv::VideoCapture / cv::VideoWriter with the avc1 -> H264 -> mp4v -> MJPG
+//               fourcc chain. On a Linux host this is the FFmpeg backend, so the same
+//               pipeline builds and runs there for tests and benchmarks. Converts
+//               BGR <-> NV12 at the edges, since VideoCapture only hands out BGR.
+
+// Chosen per job via StabilizationOptions / TrackingOptions::codecBackend.
+enum class CodecBackend : int {
+    // MediaCodec on Android (OpenCV if it cannot open the file), OpenCV elsewhere.
+    Auto = 0,
+    MediaCodec = 1,
+    OpenCV = 2,
+};
+
+struct VideoInfo {
+    int width = 0;            // Frame size as read(), always even
+    int height = 0;
+    double fps = 0;
+    int frameCount = 0;       // 0 if the container does not say
+    int rotationDegrees = 0;  // Display rotation from the container; frames are not rotated
+};
+
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    virtual const char* backendName() const = 0;
+    virtual const VideoInfo& info() const = 0;
+
+    // Decodes the next frame. timestamp_ms receives its presentation time.
+    // Returns false at the end of the stream or on a decode error.
+    virtual bool read(cv::Mat& frame, double* timestamp_ms = nullptr) = 0;
+
+    // Positions the source so that the next read() returns frame `index` (0-based,
+    // presentation order). Returns false if the backend cannot seek that precisely.
+    virtual bool seekToFrame(int index) = 0;
+};
+
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+
+    virtual const char* backendName() const = 0;
+
+    // Frames must match the size the sink was opened with. Frame i is stamped i / fps.
+    virtual bool write(const cv::Mat& frame) = 0;
+
+    // Flushes the encoder and finalizes the container; the destructor does this too.
+    // Returns false if the file could not be completed.
+    virtual bool close() = 0;
+};
+
+// Audio for an output video: the first audio track of the file its frames were
+// rendered from, copied as compressed samples (no decode or encode).
+struct AudioSource {
+    std::string path;   // Empty: video only
+    int firstFrame = 0; // Source frame that is output frame 0 (a renderer that skips frames)
+};
+
+// Returns nullptr (after logging) if no backend can open the file.
+std::unique_ptr<FrameSource> openFrameSource(const std::string& path, CodecBackend backend);
+
+// `rotationDegrees` is stored as the display rotation where the container supports it.
+// `audio` is aligned so that it plays from source frame `audio.firstFrame` at output
+// frame 0 and is cut after the last frame written. MediaCodec only; the OpenCV writer
+// produces video only.
+std::unique_ptr<FrameSink> openFrameSink(const std::string& path, cv::Size size, double fps,
+                                         int rotationDegrees, CodecBackend backend,
+                                         const AudioSource& audio = AudioSource());
+
+// Writes the videos at `inputPaths` one after the other into `outputPath`. They must
+// share frame size and encoder settings, e.g. the parts of one render (JobCheckpoint.h).
+// MediaCodec remuxes the compressed samples without re-encoding; OpenCV, and MediaCodec
+// when remuxing fails, decode and re-encode. The parts' own audio is ignored; audio
+// comes from `audio` as for openFrameSink. Returns false (after logging) on failure.
+bool concatenateVideos(const std::vector<std::string>& inputPaths, const std::string& outputPath,
+                       double fps, int rotationDegrees, CodecBackend backend,
+                       const AudioSource& audio = AudioSource());
+
+// Backend factories, nullptr if they cannot open the file.
+std::unique_ptr<FrameSource> openOpenCvFrameSource(const std::string& path);
+std::unique_ptr<FrameSink> openOpenCvFrameSink(const std::string& path, cv::Size size, double fps);
+#if defined(__ANDROID__)
+std::unique_ptr<FrameSource> openMediaCodecFrameSource(const std::string& path);
+std::unique_ptr<FrameSink> openMediaCodecFrameSink(const std::string& path, cv::Size size, double fps,
+                                                   int rotationDegrees, const AudioSource& audio);
+bool remuxMediaCodecVideos(const std::vector<std::string>& inputPaths, const std::string& outputPath,
+                           double fps, int rotationDegrees, const AudioSource& audio);
+#endif
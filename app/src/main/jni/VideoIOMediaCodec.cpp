@@ -0,0 +1,778 @@
+#define LOG_TAG "VideoIO"
+
+#include "VideoIO.h"
+
+#if defined(__ANDROID__)
+
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaExtractor.h>
+#include <media/NdkMediaMuxer.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+const int64_t kDequeueTimeoutUs = 10000;
+// Consecutive empty dequeues (x kDequeueTimeoutUs) before a codec is declared stuck.
+const int kMaxIdleDequeues = 300;
+
+// Audio samples are a few KB; MAX_INPUT_SIZE is only a hint, so a larger sample
+// grows the buffer up to the cap.
+const size_t kAudioSampleBytes = 256 * 1024;
+const size_t kMaxAudioSampleBytes = 8 * 1024 * 1024;
+// Video samples read past `firstFrame` to put them in presentation order (B-frames).
+const int kMaxReorderFrames = 16;
+
+// MediaCodecInfo.CodecCapabilities color formats.
+const int32_t kColorFormatYUV420Planar = 19;
+const int32_t kColorFormatYUV420SemiPlanar = 21;
+const int32_t kColorFormatYUV420Flexible = 0x7F420888;
+
+// Layout of a YUV 4:2:0 decoder output buffer, as described by the output format.
+struct YuvLayout {
+    int width = 0;       // Visible size (crop rectangle)
+    int height = 0;
+    int cropLeft = 0;
+    int cropTop = 0;
+    int stride = 0;      // Bytes per luma row
+    int sliceHeight = 0; // Luma rows before the chroma planes start
+    bool planar = false; // I420 (U and V planes) rather than NV12 (interleaved UV)
+};
+
+int32_t formatInt(AMediaFormat* format, const char* key, int32_t fallback) {
+    int32_t value;
+    return AMediaFormat_getInt32(format, key, &value) ? value : fallback;
+}
+
+// Bytes of a buffer entry such as "csd-0"; empty when the format has none.
+vector<uint8_t> formatBuffer(AMediaFormat* format, const char* key) {
+    void* data = nullptr;
+    size_t size = 0;
+    if (!AMediaFormat_getBuffer(format, key, &data, &size) || !data) return {};
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    return vector<uint8_t>(bytes, bytes + size);
+}
+
+YuvLayout layoutFromFormat(AMediaFormat* format, const YuvLayout& previous) {
+    YuvLayout l = previous;
+    int32_t width = formatInt(format, AMEDIAFORMAT_KEY_WIDTH, l.stride);
+    int32_t height = formatInt(format, AMEDIAFORMAT_KEY_HEIGHT, l.sliceHeight);
+    l.stride = std::max(formatInt(format, AMEDIAFORMAT_KEY_STRIDE, width), width);
+    l.sliceHeight = std::max(formatInt(format, "slice-height", height), height);
+
+    l.cropLeft = formatInt(format, "crop-left", 0);
+    l.cropTop = formatInt(format, "crop-top", 0);
+    int32_t crop_right = formatInt(format, "crop-right", width - 1);
+    int32_t crop_bottom = formatInt(format, "crop-bottom", height - 1);
+    // 4:2:0 chroma covers 2x2 luma blocks, so keep the visible size even.
+    l.width = (crop_right - l.cropLeft + 1) & ~1;
+    l.height = (crop_bottom - l.cropTop + 1) & ~1;
+
+    int32_t color = formatInt(format, AMEDIAFORMAT_KEY_COLOR_FORMAT, kColorFormatYUV420SemiPlanar);
+    l.planar = color == kColorFormatYUV420Planar;
+    if (color != kColorFormatYUV420Planar && color != kColorFormatYUV420SemiPlanar) {
+        // Vendor formats (e.g. Qualcomm's tiled-aligned NV12 variants) are NV12 with
+        // padded stride/slice height, which the layout already covers.
+        LOGW("Decoder color format 0x%x, assuming NV12", color);
+    }
+    return l;
+}
+
+// Copies the visible area of a decoder buffer into a tightly packed NV12 frame,
+// interleaving the chroma of planar buffers. Returns false if the buffer is
+// smaller than the layout says.
+bool yuvBufferToNv12(const uint8_t* data, size_t size, const YuvLayout& l, Mat& frame) {
+    size_t chroma_offset = (size_t)l.stride * l.sliceHeight;
+    size_t chroma_rows = (size_t)(l.cropTop + l.height) / 2;
+    size_t needed = l.planar ? chroma_offset + (size_t)(l.stride / 2) * (l.sliceHeight / 2) + (l.stride / 2) * chroma_rows
+                             : chroma_offset + (size_t)l.stride * chroma_rows;
+    if (l.width <= 0 || l.height <= 0 || needed > size) return false;
+
+    createNv12(frame, Size(l.width, l.height));
+    for (int y = 0; y < l.height; y++) {
+        memcpy(frame.ptr(y), data + (size_t)(l.cropTop + y) * l.stride + l.cropLeft, l.width);
+    }
+
+    const uint8_t* chroma = data + chroma_offset;
+    if (l.planar) {
+        int c_stride = l.stride / 2;
+        const uint8_t* u_plane = chroma;
+        const uint8_t* v_plane = chroma + (size_t)c_stride * (l.sliceHeight / 2);
+        for (int y = 0; y < l.height / 2; y++) {
+            size_t offset = (size_t)(l.cropTop / 2 + y) * c_stride + l.cropLeft / 2;
+            const uint8_t* u = u_plane + offset;
+            const uint8_t* v = v_plane + offset;
+            uint8_t* uv = frame.ptr(l.height + y);
+            for (int x = 0; x < l.width / 2; x++) {
+                uv[2 * x] = u[x];
+                uv[2 * x + 1] = v[x];
+            }
+        }
+    } else {
+        for (int y = 0; y < l.height / 2; y++) {
+            memcpy(frame.ptr(l.height + y), chroma + (size_t)(l.cropTop / 2 + y) * l.stride + (l.cropLeft & ~1), l.width);
+        }
+    }
+    return true;
+}
+
+class MediaCodecFrameSource : public FrameSource {
+public:
+    ~MediaCodecFrameSource() override {
+        if (codec) {
+            AMediaCodec_stop(codec);
+            AMediaCodec_delete(codec);
+        }
+        if (extractor) AMediaExtractor_delete(extractor);
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool open(const string& path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+
+        extractor = AMediaExtractor_new();
+        if (AMediaExtractor_setDataSourceFd(extractor, fd, 0, st.st_size) != AMEDIA_OK) return false;
+
+        AMediaFormat* format = nullptr;
+        const char* mime = nullptr;
+        size_t tracks = AMediaExtractor_getTrackCount(extractor);
+        for (size_t i = 0; i < tracks && !format; i++) {
+            AMediaFormat* f = AMediaExtractor_getTrackFormat(extractor, i);
+            if (AMediaFormat_getString(f, AMEDIAFORMAT_KEY_MIME, &mime) && strncmp(mime, "video/", 6) == 0) {
+                format = f;
+                track = (int)i;
+            } else {
+                AMediaFormat_delete(f);
+            }
+        }
+        if (!format) {
+            LOGW("No video track in %s", path.c_str());
+            return false;
+        }
+
+        bool ok = configure(format, mime);
+        AMediaFormat_delete(format);
+        return ok;
+    }
+
+    const char* backendName() const override { return "MediaCodec"; }
+    const VideoInfo& info() const override { return video; }
+
+    bool read(Mat& frame, double* timestamp_ms) override {
+        if (output_eos) return false;
+
+        int idle = 0;
+        while (idle < kMaxIdleDequeues) {
+            if (!input_eos) feedInput();
+
+            AMediaCodecBufferInfo buffer_info;
+            ssize_t idx = AMediaCodec_dequeueOutputBuffer(codec, &buffer_info, kDequeueTimeoutUs);
+            if (idx == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED) {
+                AMediaFormat* format = AMediaCodec_getOutputFormat(codec);
+                layout = layoutFromFormat(format, layout);
+                AMediaFormat_delete(format);
+                continue;
+            }
+            if (idx < 0) {
+                idle++;
+                continue;
+            }
+
+            idle = 0;
+            output_eos = (buffer_info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) != 0;
+            bool wanted = buffer_info.size > 0 && buffer_info.presentationTimeUs >= skip_until_us;
+            bool converted = false;
+            if (wanted) {
+                size_t capacity = 0;
+                uint8_t* data = AMediaCodec_getOutputBuffer(codec, idx, &capacity);
+                converted = data && yuvBufferToNv12(data + buffer_info.offset, buffer_info.size, layout, frame);
+                if (!converted) LOGE("Unexpected decoder buffer layout (%d bytes)", buffer_info.size);
+            }
+            AMediaCodec_releaseOutputBuffer(codec, idx, false);
+
+            if (converted) {
+                if (timestamp_ms) *timestamp_ms = buffer_info.presentationTimeUs / 1000.0;
+                return true;
+            }
+            if (wanted || output_eos) return false;
+        }
+        LOGE("Decoder stalled");
+        return false;
+    }
+
+    bool seekToFrame(int index) override {
+        // Frame index -> presentation time from the container's sample table, so
+        // segment boundaries are exact even for variable frame rate clips.
+        if (sample_times_us.empty()) {
+            AMediaExtractor_seekTo(extractor, 0, AMEDIAEXTRACTOR_SEEK_PREVIOUS_SYNC);
+            do {
+                int64_t t = AMediaExtractor_getSampleTime(extractor);
+                if (t >= 0) sample_times_us.push_back(t);
+            } while (AMediaExtractor_advance(extractor));
+            std::sort(sample_times_us.begin(), sample_times_us.end());
+            video.frameCount = (int)sample_times_us.size();
+        }
+        if (index < 0 || index >= (int)sample_times_us.size()) return false;
+
+        // Decode from the preceding sync sample and drop everything before the target.
+        skip_until_us = sample_times_us[index];
+        AMediaExtractor_seekTo(extractor, skip_until_us, AMEDIAEXTRACTOR_SEEK_PREVIOUS_SYNC);
+        AMediaCodec_flush(codec);
+        input_eos = output_eos = false;
+        return true;
+    }
+
+private:
+    bool configure(AMediaFormat* format, const char* mime) {
+        int32_t width = formatInt(format, AMEDIAFORMAT_KEY_WIDTH, 0);
+        int32_t height = formatInt(format, AMEDIAFORMAT_KEY_HEIGHT, 0);
+        video.width = width & ~1;
+        video.height = height & ~1;
+        video.rotationDegrees = formatInt(format, "rotation-degrees", 0);
+
+        int32_t fps_int;
+        float fps_float;
+        if (AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_FRAME_RATE, &fps_int)) {
+            video.fps = fps_int;
+        } else if (AMediaFormat_getFloat(format, AMEDIAFORMAT_KEY_FRAME_RATE, &fps_float)) {
+            video.fps = fps_float;
+        } else {
+            LOGW("No frame rate in the container, assuming 30 fps");
+            video.fps = 30;
+        }
+        int64_t duration_us;
+        if (AMediaFormat_getInt64(format, AMEDIAFORMAT_KEY_DURATION, &duration_us)) {
+            video.frameCount = (int)std::lround(duration_us * video.fps / 1e6);
+        }
+
+        YuvLayout initial;
+        initial.width = video.width;
+        initial.height = video.height;
+        initial.stride = width;
+        initial.sliceHeight = height;
+        layout = initial;
+
+        AMediaExtractor_selectTrack(extractor, track);
+        codec = AMediaCodec_createDecoderByType(mime);
+        if (!codec) return false;
+
+        AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_COLOR_FORMAT, kColorFormatYUV420Flexible);
+        if (AMediaCodec_configure(codec, format, nullptr, nullptr, 0) != AMEDIA_OK
+            || AMediaCodec_start(codec) != AMEDIA_OK) {
+            LOGW("Cannot start %s decoder", mime);
+            AMediaCodec_delete(codec);
+            codec = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void feedInput() {
+        ssize_t idx = AMediaCodec_dequeueInputBuffer(codec, 0);
+        if (idx < 0) return;
+
+        size_t capacity = 0;
+        uint8_t* buffer = AMediaCodec_getInputBuffer(codec, idx, &capacity);
+        ssize_t n = buffer ? AMediaExtractor_readSampleData(extractor, buffer, capacity) : -1;
+        if (n < 0) {
+            AMediaCodec_queueInputBuffer(codec, idx, 0, 0, 0, AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+            input_eos = true;
+            return;
+        }
+        AMediaCodec_queueInputBuffer(codec, idx, 0, n, AMediaExtractor_getSampleTime(extractor), 0);
+        AMediaExtractor_advance(extractor);
+    }
+
+    int fd = -1;
+    AMediaExtractor* extractor = nullptr;
+    AMediaCodec* codec = nullptr;
+    int track = -1;
+    VideoInfo video;
+    YuvLayout layout;
+    bool input_eos = false;
+    bool output_eos = false;
+    int64_t skip_until_us = 0;
+    vector<int64_t> sample_times_us;
+};
+
+// The first audio track of a source file, copied into an output muxer sample by
+// sample: compressed as it is, no decoder or encoder involved. Output times are
+// source times minus the time of source frame `firstFrame`, so audio stays in sync
+// with output frame i at i / fps as long as it is source frame firstFrame + i.
+class AudioPassthrough {
+public:
+    ~AudioPassthrough() {
+        if (format) AMediaFormat_delete(format);
+        if (extractor) AMediaExtractor_delete(extractor);
+        if (fd >= 0) ::close(fd);
+    }
+
+    // False if the file cannot be read or has no audio track.
+    bool open(const string& path, int firstFrame) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) return false;
+
+        extractor = AMediaExtractor_new();
+        if (AMediaExtractor_setDataSourceFd(extractor, fd, 0, st.st_size) != AMEDIA_OK) return false;
+
+        int audio = -1, video = -1;
+        size_t tracks = AMediaExtractor_getTrackCount(extractor);
+        for (size_t i = 0; i < tracks; i++) {
+            AMediaFormat* f = AMediaExtractor_getTrackFormat(extractor, i);
+            const char* mime = nullptr;
+            if (AMediaFormat_getString(f, AMEDIAFORMAT_KEY_MIME, &mime)) {
+                if (audio < 0 && strncmp(mime, "audio/", 6) == 0) {
+                    audio = (int)i;
+                    format = f;
+                    f = nullptr;
+                } else if (video < 0 && strncmp(mime, "video/", 6) == 0) {
+                    video = (int)i;
+                }
+            }
+            if (f) AMediaFormat_delete(f);
+        }
+        if (audio < 0) {
+            LOGI("No audio track in %s", path.c_str());
+            return false;
+        }
+
+        // Output frame 0 is decoded frame `firstFrame`, whose time need not be
+        // firstFrame / fps (edit lists, clips cut from a longer recording).
+        if (video >= 0) {
+            AMediaExtractor_selectTrack(extractor, video);
+            vector<int64_t> times;
+            do {
+                int64_t t = AMediaExtractor_getSampleTime(extractor);
+                if (t < 0) break;
+                times.push_back(t);
+            } while ((int)times.size() <= firstFrame + kMaxReorderFrames && AMediaExtractor_advance(extractor));
+            std::sort(times.begin(), times.end());
+            if (!times.empty()) {
+                start_us = std::max<int64_t>(0, times[std::min((size_t)firstFrame, times.size() - 1)]);
+            }
+            AMediaExtractor_unselectTrack(extractor, video);
+        }
+        AMediaExtractor_selectTrack(extractor, audio);
+        AMediaExtractor_seekTo(extractor, 0, AMEDIAEXTRACTOR_SEEK_PREVIOUS_SYNC);
+        sample.resize(std::max(kAudioSampleBytes, (size_t)formatInt(format, AMEDIAFORMAT_KEY_MAX_INPUT_SIZE, 0)));
+        return true;
+    }
+
+    // Adds the audio track; call before AMediaMuxer_start.
+    bool addTrack(AMediaMuxer* muxer) {
+        ssize_t t = AMediaMuxer_addTrack(muxer, format);
+        if (t < 0) {
+            LOGW("Muxer rejects the source audio track, writing video only");
+            return false;
+        }
+        track = (size_t)t;
+        return true;
+    }
+
+    // Writes the samples that play before `until_us` of the output. Called as video
+    // samples go in, so the muxer interleaves both tracks instead of buffering audio.
+    void writeUntil(AMediaMuxer* muxer, int64_t until_us) {
+        while (!finished) {
+            int64_t time_us = AMediaExtractor_getSampleTime(extractor);
+            if (time_us < 0) break;
+            int64_t out_us = time_us - start_us;
+            if (out_us >= until_us) return;
+
+            // A sample larger than the buffer reads as an error, not as a short read.
+            ssize_t n;
+            while ((n = AMediaExtractor_readSampleData(extractor, sample.data(), sample.size())) < 0
+                   && sample.size() < kMaxAudioSampleBytes) {
+                sample.resize(sample.size() * 2);
+            }
+            if (n < 0) {
+                LOGW("Unreadable audio sample at %lld us, dropping the rest of the audio", (long long)time_us);
+                break;
+            }
+            // Samples before the first video frame have no picture to go with.
+            if (out_us >= 0) {
+                AMediaCodecBufferInfo info;
+                info.offset = 0;
+                info.size = (int32_t)n;
+                info.presentationTimeUs = out_us;
+                info.flags = (AMediaExtractor_getSampleFlags(extractor) & AMEDIAEXTRACTOR_SAMPLE_FLAG_SYNC)
+                    ? AMEDIACODEC_BUFFER_FLAG_KEY_FRAME : 0;
+                if (AMediaMuxer_writeSampleData(muxer, track, sample.data(), &info) != AMEDIA_OK) {
+                    LOGW("Audio sample rejected, dropping the rest of the audio");
+                    break;
+                }
+                samples_written++;
+            }
+            AMediaExtractor_advance(extractor);
+        }
+        finished = true;
+    }
+
+    int samplesWritten() const { return samples_written; }
+
+private:
+    int fd = -1;
+    AMediaExtractor* extractor = nullptr;
+    AMediaFormat* format = nullptr;
+    size_t track = 0;
+    int64_t start_us = 0;
+    bool finished = false;
+    int samples_written = 0;
+    vector<uint8_t> sample;
+};
+
+// Audio to copy into an output, or null (after logging) if there is none.
+unique_ptr<AudioPassthrough> openAudioPassthrough(const AudioSource& source) {
+    if (source.path.empty()) return nullptr;
+    auto audio = make_unique<AudioPassthrough>();
+    if (!audio->open(source.path, source.firstFrame)) return nullptr;
+    return audio;
+}
+
+class MediaCodecFrameSink : public FrameSink {
+public:
+    ~MediaCodecFrameSink() override { close(); }
+
+    bool open(const string& path, Size frameSize, double frameRate, int rotationDegrees,
+              const AudioSource& audioSource) {
+        size = frameSize;
+        fps = frameRate > 0 ? frameRate : 30;
+
+        codec = AMediaCodec_createEncoderByType("video/avc");
+        if (!codec) return false;
+
+        // ByteBuffer input: NV12 is what nearly every hardware encoder takes, I420 the rest.
+        int bit_rate = std::max(2000000, (int)(0.15 * size.area() * fps));
+        for (int32_t color : {kColorFormatYUV420SemiPlanar, kColorFormatYUV420Planar}) {
+            AMediaFormat* format = AMediaFormat_new();
+            AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, "video/avc");
+            AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_WIDTH, size.width);
+            AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_HEIGHT, size.height);
+            AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_COLOR_FORMAT, color);
+            AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_BIT_RATE, bit_rate);
+            AMediaFormat_setFloat(format, AMEDIAFORMAT_KEY_FRAME_RATE, (float)fps);
+            AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_I_FRAME_INTERVAL, 1);
+            media_status_t status = AMediaCodec_configure(codec, format, nullptr, nullptr,
+                                                          AMEDIACODEC_CONFIGURE_FLAG_ENCODE);
+            AMediaFormat_delete(format);
+            if (status == AMEDIA_OK) {
+                planar = color == kColorFormatYUV420Planar;
+                configured = true;
+                break;
+            }
+        }
+        if (!configured || AMediaCodec_start(codec) != AMEDIA_OK) {
+            LOGW("Cannot start H.264 encoder at %dx%d", size.width, size.height);
+            return false;
+        }
+
+        fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+        if (fd < 0) return false;
+        muxer = AMediaMuxer_new(fd, AMEDIAMUXER_OUTPUT_FORMAT_MPEG_4);
+        if (!muxer) return false;
+        if (rotationDegrees != 0) AMediaMuxer_setOrientationHint(muxer, rotationDegrees);
+        audio = openAudioPassthrough(audioSource);
+
+        LOGI("MediaCodec H.264 encoder: %s input, %d kbps%s", planar ? "I420" : "NV12", bit_rate / 1000,
+             audio ? ", source audio copied" : "");
+        return true;
+    }
+
+    const char* backendName() const override { return "MediaCodec"; }
+
+    bool write(const Mat& frame) override {
+        if (failed || closed) return false;
+
+        // Frames already are NV12; planar encoders only need the chroma deinterleaved.
+        const Mat* yuv = &frame;
+        if (planar) {
+            nv12ToI420(frame, i420);
+            yuv = &i420;
+        } else if (!frame.isContinuous()) {
+            frame.copyTo(packed);
+            yuv = &packed;
+        }
+        size_t bytes = yuv->total();
+
+        ssize_t idx = dequeueInput();
+        if (idx < 0) return fail("Encoder input stalled");
+
+        size_t capacity = 0;
+        uint8_t* buffer = AMediaCodec_getInputBuffer(codec, idx, &capacity);
+        if (!buffer || capacity < bytes) return fail("Encoder input buffer too small");
+        memcpy(buffer, yuv->data, bytes);
+
+        int64_t pts_us = (int64_t)std::llround(frames_queued * 1e6 / fps);
+        AMediaCodec_queueInputBuffer(codec, idx, 0, bytes, pts_us, 0);
+        frames_queued++;
+
+        return drain(false) || fail("Encoder output failed");
+    }
+
+    bool close() override {
+        if (closed) return !failed;
+        closed = true;
+
+        if (codec && muxer && !failed) {
+            ssize_t idx = dequeueInput();
+            if (idx >= 0) {
+                AMediaCodec_queueInputBuffer(codec, idx, 0, 0, 0, AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+                if (!drain(true)) failed = true;
+            } else {
+                failed = true;
+            }
+        }
+        if (audio && muxer_started && !failed) {
+            // Up to the end of the last frame; the rest of the source has no picture.
+            audio->writeUntil(muxer, (int64_t)std::llround(frames_queued * 1e6 / fps));
+            LOGI("Copied %d audio samples", audio->samplesWritten());
+        }
+        if (codec) {
+            AMediaCodec_stop(codec);
+            AMediaCodec_delete(codec);
+            codec = nullptr;
+        }
+        if (muxer) {
+            // A muxer that never started (no frames) cannot be stopped.
+            if (muxer_started && AMediaMuxer_stop(muxer) != AMEDIA_OK) failed = true;
+            if (!muxer_started) failed = true;
+            AMediaMuxer_delete(muxer);
+            muxer = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+        return !failed;
+    }
+
+private:
+    bool fail(const char* reason) {
+        LOGE("%s", reason);
+        failed = true;
+        return false;
+    }
+
+    // Waits for an input buffer, draining output meanwhile so the encoder cannot
+    // deadlock on a full output queue.
+    ssize_t dequeueInput() {
+        for (int tries = 0; tries < kMaxIdleDequeues; tries++) {
+            ssize_t idx = AMediaCodec_dequeueInputBuffer(codec, kDequeueTimeoutUs);
+            if (idx >= 0) return idx;
+            if (!drain(false)) return -1;
+        }
+        return -1;
+    }
+
+    // Moves finished packets into the muxer. With `until_eos`, blocks until the
+    // end-of-stream buffer comes out.
+    bool drain(bool until_eos) {
+        int idle = 0;
+        while (true) {
+            AMediaCodecBufferInfo info;
+            ssize_t idx = AMediaCodec_dequeueOutputBuffer(codec, &info, until_eos ? kDequeueTimeoutUs : 0);
+            if (idx == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED) {
+                // Carries the SPS/PPS; the track can only be added now.
+                AMediaFormat* format = AMediaCodec_getOutputFormat(codec);
+                ssize_t t = AMediaMuxer_addTrack(muxer, format);
+                AMediaFormat_delete(format);
+                if (t < 0) return false;
+                if (audio && !audio->addTrack(muxer)) audio.reset();
+                if (AMediaMuxer_start(muxer) != AMEDIA_OK) return false;
+                track = (size_t)t;
+                muxer_started = true;
+                continue;
+            }
+            if (idx < 0) {
+                if (!until_eos || ++idle >= kMaxIdleDequeues) return !until_eos;
+                continue;
+            }
+
+            idle = 0;
+            size_t capacity = 0;
+            uint8_t* data = AMediaCodec_getOutputBuffer(codec, idx, &capacity);
+            bool config = (info.flags & AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) != 0;
+            if (data && info.size > 0 && !config && muxer_started) {
+                AMediaMuxer_writeSampleData(muxer, track, data, &info);
+                if (audio) audio->writeUntil(muxer, info.presentationTimeUs);
+            }
+            AMediaCodec_releaseOutputBuffer(codec, idx, false);
+            if (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) return true;
+        }
+    }
+
+    Size size;
+    double fps = 30;
+    AMediaCodec* codec = nullptr;
+    AMediaMuxer* muxer = nullptr;
+    int fd = -1;
+    size_t track = 0;
+    bool planar = false;
+    bool configured = false;
+    bool muxer_started = false;
+    bool failed = false;
+    bool closed = false;
+    int64_t frames_queued = 0;
+    Mat i420, packed;
+    unique_ptr<AudioPassthrough> audio;
+};
+
+// Appends the video track of one file after the other to an MP4, compressed samples
+// as they are. Each part is shifted to start one frame after the previous one ended.
+// Audio, if any, comes from the source the parts were rendered from, not the parts.
+// Every part must carry the first part's codec config (SPS/PPS): parts from another
+// encoder configuration fail append(), and the caller re-encodes instead.
+class VideoRemuxer {
+public:
+    ~VideoRemuxer() {
+        if (muxer) {
+            if (muxer_started) AMediaMuxer_stop(muxer);
+            AMediaMuxer_delete(muxer);
+        }
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool open(const string& path, int rotationDegrees, const AudioSource& audioSource) {
+        fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+        if (fd < 0) return false;
+        muxer = AMediaMuxer_new(fd, AMEDIAMUXER_OUTPUT_FORMAT_MPEG_4);
+        if (!muxer) return false;
+        if (rotationDegrees != 0) AMediaMuxer_setOrientationHint(muxer, rotationDegrees);
+        audio = openAudioPassthrough(audioSource);
+        return true;
+    }
+
+    bool append(const string& path, double fps) {
+        int in_fd = ::open(path.c_str(), O_RDONLY);
+        if (in_fd < 0) return false;
+        struct stat st;
+        AMediaExtractor* extractor = AMediaExtractor_new();
+        bool ok = fstat(in_fd, &st) == 0
+            && AMediaExtractor_setDataSourceFd(extractor, in_fd, 0, st.st_size) == AMEDIA_OK
+            && copyVideoTrack(extractor, fps);
+        AMediaExtractor_delete(extractor);
+        ::close(in_fd);
+        if (!ok) LOGW("Cannot remux %s", path.c_str());
+        return ok;
+    }
+
+    bool finish() {
+        if (!muxer_started) return false;
+        // offset_us is the end of the last part's last frame.
+        if (audio) audio->writeUntil(muxer, offset_us);
+        muxer_started = false;
+        return AMediaMuxer_stop(muxer) == AMEDIA_OK;
+    }
+
+private:
+    bool copyVideoTrack(AMediaExtractor* extractor, double fps) {
+        AMediaFormat* format = nullptr;
+        size_t tracks = AMediaExtractor_getTrackCount(extractor);
+        for (size_t i = 0; i < tracks && !format; i++) {
+            AMediaFormat* f = AMediaExtractor_getTrackFormat(extractor, i);
+            const char* mime = nullptr;
+            if (AMediaFormat_getString(f, AMEDIAFORMAT_KEY_MIME, &mime) && strncmp(mime, "video/", 6) == 0) {
+                format = f;
+                AMediaExtractor_selectTrack(extractor, i);
+            } else {
+                AMediaFormat_delete(f);
+            }
+        }
+        if (!format) return false;
+
+        // The first part's format (with its SPS/PPS) describes the whole output.
+        vector<uint8_t> csd0 = formatBuffer(format, "csd-0");
+        vector<uint8_t> csd1 = formatBuffer(format, "csd-1");
+        if (muxer_started && (csd0 != first_csd0 || csd1 != first_csd1)) {
+            LOGW("Part has a different codec config than the first part, cannot remux");
+            AMediaFormat_delete(format);
+            return false;
+        }
+        if (!muxer_started) {
+            first_csd0 = std::move(csd0);
+            first_csd1 = std::move(csd1);
+            ssize_t t = AMediaMuxer_addTrack(muxer, format);
+            if (t >= 0 && audio && !audio->addTrack(muxer)) audio.reset();
+            if (t < 0 || AMediaMuxer_start(muxer) != AMEDIA_OK) {
+                AMediaFormat_delete(format);
+                return false;
+            }
+            track = (size_t)t;
+            muxer_started = true;
+        }
+        int32_t width = formatInt(format, AMEDIAFORMAT_KEY_WIDTH, 1920);
+        int32_t height = formatInt(format, AMEDIAFORMAT_KEY_HEIGHT, 1080);
+        size_t max_sample = (size_t)formatInt(format, AMEDIAFORMAT_KEY_MAX_INPUT_SIZE, width * height * 3 / 2);
+        AMediaFormat_delete(format);
+        if (sample.size() < max_sample) sample.resize(max_sample);
+
+        int64_t last_us = -1;
+        ssize_t n;
+        while ((n = AMediaExtractor_readSampleData(extractor, sample.data(), sample.size())) >= 0) {
+            int64_t time_us = AMediaExtractor_getSampleTime(extractor);
+            AMediaCodecBufferInfo info;
+            info.offset = 0;
+            info.size = (int32_t)n;
+            info.presentationTimeUs = offset_us + time_us;
+            info.flags = (AMediaExtractor_getSampleFlags(extractor) & AMEDIAEXTRACTOR_SAMPLE_FLAG_SYNC)
+                ? AMEDIACODEC_BUFFER_FLAG_KEY_FRAME : 0;
+            if (AMediaMuxer_writeSampleData(muxer, track, sample.data(), &info) != AMEDIA_OK) return false;
+            if (audio) audio->writeUntil(muxer, info.presentationTimeUs);
+            last_us = std::max(last_us, time_us);
+            AMediaExtractor_advance(extractor);
+        }
+        if (last_us < 0) return false;
+        offset_us += last_us + (int64_t)std::llround(1e6 / (fps > 0 ? fps : 30));
+        return true;
+    }
+
+    AMediaMuxer* muxer = nullptr;
+    int fd = -1;
+    size_t track = 0;
+    bool muxer_started = false;
+    int64_t offset_us = 0;
+    vector<uint8_t> sample;
+    vector<uint8_t> first_csd0, first_csd1; // Codec config every part must match
+    unique_ptr<AudioPassthrough> audio;
+};
+
+} // namespace
+
+unique_ptr<FrameSource> openMediaCodecFrameSource(const string& path) {
+    auto source = make_unique<MediaCodecFrameSource>();
+    if (!source->open(path)) return nullptr;
+    return source;
+}
+
+unique_ptr<FrameSink> openMediaCodecFrameSink(const string& path, Size size, double fps, int rotationDegrees,
+                                              const AudioSource& audio) {
+    auto sink = make_unique<MediaCodecFrameSink>();
+    if (!sink->open(path, size, fps, rotationDegrees, audio)) return nullptr;
+    return sink;
+}
+
+bool remuxMediaCodecVideos(const vector<string>& inputPaths, const string& outputPath, double fps,
+                           int rotationDegrees, const AudioSource& audio) {
+    VideoRemuxer remuxer;
+    if (!remuxer.open(outputPath, rotationDegrees, audio)) return false;
+    for (const string& path : inputPaths) {
+        if (!remuxer.append(path, fps)) return false;
+    }
+    return remuxer.finish();
+}
+
+#endif // __ANDROID__
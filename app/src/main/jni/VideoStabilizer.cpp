@@ -0,0 +1,564 @@
+#define LOG_TAG "VideoStabilizer"
+
+#include "VideoStabilizer.h"
+#include "Enhancement.h"
+#include "GeometricWarp.h"
+#include "MotionAnalysis.h"
+#include "MotionSidecar.h"
+#include "GyroMotion.h"
+#include "FramePipeline.h"
+#include "FramePool.h"
+#include "JobCheckpoint.h"
+#include "MemoryBudget.h"
+#include "ThroughputGovernor.h"
+
+#include <atomic>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+namespace {
+
+SmootherParams smootherParams(const StabilizationOptions& options, const WarpGeometry& geometry) {
+    SmootherParams params;
+    params.radius = options.radius;
+    cropMarginsForZoom(options.scale, geometry.sourceSize.width, geometry.sourceSize.height, params);
+    return params;
+}
+
+// Shrinks the job's frame buffers to the native memory budget (MemoryBudget.h):
+// analysis resolution, streaming lookahead, render workers and queue depth, and
+// pass 1 parallelism under critical pressure. Unchanged without a budget.
+StabilizationOptions optionsWithinBudget(const StabilizationOptions& requested, const WarpGeometry& geometry) {
+    StabilizationOptions options = requested;
+    options.analysisLongEdge = analysisLongEdgeWithinBudget(requested.analysisLongEdge);
+    if (memoryPressure() == MemoryPressure::Critical
+        && (options.analysisThreads == 0 || options.analysisThreads > 2)) {
+        options.analysisThreads = 2; // Each segment holds its own estimator and frames
+    }
+
+    size_t budget = memoryBudgetBytes();
+    if (budget == 0) return options;
+    options.lookaheadBudgetBytes = std::min(requested.lookaheadBudgetBytes, budget);
+
+    // Every pipeline slot holds a decoded or a rendered frame, whichever is larger.
+    size_t frame_bytes = (size_t)std::max(geometry.sourceSize.area(), geometry.outputSize.area()) * 3 / 2;
+    int workers = requested.renderThreads > 0 ? requested.renderThreads : defaultPipelineWorkers();
+    int capacity = std::max(2, requested.renderQueueCapacity);
+    int wanted = 2 * capacity + workers;
+    int frames = framesWithinBudget(frame_bytes, wanted);
+    if (frames < wanted) {
+        // Queues round up to powers of two; 2 + 2 slots and one worker is the floor.
+        workers = std::max(1, std::min(workers, frames / 3));
+        capacity = 2;
+        while (4 * capacity + workers <= frames) capacity *= 2;
+        options.renderThreads = workers;
+        options.renderQueueCapacity = capacity;
+        LOGW("Render pipeline limited to %d workers, queue depth %d by memory budget (%zu MB)",
+             workers, capacity, budget / (1024 * 1024));
+    }
+    return options;
+}
+
+// Warps and enhances one frame so that its actual path follows the smoothed path.
+// Holds its own CLAHE instance, so each pipeline worker needs its own renderer.
+// With `temporal` LUTs, every frame index of the clip must be rendered once.
+class StabilizedFrameRenderer {
+public:
+    StabilizedFrameRenderer(const WarpGeometry& geometry, TemporalClaheLuts* temporal, JobStats* stats)
+        : geometry(geometry), temporal(temporal), stats(stats) {}
+
+    void render(int index, const Mat& frame, const Trajectory& actual, const Trajectory& smoothed, Mat& out) {
+        // Calculate jitter correction (Smoothed - Actual)
+        // We want to move the frame such that the Actual path becomes the Smoothed path.
+        // Diff = Smoothed - Actual
+        double diff_x = smoothed.x - actual.x;
+        double diff_y = smoothed.y - actual.y;
+        double diff_a = smoothed.a - actual.a;
+
+        // Stabilization, zoom and output sizing in a single resampling pass
+        StageTimer warp_timer(stats, StatStage::Warp, index);
+        warpNv12ToOutput(frame, out, geometry, stabilizationTransform(diff_x, diff_y, diff_a));
+        warp_timer.stop();
+
+        // Apply Smart Enhancement (at output resolution, luma only)
+        StageTimer enhance_timer(stats, StatStage::Enhance, index);
+        if (temporal) {
+            applySmartEnhancementLuma(out, clahe, *temporal, index);
+        } else {
+            applySmartEnhancementLuma(out, clahe);
+        }
+    }
+
+private:
+    WarpGeometry geometry;
+    LumaClahe clahe; // CLAHE for smart enhancement
+    TemporalClaheLuts* temporal;
+    JobStats* stats;
+};
+
+struct RenderContext {
+    FrameSink& sink;
+    WarpGeometry geometry;
+    JobControl* control;
+    TemporalClaheLuts* enhancementLuts; // null for per-frame enhancement
+    JobStats* stats;                    // null without a job
+    FramePoolProbe& poolProbe;
+    ThroughputGovernor* governor;       // null without a target frame rate
+    std::atomic<bool>& outputFailed;    // Set by the first failed write
+};
+
+// Encodes one output frame. The first failed write fails the job; callers then stop
+// rendering, since every later frame would be decoded, warped and enhanced for nothing.
+bool writeFrame(const RenderContext& ctx, int index, const Mat& out) {
+    StageTimer encode_timer(ctx.stats, StatStage::Encode, index);
+    if (ctx.sink.write(out)) return true;
+    if (!ctx.outputFailed.exchange(true)) {
+        LOGE("Cannot write output frame %d", index);
+        jobFail(ctx.control, JobError::OutputUnwritable, "Cannot write output frame " + to_string(index));
+    }
+    return false;
+}
+
+// Counts a written frame towards the governor and applies its CLAHE knob.
+void governFrame(const RenderContext& ctx) {
+    if (!ctx.governor) return;
+    ctx.governor->frameDone();
+    if (ctx.enhancementLuts) {
+        ctx.enhancementLuts->setRefreshInterval(
+            ctx.governor->claheRefreshInterval(TemporalClaheParams().refreshInterval));
+    }
+}
+
+bool runTwoPass(unique_ptr<FrameSource>& source, const string& inputPath, int n_frames,
+                MotionEstimator& estimator, double analysis_scale,
+                const RenderContext& ctx, const StabilizationOptions& options,
+                const MotionSidecar* cached) {
+    // --- Step 1: Analyze Motion (Feature Matching Pipeline) ---
+    // We need to read all frames to build the full trajectory for global smoothing
+    // But memory is limited on Android. We will process in two passes:
+    // Pass 1: Read video, compute transforms, save transforms.
+    // Pass 2: Re-open video, apply smoothed transforms.
+    //
+    // Pass 1 runs on time segments in parallel when the source can seek; the
+    // segments open their own sources, so `source` is still at frame 0 afterwards.
+    //
+    // With a motion sidecar from an earlier run, pass 1 is skipped entirely.
+    vector<FrameMotion> motion;
+    GyroLog gyro_log;
+    bool source_consumed = false;
+
+    if (!cached) jobBeginStage(ctx.control, JobStage::Analyzing, n_frames);
+    if (ctx.governor) ctx.governor->beginPass();
+
+    if (cached) {
+        motion = cached->frames;
+        LOGI("Pass 1 skipped: %zu frames from motion sidecar", motion.size());
+    } else if (!options.gyroLogPath.empty() && loadGyroLog(options.gyroLogPath, gyro_log)) {
+        // Rotation from the gyro, no feature detection. Not cached: the sidecar
+        // key does not cover the gyro log.
+        GyroParams params;
+        params.timeOffsetMs = options.gyroTimeOffsetMs;
+        params.focalLengthPx = options.focalLengthPx;
+        params.analysisScale = analysis_scale;
+
+        if (!analyzeMotionGyro(*source, gyro_log, params, motion, ctx.control)) return false;
+        source_consumed = true;
+    } else {
+        if (!options.gyroLogPath.empty()) {
+            LOGW("Gyro log unusable, falling back to image motion analysis");
+        }
+
+        MotionAnalysisParams params;
+        params.estimator = options.estimator;
+        params.analysisScale = analysis_scale;
+        params.threads = options.analysisThreads;
+        params.backend = options.codecBackend;
+        params.checkpoint = options.checkpoint;
+        params.governor = ctx.governor;
+
+        if (!analyzeMotionSegmented(inputPath, n_frames, params, motion, ctx.control)) {
+            if (jobCancelled(ctx.control)) return false;
+            jobBeginStage(ctx.control, JobStage::Analyzing, n_frames);
+            if (!analyzeMotionSequential(*source, estimator, analysis_scale, motion, ctx.control, ctx.governor)) {
+                return false;
+            }
+            source_consumed = true;
+        }
+
+        if (options.useMotionSidecar) {
+            MotionSidecar sidecar;
+            sidecar.estimator = options.estimator;
+            sidecar.analysisLongEdge = options.analysisLongEdge;
+            sidecar.frames = motion;
+            saveMotionSidecar(inputPath, sidecar);
+        }
+    }
+
+    // --- Step 2: Compute Trajectory ---
+    TrajectoryBuffer trajectory;
+    trajectory.reserve(motion.size());
+    double x = 0, y = 0, a = 0;
+
+    for(const auto& m : motion) {
+        const TransformParam& t = m.transform;
+        x += t.dx;
+        y += t.dy;
+        a += t.da;
+        trajectory.push_back({x, y, a});
+    }
+
+    // --- Step 3: Smooth Trajectory (Super Stable Gimbal Mode) ---
+    TrajectoryBuffer smoothed_trajectory;
+    unique_ptr<TrajectorySmoother> smoother =
+        createTrajectorySmoother(options.smoother, smootherParams(options, ctx.geometry));
+    int64 smooth_start = getTickCount();
+    StageTimer smooth_timer(ctx.stats, StatStage::Smooth);
+    smoother->smooth(trajectory, smoothed_trajectory);
+    smooth_timer.stop();
+    LOGI("Trajectory smoothed (%s): %zu frames in %.2f ms", smoother->name(), trajectory.size(),
+         (getTickCount() - smooth_start) * 1000.0 / getTickFrequency());
+
+    // --- Step 4: Apply Stabilization & Enhancement ---
+    // Re-open video for Pass 2
+    if (source_consumed) {
+        source = openFrameSource(inputPath, options.codecBackend);
+        if (!source) {
+            LOGE("Failed to re-open video for pass 2");
+            jobFail(ctx.control, JobError::InputUnreadable, "Cannot re-open " + inputPath);
+            return false;
+        }
+    }
+
+    // A resumed job continues after the output parts it already wrote.
+    size_t start = 0;
+    if (options.checkpoint && options.checkpoint->finishedParts() > 0) {
+        start = std::min((size_t)options.checkpoint->finishedParts() * kCheckpointPartFrames,
+                         smoothed_trajectory.size());
+        if (start < smoothed_trajectory.size() && !source->seekToFrame((int)start)) {
+            LOGW("Cannot seek to frame %zu, rendering from the start", start);
+            options.checkpoint->discardParts();
+            start = 0;
+        }
+        if (start > 0) LOGI("Pass 2 resumes at frame %zu", start);
+    }
+
+    // Decode, warp + enhance and encode run as separate pipeline stages so the
+    // codec threads and the compute workers do not stall each other.
+    int workers = options.renderThreads > 0 ? options.renderThreads : defaultPipelineWorkers();
+    FramePipeline pipeline(workers, options.renderQueueCapacity, &ctx.poolProbe, jobPriority(ctx.control));
+    if (ctx.governor) {
+        pipeline.setWorkerLimit([&] { return ctx.governor->workerLimit(pipeline.workerCount()); });
+        ctx.governor->beginPass();
+    }
+
+    vector<unique_ptr<StabilizedFrameRenderer>> renderers;
+    for (int w = 0; w < pipeline.workerCount(); w++) {
+        renderers.push_back(make_unique<StabilizedFrameRenderer>(ctx.geometry, ctx.enhancementLuts, ctx.stats));
+    }
+
+    jobBeginStage(ctx.control, JobStage::Rendering, (int)smoothed_trajectory.size());
+    if (start > 0) jobAdvance(ctx.control, (int)start);
+
+    // Cancelling stops the decoder; frames already in flight are still written,
+    // so the output ends cleanly on the last decoded frame.
+    // Pipeline indices count from `start`: temporal LUTs begin afresh on a resumed
+    // job, like after a scene cut.
+    size_t decoded = start;
+    PipelineStats pipeline_stats = pipeline.run(
+        [&](Mat& frame) {
+            if (jobCancelled(ctx.control) || ctx.outputFailed) return false;
+            if (decoded >= smoothed_trajectory.size()) return false;
+            StageTimer decode_timer(ctx.stats, StatStage::Decode, (int)decoded);
+            if (!source->read(frame)) return false;
+            decoded++;
+            return true;
+        },
+        [&](int worker, int index, const Mat& frame, Mat& out) {
+            size_t i = start + index;
+            renderers[worker]->render(index, frame, trajectory.at(i), smoothed_trajectory.at(i), out);
+        },
+        [&](int index, const Mat& out) {
+            // Frames still in flight after a failed write are dropped.
+            if (ctx.outputFailed || !writeFrame(ctx, (int)start + index, out)) return;
+            ctx.poolProbe.frame(index);
+            jobAdvance(ctx.control);
+            governFrame(ctx);
+            if (index % 30 == 0) LOGI("Pass 2: Writing frame %zu", start + index);
+        });
+
+    if (ctx.stats) {
+        ctx.stats->setCounter("renderWorkers", pipeline_stats.workers);
+        ctx.stats->setCounter("decodeQueueAvg", pipeline_stats.decode_queue_avg);
+        ctx.stats->setCounter("encodeQueueAvg", pipeline_stats.encode_queue_avg);
+        ctx.stats->setCounter("reorderAvg", pipeline_stats.reorder_avg);
+    }
+    return !jobCancelled(ctx.control) && !ctx.outputFailed;
+}
+
+bool runStreaming(FrameSource& source, int n_frames, MotionEstimator& estimator, double analysis_scale,
+                  const RenderContext& ctx, const StabilizationOptions& options) {
+    // The ring holds every frame that is decoded but not yet written:
+    // the frame being emitted plus its `lookahead` future frames.
+    size_t frame_bytes = (size_t)ctx.geometry.sourceSize.area() * 3 / 2; // NV12
+    int budget_frames = (int)std::min<size_t>(options.lookaheadBudgetBytes / std::max<size_t>(frame_bytes, 1), 100000);
+    int lookahead = std::max(1, std::min(options.streamingRadius, budget_frames - 1));
+
+    // The Kalman filter is causal, so frames are written as soon as they are analyzed.
+    bool kalman = options.smoother == SmootherType::Kalman;
+    if (kalman) {
+        lookahead = 0;
+    } else if (lookahead < options.streamingRadius) {
+        LOGW("Streaming lookahead clamped to %d frames by memory budget (%zu MB)",
+             lookahead, options.lookaheadBudgetBytes / (1024 * 1024));
+    }
+    if (options.smoother == SmootherType::CropConstrained) {
+        LOGW("Crop-constrained smoothing needs the whole trajectory, streaming uses gaussian");
+    }
+    LOGI("Streaming stabilization: lookahead %d frames", lookahead);
+
+    vector<Mat> ring(lookahead + 1);
+    Mat out;
+    StabilizedFrameRenderer renderer(ctx.geometry, ctx.enhancementLuts, ctx.stats);
+    estimator.setStats(ctx.stats);
+    AnalysisStream analysis(estimator, analysis_scale, ctx.governor, ctx.stats);
+
+    Mat& first = ring[0];
+    StageTimer decode_timer(ctx.stats, StatStage::Decode, 0);
+    if (!source.read(first)) {
+        LOGE("First frame is empty");
+        jobFail(ctx.control, JobError::InputUnreadable, "No decodable frames");
+        return false;
+    }
+    decode_timer.stop();
+    analysis.reset(first);
+
+    // Cumulative trajectory of every decoded frame. Only a few doubles per frame,
+    // so unlike the frames themselves it is kept for the whole clip.
+    TrajectoryBuffer trajectory;
+    trajectory.push_back({0, 0, 0}); // Frame 0
+
+    GaussianWindow window(lookahead);
+    SmootherParams params = smootherParams(options, ctx.geometry);
+    KalmanTrajectoryFilter filter(params.processNoise, params.measurementNoise);
+    Trajectory filtered = filter.update(trajectory.at(0));
+
+    size_t decoded = 1;
+    size_t emitted = 0;
+
+    auto emit = [&](size_t idx) {
+        const Mat& frame = ring[idx % ring.size()];
+        // With no lookahead, idx is always the newest frame, the one the filter just saw.
+        StageTimer smooth_timer(ctx.stats, StatStage::Smooth, (int)idx);
+        Trajectory smoothed = kalman ? filtered : window.at(trajectory, idx);
+        smooth_timer.stop();
+        renderer.render((int)idx, frame, trajectory.at(idx), smoothed, out);
+        if (!writeFrame(ctx, (int)idx, out)) return false;
+        ctx.poolProbe.frame((int)idx);
+        jobAdvance(ctx.control);
+        governFrame(ctx);
+        if (idx % 30 == 0) LOGI("Streaming: Writing frame %zu", idx);
+        return true;
+    };
+
+    jobBeginStage(ctx.control, JobStage::Rendering, n_frames);
+
+    // Without lookahead the single ring slot must be written before it is reused.
+    if (lookahead == 0 && !emit(emitted++)) return false;
+
+    while(true) {
+        if (jobCancelled(ctx.control)) return false;
+
+        // Slots [emitted, decoded) are still pending, and there are at most
+        // `lookahead` of them here, so this slot is free to overwrite.
+        Mat& slot = ring[decoded % ring.size()];
+        StageTimer frame_decode_timer(ctx.stats, StatStage::Decode, (int)decoded);
+        if (!source.read(slot)) break;
+        frame_decode_timer.stop();
+
+        MotionEstimate estimate = analysis.next(slot);
+        recordMotionEstimate(ctx.stats, estimate);
+        const TransformParam& t = estimate.transform;
+        Trajectory last = trajectory.at(trajectory.size() - 1);
+        trajectory.push_back({last.x + t.dx, last.y + t.dy, last.a + t.da});
+        if (kalman) {
+            StageTimer smooth_timer(ctx.stats, StatStage::Smooth);
+            filtered = filter.update(trajectory.at(decoded));
+        }
+        decoded++;
+
+        // The oldest pending frame can be smoothed once its look-ahead window is full.
+        if (decoded - 1 - emitted >= (size_t)lookahead && !emit(emitted++)) return false;
+    }
+
+    // Drain: the tail of the clip is smoothed with a truncated window,
+    // exactly like the two-pass mode does at the end of the trajectory.
+    while (emitted < decoded) {
+        if (!emit(emitted++)) return false;
+    }
+    return true;
+}
+
+bool runStabilization(const string& inputPath, const string& outputPath,
+                      const StabilizationOptions& requested, const MotionSidecar* cached,
+                      JobControl* control) {
+    LOGI("Starting Super Gimbal Stabilization: %s", inputPath.c_str());
+    TraceScope job_trace("stabilize");
+    // OpenCV calls made on this thread (streaming, sequential pass 1) run at the job's priority.
+    TaskPriorityScope job_priority(jobPriority(control));
+
+    unique_ptr<FrameSource> source = openFrameSource(inputPath, requested.codecBackend);
+    if (!source) {
+        jobFail(control, JobError::InputUnreadable, "Cannot open " + inputPath);
+        return false;
+    }
+
+    const VideoInfo info = source->info();
+    int n_frames = info.frameCount;
+    int width = info.width;
+    int height = info.height;
+    double fps = info.fps;
+
+    if (n_frames <= 0) {
+        LOGW("Warning: Frame count is 0 or unreadable, processing until stream ends.");
+    }
+
+    WarpGeometry geometry;
+    geometry.sourceSize = Size(width, height);
+    geometry.outputSize = computeOutputSize(geometry.sourceSize, requested.outputLongEdge);
+    geometry.zoom = requested.scale;
+    LOGI("Output: %dx%d", geometry.outputSize.width, geometry.outputSize.height);
+    const StabilizationOptions options = optionsWithinBudget(requested, geometry);
+
+    // Frames are processed in coded orientation; the output carries the same
+    // display rotation as the input, and its audio, since output frame i is input frame i.
+    unique_ptr<FrameSink> sink = options.checkpoint
+        ? openCheckpointFrameSink(*options.checkpoint, outputPath, geometry.outputSize, fps, info.rotationDegrees,
+                                  options.codecBackend, control, AudioSource{inputPath})
+        : openFrameSink(outputPath, geometry.outputSize, fps, info.rotationDegrees, options.codecBackend,
+                        AudioSource{inputPath});
+    if (!sink) {
+        jobFail(control, JobError::OutputUnwritable, "Cannot create " + outputPath);
+        return false;
+    }
+
+    unique_ptr<MotionEstimator> estimator = createMotionEstimator(options.estimator);
+    double analysis_scale = computeAnalysisScale(Size(width, height), options.analysisLongEdge);
+    if (!cached) {
+        LOGI("Motion analysis at %dx%d (scale %.3f)",
+             cvRound(width * analysis_scale), cvRound(height * analysis_scale), analysis_scale);
+    }
+    unique_ptr<TemporalClaheLuts> enhancement_luts;
+    if (options.enhancement == EnhancementMode::Temporal) enhancement_luts = make_unique<TemporalClaheLuts>();
+    JobStats* stats = jobStats(control);
+    FramePoolProbe pool_probe;
+    unique_ptr<ThroughputGovernor> governor;
+    if (options.targetFps > 0) {
+        governor = make_unique<ThroughputGovernor>(
+            options.targetFps, options.thermalSource ? *options.thermalSource : systemThermalSource(), stats);
+    }
+    atomic<bool> output_failed{false};
+    RenderContext ctx{*sink, geometry, control, enhancement_luts.get(), stats, pool_probe, governor.get(),
+                      output_failed};
+
+    bool streaming = options.mode == StabilizationMode::Streaming && !cached;
+    if (streaming && !options.gyroLogPath.empty()) {
+        LOGW("Gyro stabilization needs the whole log, using two-pass mode");
+        streaming = false;
+    }
+    if (streaming && options.checkpoint) {
+        LOGW("Checkpointed jobs resume from pass 1 motion, using two-pass mode");
+        streaming = false;
+    }
+
+    bool ok;
+    if (streaming) {
+        ok = runStreaming(*source, n_frames, *estimator, analysis_scale, ctx, options);
+    } else {
+        ok = runTwoPass(source, inputPath, n_frames, *estimator, analysis_scale, ctx, options, cached);
+    }
+
+    if (estimator->framesEstimated() > 0) {
+        LOGI("Motion estimator %s: %.2f ms/frame over %d frames",
+             estimator->name(), estimator->averageCostMs(), estimator->framesEstimated());
+    }
+    if (enhancement_luts) {
+        LOGI("Temporal enhancement: %d LUT refreshes, %d scene cuts",
+             enhancement_luts->refreshCount(), enhancement_luts->sceneCutCount());
+    }
+
+    source.reset();
+    StageTimer close_timer(stats, StatStage::Encode);
+    if (!sink->close()) {
+        LOGE("Failed to finalize output: %s", outputPath.c_str());
+        jobFail(control, JobError::OutputUnwritable, "Cannot finalize " + outputPath);
+        ok = false;
+    }
+    close_timer.stop();
+
+    pool_probe.finish(stats);
+    if (governor) governor->report(stats);
+    if (stats) {
+        if (enhancement_luts) {
+            stats->setCounter("lutRefreshes", enhancement_luts->refreshCount());
+            stats->setCounter("sceneCuts", enhancement_luts->sceneCutCount());
+        }
+        LOGI("Job stats: %s", stats->toJson().c_str());
+    }
+
+    if (jobCancelled(control)) {
+        // close() above finalized the container, so a kept partial output plays.
+        // Nothing is written before rendering starts, so an empty file is never kept.
+        if (control->keepPartialOutput() && control->currentStage() != JobStage::Analyzing) {
+            LOGI("Stabilization cancelled, partial output kept at: %s", outputPath.c_str());
+        } else {
+            LOGI("Stabilization cancelled, output removed");
+            remove(outputPath.c_str());
+        }
+        return false;
+    }
+
+    if (ok) {
+        LOGI("Super Gimbal Stabilization Complete. Output at: %s", outputPath.c_str());
+    }
+    return ok;
+}
+
+} // namespace
+
+bool stabilizeVideoFile(const string& inputPath, const string& outputPath,
+                        const StabilizationOptions& options, JobControl* control) {
+    // Same clip analyzed with the same settings before: reuse its pass 1.
+    if (options.mode == StabilizationMode::TwoPass && options.useMotionSidecar
+        && options.gyroLogPath.empty()) {
+        MotionSidecar sidecar;
+        if (loadMotionSidecar(inputPath, sidecar)
+            && sidecar.estimator == options.estimator
+            && sidecar.analysisLongEdge == options.analysisLongEdge) {
+            return runStabilization(inputPath, outputPath, options, &sidecar, control);
+        }
+    }
+    return runStabilization(inputPath, outputPath, options, nullptr, control);
+}
+
+size_t stabilizationFootprintBytes(Size sourceSize, const StabilizationOptions& options) {
+    Size output = computeOutputSize(sourceSize, options.outputLongEdge);
+    size_t frame_bytes = (size_t)std::max(sourceSize.area(), output.area()) * 3 / 2;
+    int workers = options.renderThreads > 0 ? options.renderThreads : defaultPipelineWorkers();
+    return frame_bytes * (2 * std::max(2, options.renderQueueCapacity) + workers);
+}
+
+bool renderFromMotionSidecar(const string& inputPath, const string& outputPath,
+                             const StabilizationOptions& options, JobControl* control) {
+    MotionSidecar sidecar;
+    if (!loadMotionSidecar(inputPath, sidecar)) {
+        LOGW("No valid motion sidecar for %s", inputPath.c_str());
+        jobFail(control, JobError::NoMotionSidecar, "No motion sidecar for " + inputPath);
+        return false;
+    }
+    return runStabilization(inputPath, outputPath, options, &sidecar, control);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "MotionEstimator.h"
+#include "TrajectorySmoother.h"
+#include "JobControl.h"
+#include "VideoIO.h"
+#include "Enhancement.h"
+
+#include <cstddef>
+#include <string>
+
+class JobCheckpoint;
+class ThermalSource;
+
+// Values mirror NativeBridge.STABILIZE_MODE_* on the Kotlin side.
+enum class StabilizationMode : int {
+    // Pass 1 analyzes the whole clip, pass 2 re-decodes it and applies a
+    // globally smoothed trajectory. Best quality, but every frame is decoded twice.
+    TwoPass = 0,
+    // Single decode. Decoded frames wait in a ring buffer until `streamingRadius`
+    // future frames have been analyzed, then they are smoothed and written.
+    Streaming = 1,
+};
+
+struct StabilizationOptions {
+    StabilizationMode mode = StabilizationMode::TwoPass;
+
+    // Pass 1 motion source. KLT is several times cheaper than ORB on most clips;
+    // ORB stays selectable for devices/scenes where it holds lock better.
+    MotionEstimatorType estimator = MotionEstimatorType::Klt;
+
+    // Long edge (px) of the frames motion is estimated on, or ANALYSIS_AUTO /
+    // ANALYSIS_FULL_RES. See computeAnalysisScale().
+    int analysisLongEdge = ANALYSIS_AUTO;
+
+    // Two-pass only: number of time segments pass 1 analyzes in parallel.
+    // 0 = one per scheduler worker (at most 8), 1 = strictly sequential.
+    int analysisThreads = 0;
+
+    // Two-pass only: concurrent warp + enhance tasks in pass 2 (0 = every scheduler
+    // worker that takes background work) and the depth of each inter-stage queue.
+    int renderThreads = 0;
+    int renderQueueCapacity = 8;
+
+    // How the camera path is smoothed. Streaming supports Gaussian (windowed over
+    // the lookahead) and Kalman (no lookahead); crop-constrained needs the whole
+    // path and falls back to Gaussian there.
+    SmootherType smoother = SmootherType::Gaussian;
+
+    // Decoder/encoder for the input and output files. See VideoIO.h.
+    CodecBackend codecBackend = CodecBackend::Auto;
+
+    // Per-frame or temporally reused CLAHE tile LUTs. See EnhancementMode.
+    EnhancementMode enhancement = EnhancementMode::Temporal;
+
+    // Radius 90 means ~3 seconds of lookahead/lookbehind at 30fps.
+    // This creates a very "floating" feel.
+    int radius = 90;
+
+    // Lookahead used by the streaming mode. Every lookahead frame is held
+    // decoded in memory, so this is much shorter than `radius` (~1 second at 30fps).
+    int streamingRadius = 30;
+
+    // Upper bound for the streaming ring buffer. The effective lookahead is
+    // clamped so that (lookahead + 1) NV12 frames fit in this budget, which
+    // keeps 4K input from exhausting memory (~40 frames at 3840x2160).
+    size_t lookaheadBudgetBytes = 512u * 1024u * 1024u;
+
+    // Dynamic Zoom Strategy
+    // For "Super Stable", we need significant cropping to allow for the frame to shift.
+    // 1.35x zoom provides ~17% buffer on all sides.
+    double scale = 1.35;
+
+    // Output long edge in px; 0 keeps the source resolution. Downscaling happens in
+    // the same resampling pass as the stabilization warp (e.g. 4K -> 1080p export).
+    int outputLongEdge = 0;
+
+    // Two-pass only: write pass-1 motion to "<input>.motion" and reuse it when the
+    // same file is stabilized again with the same estimator and analysis resolution.
+    bool useMotionSidecar = true;
+
+    // Gyro log recorded alongside the video (see GyroMotion.h for the formats).
+    // When set, pass 1 takes rotation from the gyro instead of image features and
+    // the job always runs two-pass. An unreadable log falls back to image analysis.
+    std::string gyroLogPath;
+    double gyroTimeOffsetMs = 0;
+    // Full-resolution focal length in px; 0 = measure translation from the image.
+    double focalLengthPx = 0;
+
+    // Frame rate a long job tries to sustain; 0 runs the fixed workload above. Below
+    // it, or while the device runs hot, the job trades estimator features, analysis
+    // resolution, CLAHE refreshes and render workers for speed (ThroughputGovernor.h).
+    double targetFps = 0;
+    // Where the governor reads the thermal status; null = what the app pushed.
+    const ThermalSource* thermalSource = nullptr;
+
+    // If set, pass 1 segments and output parts are saved there as they finish, and
+    // a job started again with the same checkpoint (after the process was killed)
+    // continues from them. Always runs two-pass. See JobCheckpoint.h.
+    JobCheckpoint* checkpoint = nullptr;
+};
+
+// Stabilizes the video at inputPath and writes the result to outputPath.
+// Returns false if the input could not be read or the output could not be written,
+// or if `control` was cancelled; a cancelled job deletes the output unless
+// control->keepPartialOutput(), in which case the frames written so far remain
+// as a valid, shorter video. A cancelled pass 1 never leaves a motion sidecar.
+bool stabilizeVideoFile(const std::string& inputPath,
+                        const std::string& outputPath,
+                        const StabilizationOptions& options,
+                        JobControl* control = nullptr);
+
+// Renders pass 2 only, from the motion sidecar an earlier two-pass run left next to
+// inputPath, so changing `smoother`, `radius`, `scale` or `outputLongEdge` skips
+// motion analysis.
+// `mode`, `estimator` and the analysis settings are ignored.
+// Returns false without writing anything if there is no valid sidecar.
+bool renderFromMotionSidecar(const std::string& inputPath,
+                             const std::string& outputPath,
+                             const StabilizationOptions& options,
+                             JobControl* control = nullptr);
+
+// Frame memory a two-pass render of a `sourceSize` clip holds with `options` when no
+// memory budget shrinks it. RenderQueue uses it to decide which jobs run together.
+size_t stabilizationFootprintBytes(cv::Size sourceSize, const StabilizationOptions& options);
@@ -0,0 +1,66 @@
+#include "YuvFrame.h"
+
+using namespace cv;
+
+namespace {
+
+// U and V plane views of a tightly packed I420 image.
+void i420Planes(const Mat& i420, Size size, Mat& u, Mat& v) {
+    size_t y_bytes = (size_t)size.area();
+    size_t c_bytes = y_bytes / 4;
+    uchar* data = const_cast<uchar*>(i420.data);
+    u = Mat(size.height / 2, size.width / 2, CV_8UC1, data + y_bytes);
+    v = Mat(size.height / 2, size.width / 2, CV_8UC1, data + y_bytes + c_bytes);
+}
+
+} // namespace
+
+Size nv12Size(const Mat& frame) {
+    return Size(frame.cols, frame.rows * 2 / 3);
+}
+
+void createNv12(Mat& frame, Size size) {
+    frame.create(size.height * 3 / 2, size.width, CV_8UC1);
+}
+
+Mat nv12Luma(const Mat& frame) {
+    return frame.rowRange(0, nv12Size(frame).height);
+}
+
+Mat nv12Chroma(const Mat& frame) {
+    Size size = nv12Size(frame);
+    uchar* uv = const_cast<uchar*>(frame.ptr(size.height));
+    return Mat(size.height / 2, size.width / 2, CV_8UC2, uv, frame.step);
+}
+
+void bgrToNv12(const Mat& bgr, Mat& nv12, Mat& scratch) {
+    Size size(bgr.cols & ~1, bgr.rows & ~1);
+    cvtColor(bgr(Rect(Point(), size)), scratch, COLOR_BGR2YUV_I420);
+    i420ToNv12(scratch, nv12);
+}
+
+void nv12ToBgr(const Mat& nv12, Mat& bgr) {
+    cvtColor(nv12, bgr, COLOR_YUV2BGR_NV12);
+}
+
+void i420ToNv12(const Mat& i420, Mat& nv12) {
+    Size size(i420.cols, i420.rows * 2 / 3);
+    createNv12(nv12, size);
+    i420.rowRange(0, size.height).copyTo(nv12Luma(nv12));
+
+    Mat u, v;
+    i420Planes(i420, size, u, v);
+    Mat uv = nv12Chroma(nv12);
+    Mat planes[] = {u, v};
+    merge(planes, 2, uv);
+}
+
+void nv12ToI420(const Mat& nv12, Mat& i420) {
+    Size size = nv12Size(nv12);
+    i420.create(nv12.rows, nv12.cols, CV_8UC1);
+    nv12Luma(nv12).copyTo(i420.rowRange(0, size.height));
+
+    Mat planes[2];
+    i420Planes(i420, size, planes[0], planes[1]);
+    split(nv12Chroma(nv12), planes);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "NativeCommon.h"
+
+// Video frames travel through the pipeline as NV12 in a single CV_8UC1 Mat of
+// (height * 3/2) x width: the Y plane followed by the interleaved UV plane at half
+// resolution (the layout COLOR_YUV2BGR_NV12 expects). Width and height are even.
+//
+// Motion analysis reads the Y plane, enhancement works on Y only, and the warp
+// resamples Y and UV at their native resolutions, so a frame decoded by a
+// hardware codec reaches the encoder without a BGR round trip.
+
+// Display size of an NV12 frame.
+cv::Size nv12Size(const cv::Mat& frame);
+
+// (Re)allocates `frame` for an NV12 image of `size`. No-op if it already fits.
+void createNv12(cv::Mat& frame, cv::Size size);
+
+// Plane views sharing data with `frame`: Y is CV_8UC1 width x height,
+// UV is CV_8UC2 (width / 2) x (height / 2).
+cv::Mat nv12Luma(const cv::Mat& frame);
+cv::Mat nv12Chroma(const cv::Mat& frame);
+
+// BGR <-> NV12 for the edges that still deal in BGR (the OpenCV codec backend).
+// Odd BGR sizes are cropped to even. `scratch` holds the intermediate I420 image.
+void bgrToNv12(const cv::Mat& bgr, cv::Mat& nv12, cv::Mat& scratch);
+void nv12ToBgr(const cv::Mat& nv12, cv::Mat& bgr);
+
+// Tightly packed I420 (Y, U, V planes) <-> NV12, for codecs that want planar chroma.
+void i420ToNv12(const cv::Mat& i420, cv::Mat& nv12);
+void nv12ToI420(const cv::Mat& nv12, cv::Mat& i420);